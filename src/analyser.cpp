@@ -15,19 +15,32 @@
  *     the Free Software Foundation; either version 2 of the License, or
  *     (at your option) any later version.
  */
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
 
 #include "analyser.hpp"
+#include "code_scan.hpp"
 #include "instruction.hpp"
 #include "image.hpp"
 #include "label.hpp"
 #include "le.hpp"
+#include "memory_usage.hpp"
 #include "regions.hpp"
 #include "symbol_map.hpp"
+#include "trace_events.hpp"
 
 using std::ios;
 
+/** Largest amount of entries accepted for a jump table. */
+#define JUMP_TABLE_MAX 4096
+/** Functions smaller than this are not searched for copies. */
+#define DUPLICATE_MIN_SIZE 8
+
 void
 Analyser::add_region (const Region &reg)
 {
@@ -58,76 +71,240 @@ Analyser::add_initial_regions (void)
   }
 }
 
-void
-Analyser::add_eip_to_labels (void)
+uint32_t
+Analyser::get_entry_address (void) const
 {
   const LEOH *ohdr;
   const LEH *hdr;
-  uint32_t eip;
 
   hdr = this->le->get_header ();
   ohdr = this->le->get_object_header (hdr->eip_object_index);
-  eip = ohdr->base_address + hdr->eip_offset;
-  this->set_label (Label (eip, Label::FUNCTION, "_start"));
+  return ohdr->base_address + hdr->eip_offset;
+}
+
+void
+Analyser::add_eip_to_labels (void)
+{
+  this->set_label (Label (this->get_entry_address (), Label::FUNCTION,
+                          "_start"));
 }
 
 void
 Analyser::add_symbols_to_labels (void)
 {
+  std::vector<Label> batch;
+
   assert(this->symbols != NULL);
 
   for (auto it = this->symbols->begin(); it != this->symbols->end(); it++)
     {
       const Symbol *symbol = &(*it);
 
-      this->set_label (Label (symbol->get_address(), symbol->get_type(), symbol->get_name()));
+      batch.push_back (Label (symbol->get_address(), symbol->get_type(), symbol->get_name()));
     }
+
+  this->set_labels (batch);
 }
 
 void
 Analyser::add_labels_to_trace_queue (void)
 {
+  uint32_t eip;
+
+  eip = this->get_entry_address ();
+
   for (auto it = this->labels.begin(); it != this->labels.end(); it++)
     {
       Label *label = &it->second;
       if (label->get_type() == Label::FUNCTION or
           label->get_type() == Label::JUMP or
           label->get_type() == Label::UNKNOWN)
-        this->add_code_trace_address (label->get_address());
+        this->add_code_trace_address (label->get_address(),
+            (label->get_address() == eip) ? TraceQueue::ENTRY : TraceQueue::SYMBOL);
     }
 }
 
+/** Queues an address found while tracing, with confidence of its origin. */
 void
 Analyser::add_code_trace_address (uint32_t addr)
 {
-  this->code_trace_queue.push_back (addr);
+  this->code_trace_queue.push (addr, this->trace_confidence);
+}
+
+void
+Analyser::add_code_trace_address (uint32_t addr,
+                                  TraceQueue::Confidence confidence)
+{
+  this->code_trace_queue.push (addr, confidence);
+}
+
+void
+Analyser::add_xref (uint32_t source, uint32_t target, XrefIndex::Type type)
+{
+  XrefIndex::Xref xref;
+
+  xref.source = source;
+  xref.target = target;
+  xref.type   = type;
+  this->xrefs.edit ()->add (xref);
 }
 
 void
 Analyser::trace_code (void)
 {
-  uint32_t address;
+  TraceQueue::Entry entry;
+  TraceSpan span ("trace_code", "queued", this->code_trace_queue.size ());
+
+  this->predecode_trace_queue ();
 
-  while (!this->code_trace_queue.empty ())
+  while (this->code_trace_queue.pop (&entry)
+         or (this->trace_next_pending_reloc ()
+             and this->code_trace_queue.pop (&entry)))
   {
-    address = this->code_trace_queue.front ();
-    this->code_trace_queue.pop_front ();
-    this->trace_code_at_address (address);
+    if (this->is_over_budget ())
+      {
+        /* What is left stays unknown */
+        this->code_trace_queue.clear ();
+        this->pending_relocs_pos = this->pending_relocs->size ();
+        break;
+      }
+
+    this->trace_confidence = entry.confidence;
+    this->trace_code_at_address (entry.address);
+    this->report_progress ();
   }
 }
 
+/** Takes next pending reloc target, and queues it if it needs tracing.
+ *
+ * Pending relocs are only looked at when the trace queue is drained, so
+ * each one sees the regions and labels left by tracing the previous ones.
+ * @return True if an address was added to the trace queue.
+ */
 bool
-Analyser::is_valid_acceptable_instruction (Instruction *inst)
+Analyser::trace_next_pending_reloc (void)
 {
-    const char *invalids[] = {"(bad)", "ss", "gs"};
-    std::string text = inst->get_string();
+  const Label *label;
+  Region *reg;
 
-    for (size_t i = 0; i < sizeof(invalids)/sizeof(invalids[0]); ++i) {
-        if (text.compare(invalids[i]) == 0) {
-            return false;
+  while (this->pending_relocs_pos < this->pending_relocs->size ())
+    {
+      const PendingReloc &pending =
+        (*this->pending_relocs)[this->pending_relocs_pos++];
+
+      reg = NULL;
+      if (!pending.in_data)
+        reg = this->get_region_at_address (pending.address);
+
+      if (pending.in_data
+          or (reg != NULL and reg->get_type () == Region::DATA))
+        {
+          this->set_label (Label (pending.address, Label::DATA));
+          continue;
+        }
+
+      if (reg == NULL or reg->get_type () != Region::UNKNOWN)
+        continue;
+
+      label = this->get_label (pending.address);
+
+      if (label == NULL
+          or (label->get_type () != Label::FUNCTION
+              and label->get_type () != Label::JUMP))
+        {
+          if (!this->take_guess ())
+            {
+              this->pending_relocs_pos = this->pending_relocs->size ();
+              return false;
+            }
+
+          this->reloc_guesses.push_back (pending.address);
+          this->set_label (Label (pending.address, Label::FUNCTION));
         }
+
+      this->add_code_trace_address (pending.address, TraceQueue::GUESS);
+      return true;
     }
-    return true;
+
+  return false;
+}
+
+/** Decodes code reachable from queued addresses with many threads.
+ *
+ * Pending relocs are included, as most of them are traced within the
+ * same trace_code() call. Tracing itself stays serial; it only takes the
+ * instructions decoded here instead of decoding them again.
+ */
+void
+Analyser::predecode_trace_queue (void)
+{
+  std::vector<uint32_t> roots;
+  size_t n;
+
+  if (!this->tracer)
+    return;
+
+  this->code_trace_queue.get_addresses (&roots);
+
+  for (n = this->pending_relocs_pos; n < this->pending_relocs->size (); n++)
+    if (!(*this->pending_relocs)[n].in_data)
+      roots.push_back ((*this->pending_relocs)[n].address);
+
+  this->tracer->predecode (roots, &this->regions);
+}
+
+void
+Analyser::decode_instruction (uint32_t addr, const void *data, size_t length,
+                              Instruction *inst)
+{
+  if (this->tracer and this->tracer->lookup (addr, length, inst))
+    return;
+
+  this->disasm.decode (addr, data, length, inst);
+}
+
+bool
+Analyser::is_valid_acceptable_instruction (Instruction *inst)
+{
+    return inst->is_valid();
+}
+
+/** Checks for cmp of a 32-bit register with a constant. */
+static bool
+match_bound_check (const uint8_t *data, size_t size, int *reg,
+                   uint32_t *value)
+{
+  if (size == 3 and data[0] == 0x83 and (data[1] & 0xf8) == 0xf8
+      and (int8_t) data[2] >= 0)
+    {
+      *reg = data[1] & 7;
+      *value = data[2];
+      return true;
+    }
+
+  if (size == 6 and data[0] == 0x81 and (data[1] & 0xf8) == 0xf8)
+    {
+      *reg = data[1] & 7;
+      *value = read_le<uint32_t> (data + 2);
+      return true;
+    }
+
+  if (size == 5 and data[0] == 0x3d) /* cmp eax,imm32 */
+    {
+      *reg = 0;
+      *value = read_le<uint32_t> (data + 1);
+      return true;
+    }
+
+  return false;
+}
+
+/** Checks for unsigned above condition, in short or near form. */
+static bool
+is_jump_if_above (const uint8_t *data, size_t size)
+{
+  return ((size == 2 and data[0] == 0x77)
+          or (size == 6 and data[0] == 0x0f and data[1] == 0x87));
 }
 
 void
@@ -141,6 +318,19 @@ Analyser::trace_code_at_address (uint32_t start_addr)
   Instruction inst;
   const void *data_ptr;
   Region::Type reg_type;
+  JumpTable table;
+  int cmp_reg, bound_reg;
+  uint32_t cmp_value, bound;
+  ValueTracker values;
+  ValueTracker::Use use;
+  const LEFM *fixups;
+  LEFM::const_iterator fitr, ritr;
+  uint32_t relocs;
+  uint32_t target;
+  const Label *label;
+  Analyser::LabelMap::const_iterator litr;
+  uint32_t next_label;
+  size_t label_count;
 
   reg = this->get_region_at_address (start_addr);
   if (reg == NULL)
@@ -152,19 +342,35 @@ Analyser::trace_code_at_address (uint32_t start_addr)
 
   reg_type = reg->get_type ();
   if (reg_type != Region::UNKNOWN) /* already traced */
-    return;
+    {
+      this->stats.stale_traces++;
+      return;
+    }
 
   end_addr = reg->get_end_address ();
   obj = this->image->get_object_at_address (start_addr);
   data = obj->get_data ();
+  fixups = this->le->get_fixups_for_object (obj->get_index ());
+  fitr = fixups->lower_bound (start_addr - obj->get_base_address ());
 
   addr = start_addr;
   reg_type = Region::CODE; /* treat the region as code by default */
+  this->decode_cache.begin_run (start_addr);
+  table.jump = 0;
+  cmp_reg = -1;
+  bound_reg = -1;
+  cmp_value = 0;
+  bound = 0;
+  next_label = 0;
+  label_count = 0;
 
   while (addr < end_addr)
   {
     data_ptr = &data->front () + addr - obj->get_base_address ();
-    this->disasm.disassemble (addr, data_ptr, end_addr - addr, &inst);
+    this->decode_instruction (addr, data_ptr, end_addr - addr, &inst);
+    this->decode_cache.add (addr, &inst);
+    this->phase.instructions++;
+    this->stats.decoded_instructions++;
 
     if (!is_valid_acceptable_instruction (&inst)) {
         /* treating the region as code was wrong, make it data */
@@ -180,12 +386,19 @@ Analyser::trace_code_at_address (uint32_t start_addr)
           case Instruction::CALL:
             this->set_label (Label (inst.get_target (), Label::FUNCTION));
             this->add_code_trace_address (inst.get_target ());
+            this->add_xref (addr, inst.get_target (), XrefIndex::CALL);
             break;
 
           case Instruction::COND_JUMP:
+            this->set_label (Label (inst.get_target (), Label::JUMP));
+            this->add_code_trace_address (inst.get_target ());
+            this->add_xref (addr, inst.get_target (), XrefIndex::COND_JUMP);
+            break;
+
           case Instruction::JUMP:
             this->set_label (Label (inst.get_target (), Label::JUMP));
             this->add_code_trace_address (inst.get_target ());
+            this->add_xref (addr, inst.get_target (), XrefIndex::JUMP);
             break;
 
           default:
@@ -193,6 +406,57 @@ Analyser::trace_code_at_address (uint32_t start_addr)
           }
       }
 
+    /* Follow relocated immediates to indirect calls, within basic blocks */
+    /* Labels are met in address order: keep the next one at hand, and seek
+       again only once it is passed or new labels were set */
+    if (next_label < addr or label_count != this->labels.size ())
+      {
+        label_count = this->labels.size ();
+        litr = this->labels.lower_bound (addr);
+        next_label = (litr != this->labels.end () ? litr->first : end_addr);
+      }
+
+    label = NULL;
+    if (next_label == addr)
+      label = this->get_label (addr);
+
+    if (label != NULL and addr != start_addr
+        and (label->get_type () == Label::JUMP
+             or label->get_type () == Label::FUNCTION))
+      values.reset ();
+
+    relocs = 0;
+    while (fitr != fixups->end ()
+           and fitr->first < addr - obj->get_base_address ())
+      ++fitr;
+
+    for (ritr = fitr; ritr != fixups->end ()
+         and ritr->first < addr + inst.get_size () - obj->get_base_address ();
+         ++ritr)
+      relocs |= 1 << (ritr->first - (addr - obj->get_base_address ()));
+
+    use = values.step ((const uint8_t *) data_ptr, inst.get_size (), relocs,
+                       &target);
+    if (use != ValueTracker::NONE)
+      this->trace_indirect_target (addr, target, use);
+
+    /* Look for a bounded jump through table: cmp reg,imm; ja; jmp *t(,reg,4) */
+    if (inst.get_type () == Instruction::COND_JUMP and cmp_reg >= 0
+        and is_jump_if_above ((const uint8_t *) data_ptr, inst.get_size ()))
+      {
+        bound_reg = cmp_reg;
+        bound = cmp_value + 1;
+      }
+    else if (inst.get_type () == Instruction::JUMP and inst.get_target () == 0)
+      this->match_jump_table (addr, (const uint8_t *) data_ptr,
+                              inst.get_size (), bound_reg, bound, &table);
+    else
+      bound_reg = -1;
+
+    if (!match_bound_check ((const uint8_t *) data_ptr, inst.get_size (),
+                            &cmp_reg, &cmp_value))
+      cmp_reg = -1;
+
     addr += inst.get_size();
 
     switch (inst.get_type ())
@@ -207,8 +471,159 @@ Analyser::trace_code_at_address (uint32_t start_addr)
   }
 
 end:
+  this->decode_cache.end_run (reg_type == Region::CODE);
   this->insert_region
     (reg, Region (start_addr, addr - start_addr, reg_type));
+
+  if (reg_type == Region::CODE)
+    {
+      FunctionModel::Run run;
+
+      run.start = start_addr;
+      run.end = addr;
+      run.falls_through = (addr >= end_addr
+                           and inst.get_type () != Instruction::JUMP
+                           and inst.get_type () != Instruction::RET);
+      this->trace_runs.edit ()->push_back (run);
+    }
+
+  if (table.jump != 0 and reg_type == Region::CODE)
+    this->trace_jump_table (&table);
+}
+
+/** Queues a function found as the known value of an indirect call or jump.
+ */
+void
+Analyser::trace_indirect_target (uint32_t addr, uint32_t target,
+                                 ValueTracker::Use use)
+{
+  const Image::Object *obj;
+  const Region *reg;
+
+  obj = this->image->get_object_at_address (target);
+  reg = this->get_region_at_address (target);
+
+  if (obj == NULL or !obj->is_executable () or reg == NULL
+      or reg->get_type () == Region::DATA
+      or reg->get_type () == Region::VTABLE)
+    return;
+
+  this->set_label (Label (target, Label::FUNCTION));
+  this->add_code_trace_address (target);
+  this->add_xref (addr, target, (use == ValueTracker::CALL)
+                                ? XrefIndex::CALL : XrefIndex::JUMP);
+  this->stats.indirect_targets++;
+}
+
+/** Checks for jmp *table(,reg,4), optionally with cs or ds prefix.
+ *
+ * The table address must be relocated, and the bound applies only when
+ * the index register is the one which was checked.
+ */
+void
+Analyser::match_jump_table (uint32_t addr, const uint8_t *data, size_t size,
+                            int bound_reg, uint32_t bound, JumpTable *ret)
+{
+  const Image::Object *obj;
+  const LEFM *fixups;
+  size_t pos;
+
+  pos = 0;
+  if (size == 8 and (data[0] == 0x2e or data[0] == 0x3e))
+    pos = 1;
+
+  if (size != pos + 7 or data[pos] != 0xff or data[pos + 1] != 0x24
+      or (data[pos + 2] & 0xc7) != 0x85 or (data[pos + 2] & 0x38) == 0x20)
+    return;
+
+  obj = this->image->get_object_at_address (addr);
+  fixups = this->le->get_fixups_for_object (obj->get_index ());
+  if (fixups->find (addr + pos + 3 - obj->get_base_address ())
+      == fixups->end ())
+    return;
+
+  ret->jump = addr;
+  ret->table = read_le<uint32_t> (data + pos + 3);
+  ret->count = 0;
+
+  if (bound_reg == ((data[pos + 2] >> 3) & 7) and bound <= JUMP_TABLE_MAX)
+    ret->count = bound;
+}
+
+/** Marks a jump table, and traces the cases it points to.
+ *
+ * Without a known bound, the table is the run of relocated dwords up to
+ * the next label. Tables in code objects become separate regions, and
+ * those in data objects only get labels.
+ */
+void
+Analyser::trace_jump_table (const JumpTable *table)
+{
+  const Image::Object *obj;
+  const Image::Object *target_obj;
+  const LEFM *fixups;
+  const Label *label;
+  const Region *target_reg;
+  Region *reg;
+  uint32_t slot;
+  uint32_t target;
+  size_t count;
+  size_t max;
+
+  reg = this->get_region_at_address (table->table);
+  obj = this->image->get_object_at_address (table->table);
+  if (reg == NULL or obj == NULL
+      or (reg->get_type () != Region::UNKNOWN
+          and reg->get_type () != Region::DATA))
+    return;
+
+  fixups = this->le->get_fixups_for_object (obj->get_index ());
+  max = (table->count != 0) ? table->count : JUMP_TABLE_MAX;
+
+  for (count = 0; count < max; count++)
+    {
+      slot = table->table + 4 * count;
+
+      if (slot + 4 > reg->get_end_address ()
+          or fixups->find (slot - obj->get_base_address ()) == fixups->end ())
+        break;
+
+      label = this->get_label (slot);
+      if (table->count == 0 and count > 0 and label != NULL)
+        break;
+    }
+
+  if (count == 0)
+    return;
+
+  this->stats.jump_tables++;
+
+  if (reg->get_type () == Region::UNKNOWN and obj->is_executable ())
+    {
+      this->insert_region
+        (reg, Region (table->table, 4 * count, Region::VTABLE));
+      this->set_label (Label (table->table, Label::VTABLE));
+    }
+  else
+    this->set_label (Label (table->table, Label::DATA));
+
+  for (slot = table->table; slot < table->table + 4 * count; slot += 4)
+    {
+      target = read_le<uint32_t> (obj->get_data_at (slot));
+      target_obj = this->image->get_object_at_address (target);
+      target_reg = this->get_region_at_address (target);
+
+      /* A misdetected table must not put code into data */
+      if (target_obj == NULL or !target_obj->is_executable ()
+          or target_reg == NULL or target_reg->get_type () == Region::DATA
+          or target_reg->get_type () == Region::VTABLE)
+        continue;
+
+      this->set_label (Label (target, Label::JUMP));
+      this->add_code_trace_address (target);
+      this->add_xref (table->jump, target, XrefIndex::JUMP);
+      this->stats.jump_table_cases++;
+    }
 }
 
 Region *
@@ -271,14 +686,18 @@ Analyser::insert_region (Region *parent, const Region &reg)
 
   if (reg.get_end_address () != parent->get_end_address ())
     {
-      this->add_region
-        (Region (reg.get_end_address (),
-                 parent->get_end_address () - reg.get_end_address (),
-                 parent->get_type ()));
+      Region tail (reg.get_end_address (),
+                   parent->get_end_address () - reg.get_end_address (),
+                   parent->get_type ());
+
+      this->stats.region_splits++;
+      tail.set_origin (parent->get_origin ());
+      this->add_region (tail);
     }
 
   if (reg.get_address () != parent->get_address ())
     {
+      this->stats.region_splits++;
       this->add_region (reg);
 
       parent->size = reg.get_address () - parent->get_address ();
@@ -292,190 +711,750 @@ Analyser::insert_region (Region *parent, const Region &reg)
 void
 Analyser::check_merge_regions (uint32_t addr)
 {
-  Region *reg;
-  Region *prev;
-  Region *next;
+  this->merge_regions (this->regions.find (addr));
+}
+
+Analyser::RegionMap::iterator
+Analyser::insert_region (RegionMap::iterator parent, const Region &reg)
+{
+  RegionMap::iterator itr;
+  Region *par;
+
+  par = &parent->second;
+
+  assert (par->contains_address (reg.get_address ()));
+  assert (par->contains_address (reg.get_end_address () - 1));
+
+  if (reg.get_end_address () != par->get_end_address ())
+    {
+      Region tail (reg.get_end_address (),
+                   par->get_end_address () - reg.get_end_address (),
+                   par->get_type ());
+
+      this->stats.region_splits++;
+      tail.set_origin (par->get_origin ());
+      this->regions.emplace_hint (std::next (parent), reg.get_end_address (),
+                                  tail);
+    }
+
+  if (reg.get_address () != par->get_address ())
+    {
+      this->stats.region_splits++;
+      itr = this->regions.emplace_hint (std::next (parent),
+                                        reg.get_address (), reg);
+
+      par->size = reg.get_address () - par->get_address ();
+    }
+  else
+    {
+      *par = reg;
+      itr = parent;
+    }
+
+  return this->merge_regions (itr);
+}
 
-  reg = this->get_region (addr);
-  prev = this->get_previous_region (reg);
-  next = this->get_next_region (reg);
+Analyser::RegionMap::iterator
+Analyser::merge_regions (RegionMap::iterator itr)
+{
+  RegionMap::iterator other;
 
-  if (prev != NULL and prev->get_type () == reg->get_type ()
-      and prev->get_end_address () == reg->get_address ())
+  if (itr != this->regions.begin ())
     {
-      prev->size += reg->size;
-      this->regions.erase (addr);
-      reg = prev;
+      other = std::prev (itr);
+
+      if (other->second.get_type () == itr->second.get_type ()
+          and other->second.get_origin () == itr->second.get_origin ()
+          and other->second.get_end_address () == itr->second.get_address ())
+        {
+          other->second.size += itr->second.size;
+          this->regions.erase (itr);
+          this->stats.region_merges++;
+          itr = other;
+        }
     }
 
-  if (next != NULL and reg->get_type () == next->get_type ()
-      and reg->get_end_address () == next->get_address ())
+  other = std::next (itr);
+
+  if (other != this->regions.end ()
+      and itr->second.get_type () == other->second.get_type ()
+      and itr->second.get_origin () == other->second.get_origin ()
+      and itr->second.get_end_address () == other->second.get_address ())
     {
-      reg->size += next->size;
-      this->regions.erase (next->get_address ());
+      itr->second.size += other->second.size;
+      this->regions.erase (other);
+      this->stats.region_merges++;
     }
+
+  return itr;
 }
 
+/** Detects tables of code pointers within not yet traced executable areas.
+ *
+ * Every reloc target is a possible start of a table. The targets, regions
+ * and relocs of the object containing the table are all sorted, so the
+ * detection is made in one forward sweep with a cursor over each of them.
+ * All tables are collected first, then marked and traced together.
+ */
 void
 Analyser::trace_vtables (void)
 {
-  const LEFM *fixups;
-  LEFM::const_iterator itr;
-  const Image::Object *obj;
+  const LinearExecutable::AddressSet *targets;
+  LinearExecutable::AddressSet::const_iterator titr;
+  LinearExecutable::AddressSet::const_iterator tnext;
+  RegionMap::const_iterator ritr;
+  const LEFM *fixups = NULL;
+  LEFM::const_iterator fitr;
+  const Image::Object *obj = NULL;
   const uint8_t *data_ptr;
-  Region *reg;
+  std::vector<Region> tables;
+  std::vector<uint32_t> entries;
+  std::vector<uint32_t> entry_slots;
+  std::vector<size_t> entries_end;
+  std::vector<Region> accepted;
+  std::vector<Label> batch;
   size_t off;
   size_t size;
   size_t count;
-  size_t n;
+  size_t n, k;
   uint32_t addr;
-  const uint32_t *aptr;
+  uint32_t start;
+  uint32_t obj_end = 0;
 
   PUSH_IOS_FLAGS (&std::cerr);
   std::cerr.setf (ios::hex, ios::basefield);
   std::cerr.setf (ios::showbase);
 
-  for (n = 0; n < this->le->get_object_count (); n++)
+  targets = this->le->get_fixup_addresses ();
+  ritr = this->regions.begin ();
+
+  for (titr = targets->begin (); titr != targets->end (); titr = tnext)
     {
-      fixups = this->le->get_fixups_for_object (n);
+      start = *titr;
+      tnext = std::next (titr);
 
-      for (itr = fixups->begin (); itr != fixups->end (); ++itr)
+      while (ritr != this->regions.end ()
+             and ritr->second.get_end_address () <= start)
+        ++ritr;
+
+      if (ritr == this->regions.end () or ritr->first > start)
         {
-          reg = this->get_region_at_address (itr->second.address);
-          if (reg == NULL)
-            {
-              std::cerr << "Warning: Reloc pointing to unmapped memory at "
-                        << itr->second.address << ".\n";
-              continue;
-            }
+          std::cerr << "Warning: Reloc pointing to unmapped memory at "
+                    << start << ".\n";
+          continue;
+        }
 
-          if (reg->get_type () != Region::UNKNOWN)
-            continue;
+      if (ritr->second.get_type () != Region::UNKNOWN)
+        continue;
 
-          obj = this->image->get_object_at_address (reg->get_address ());
-          if (!obj->is_executable ())
+      if (obj == NULL or start < obj->get_base_address () or start >= obj_end)
+        {
+          obj = this->image->get_object_at_address (start);
+          if (obj == NULL)
             continue;
-          size = reg->get_end_address () - itr->second.address;
-          aptr = get_next_value (this->le->get_fixup_addresses (),
-                                 itr->second.address);
-          if (aptr != NULL)
-            size = std::min<size_t> (size, *aptr - itr->second.address);
 
-          data_ptr = obj->get_data_at (itr->second.address);
-          count = 0;
-          off = 0;
+          obj_end = obj->get_base_address () + obj->get_data ()->size ();
+          fixups = this->le->get_fixups_for_object (obj->get_index ());
+          fitr = fixups->begin ();
+        }
 
-          while (off + 4 <= size)
-            {
-              addr = read_le<uint32_t> (data_ptr + off);
-
-              if (addr == 0
-                  or fixups->find (itr->second.address + off
-                                   - obj->get_base_address ())
-                     != fixups->end ())
-                {
-                  count++;
-
-                  if (addr != 0)
-                    {
-                      this->set_label (Label (addr, Label::FUNCTION));
-                      this->add_code_trace_address (addr);
-                    }
-                }
-              else
-                break;
-
-              off += 4;
-            }
+      if (!obj->is_executable ())
+        continue;
+
+      size = ritr->second.get_end_address () - start;
+      if (tnext != targets->end ())
+        size = std::min<size_t> (size, *tnext - start);
+
+      data_ptr = obj->get_data_at (start);
+      count = 0;
+      off = 0;
+
+      while (off + 4 <= size)
+        {
+          addr = read_le<uint32_t> (data_ptr + off);
+          fitr = seek_lower_bound (fixups, fitr,
+                                   start + off - obj->get_base_address ());
+
+          if (fitr != fixups->end ()
+              and fitr->first == start + off - obj->get_base_address ())
+            ++fitr;
+          else if (addr != 0)
+            break;
+
+          count++;
 
-          if (count > 0)
+          if (addr != 0)
             {
-              this->insert_region (reg, Region (itr->second.address,
-                                                4 * count, Region::VTABLE));
-              this->set_label (Label (itr->second.address, Label::VTABLE));
-              this->trace_code ();
+              entries.push_back (addr);
+              entry_slots.push_back (start + off);
             }
+
+          off += 4;
+        }
+
+      if (count > 0)
+        {
+          tables.push_back (Region (start, 4 * count, Region::VTABLE));
+          entries_end.push_back (entries.size ());
+        }
+    }
+
+  /* A table cannot hold code another table points to; in such case
+   * the code wins, as it would once the other table was traced. */
+  std::vector<uint32_t> sorted_entries (entries);
+  std::sort (sorted_entries.begin (), sorted_entries.end ());
+
+  for (n = 0, k = 0; n < tables.size (); n++)
+    {
+      const Region &table = tables[n];
+      std::vector<uint32_t>::const_iterator eitr;
+      size_t first;
+
+      first = k;
+      k = entries_end[n];
+
+      eitr = std::lower_bound (sorted_entries.begin (), sorted_entries.end (),
+                               table.get_address ());
+      if (eitr != sorted_entries.end () and *eitr < table.get_end_address ())
+        continue;
+
+      accepted.push_back (table);
+      batch.push_back (Label (table.get_address (), Label::VTABLE));
+
+      for (; first < k; first++)
+        {
+          batch.push_back (Label (entries[first], Label::FUNCTION));
+          this->add_code_trace_address (entries[first], TraceQueue::VTABLE);
+          this->add_xref (entry_slots[first], entries[first],
+                          XrefIndex::VTABLE);
         }
     }
+
+  this->insert_regions (accepted);
+  this->set_labels (batch);
+  this->trace_code ();
 }
 
+/** Investigates reloc targets which were not reached by tracing.
+ *
+ * Targets are classified in one sweep over the region map first; each
+ * target is considered once, in order of the first fixup pointing to it.
+ * Targets within data get data labels, and those within unknown regions
+ * are traced as functions, all within a single trace_code() call.
+ */
 void
 Analyser::trace_remaining_relocs (void)
 {
   const LEFM *fixups;
   LEFM::const_iterator itr;
-  Region *reg;
-  size_t n;
-  size_t guess_count = 0;
-  const Label *label;
-
-  PUSH_IOS_FLAGS (&std::cerr);
-  std::cerr.setf (ios::hex, ios::basefield);
-  std::cerr.setf (ios::showbase);
+  RegionMap::const_iterator ritr;
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> targets;
+  std::vector<uint8_t> state;
+  std::vector<uint32_t>::const_iterator titr;
+  size_t n, i;
+
+  enum
+  {
+    SKIPPED,
+    IN_UNKNOWN,
+    IN_DATA,
+    QUEUED
+  };
 
   for (n = 0; n < this->image->get_object_count (); n++)
     {
       fixups = this->le->get_fixups_for_object (n);
 
       for (itr = fixups->begin (); itr != fixups->end (); ++itr)
-        {
-          reg = this->get_region_at_address (itr->second.address);
-          if (reg == NULL
-              or (reg->get_type () != Region::UNKNOWN
-                  and reg->get_type () != Region::DATA))
-            continue;
-
-          if (reg->get_type () == Region::UNKNOWN)
-            {
-              label = this->get_label (itr->second.address);
-
-              if (label == NULL
-                  or (label->get_type () != Label::FUNCTION
-                      and label->get_type () != Label::JUMP))
-                {
-                  std::cerr << "Guessing that " << itr->second.address
-                            << " is a function.\n";
-                  guess_count++;
-                  this->set_label (Label (itr->second.address,
-                                          Label::FUNCTION));
-                }
-
-              this->add_code_trace_address (itr->second.address);
-              this->trace_code ();
-            }
-          else
-            {
-              this->set_label (Label (itr->second.address,
-                                      Label::DATA));
-            }
-        }
+        order.push_back (itr->second.address);
     }
 
-  std::cerr.setf (ios::dec, ios::basefield);
-  std::cerr.unsetf (ios::showbase);
-  std::cerr << guess_count << " guess(es) to investigate.\n";
-}
+  targets = order;
+  std::sort (targets.begin (), targets.end ());
+  targets.erase (std::unique (targets.begin (), targets.end ()),
+                 targets.end ());
 
-Analyser::Analyser (void)
-{
-  this->le    = NULL;
-  this->image = NULL;
-  this->symbols = NULL;
-  this->known_type = KnownFile::NOT_KNOWN;
-}
+  state.resize (targets.size (), SKIPPED);
+  ritr = this->regions.begin ();
 
-Analyser::Analyser (const Analyser &other)
-{
-  *this = other;
-}
+  for (i = 0; i < targets.size (); i++)
+    {
+      while (ritr != this->regions.end ()
+             and ritr->second.get_end_address () <= targets[i])
+        ++ritr;
+
+      if (ritr == this->regions.end () or ritr->first > targets[i])
+        continue;
+
+      if (ritr->second.get_type () == Region::UNKNOWN)
+        state[i] = IN_UNKNOWN;
+      else if (ritr->second.get_type () == Region::DATA)
+        state[i] = IN_DATA;
+    }
+
+  this->pending_relocs.edit ()->clear ();
+  this->pending_relocs_pos = 0;
+  this->reloc_guesses.clear ();
+
+  for (titr = order.begin (); titr != order.end (); ++titr)
+    {
+      PendingReloc pending;
+
+      i = std::lower_bound (targets.begin (), targets.end (), *titr)
+          - targets.begin ();
+      if (state[i] == SKIPPED or state[i] == QUEUED)
+        continue;
+
+      pending.address = *titr;
+      pending.in_data = (state[i] == IN_DATA);
+      this->pending_relocs.edit ()->push_back (pending);
+      state[i] = QUEUED;
+    }
+
+  if (this->speculate)
+    this->trace_guesses_speculatively ();
+
+  this->trace_code ();
+
+  this->pending_relocs.edit ()->clear ();
+  this->pending_relocs_pos = 0;
+
+#ifdef DEBUG
+  {
+    PUSH_IOS_FLAGS (&std::cerr);
+    std::cerr.setf (ios::hex, ios::basefield);
+    std::cerr.setf (ios::showbase);
+
+    for (i = 0; i < this->reloc_guesses.size (); i++)
+      std::cerr << ((i % 8 == 0) ? "Guessed functions: " : " ")
+                << this->reloc_guesses[i]
+                << ((i % 8 == 7) ? "\n" : "");
+
+    if (i % 8 != 0)
+      std::cerr << "\n";
+  }
+#endif
+
+  std::cerr << this->reloc_guesses.size () << " guess(es) to investigate.\n";
+
+  if (this->speculate and this->is_verbose ())
+    std::cerr << this->stats.discarded_guesses
+              << " speculative guess(es) discarded.\n";
+}
+
+/** Traces pending reloc targets as speculative guesses.
+ *
+ * All targets within unknown regions are traced privately first, in
+ * parallel, against the regions as they are now. The deltas are then
+ * committed in address order, by tracing the guess for real. A rejected
+ * delta leaves its root unknown, labelled as data; only a run which
+ * reached an invalid opcode is marked as data.
+ */
+void
+Analyser::trace_guesses_speculatively (void)
+{
+  SpeculativeTracer spec (this->image, this->thread_count);
+  std::vector<SpeculativeTracer::Delta> deltas;
+  std::vector<SpeculativeTracer::Delta>::const_iterator itr;
+  std::vector<uint32_t> roots;
+  const Label *label;
+  Region *reg;
+  size_t n;
+
+  for (n = this->pending_relocs_pos; n < this->pending_relocs->size (); n++)
+    {
+      if ((*this->pending_relocs)[n].in_data)
+        this->set_label (Label ((*this->pending_relocs)[n].address,
+                                Label::DATA));
+      else
+        roots.push_back ((*this->pending_relocs)[n].address);
+    }
+
+  this->pending_relocs_pos = this->pending_relocs->size ();
+
+  std::sort (roots.begin (), roots.end ());
+  spec.trace (roots, &this->regions, &deltas);
+  this->report_progress ();
+
+  for (itr = deltas.begin (); itr != deltas.end (); ++itr)
+    {
+      reg = this->get_region_at_address (itr->root);
+      if (reg == NULL)
+        continue;
+
+      if (reg->get_type () == Region::DATA)
+        this->set_label (Label (itr->root, Label::DATA));
+
+      if (reg->get_type () != Region::UNKNOWN)
+        continue;
+
+      label = this->get_label (itr->root);
+
+      if (label != NULL
+          and (label->get_type () == Label::FUNCTION
+               or label->get_type () == Label::JUMP))
+        {
+          /* Not a guess; the address is known to be code */
+          this->add_code_trace_address (itr->root, TraceQueue::SYMBOL);
+          this->trace_code ();
+          continue;
+        }
+
+      if (this->is_delta_applicable (&*itr))
+        {
+          if (!this->take_guess ())
+            break;
+
+          this->reloc_guesses.push_back (itr->root);
+          this->set_label (Label (itr->root, Label::FUNCTION));
+          this->add_code_trace_address (itr->root, TraceQueue::GUESS);
+          this->trace_code ();
+          continue;
+        }
+
+#ifdef DEBUG
+      {
+        PUSH_IOS_FLAGS (&std::cerr);
+        std::cerr.setf (ios::hex, ios::basefield);
+        std::cerr.setf (ios::showbase);
+        std::cerr << "Discarded guess " << itr->root << ": " << itr->verdict
+                  << " at " << itr->culprit << "\n";
+      }
+#endif
+
+      if (itr->verdict == SpeculativeTracer::BAD_OPCODE)
+        this->mark_bad_run (&*itr);
+
+      this->set_label (Label (itr->root, Label::DATA));
+      this->stats.discarded_guesses++;
+    }
+}
+
+/** Marks the run of a rejected delta which reached an invalid opcode as
+ * data, as tracing it for real would; other runs stay unknown.
+ */
+void
+Analyser::mark_bad_run (const SpeculativeTracer::Delta *delta)
+{
+  std::vector<SpeculativeTracer::Run>::const_iterator itr;
+  Region *reg;
+  size_t end;
+
+  for (itr = delta->runs.begin (); itr != delta->runs.end (); ++itr)
+    if (itr->start <= delta->culprit and delta->culprit < itr->end)
+      break;
+
+  if (itr == delta->runs.end ())
+    return;
+
+  reg = this->get_region_at_address (itr->start);
+  if (reg == NULL or reg->get_type () != Region::UNKNOWN)
+    return;
+
+  end = std::min ((size_t) itr->end, reg->get_end_address ());
+
+  this->insert_region
+    (reg, Region (itr->start, end - itr->start, Region::DATA));
+}
+
+/** Checks whether a delta is valid, and still fits current regions.
+ *
+ * Deltas are made against regions from before any of them was committed;
+ * a committed or discarded one may have made data out of what a later
+ * one took for code.
+ */
+bool
+Analyser::is_delta_applicable (const SpeculativeTracer::Delta *delta)
+{
+  std::vector<SpeculativeTracer::Run>::const_iterator itr;
+  const Region *reg;
+
+  if (delta->verdict != SpeculativeTracer::VALID)
+    return false;
+
+  for (itr = delta->runs.begin (); itr != delta->runs.end (); ++itr)
+    {
+      reg = this->get_region_at_address (itr->start);
+
+      if (reg == NULL or reg->get_type () == Region::DATA
+          or reg->get_type () == Region::VTABLE)
+        return false;
+    }
+
+  return true;
+}
+
+/** Traces functions found by scanning bytes of unknown code regions.
+ *
+ * Every prologue found is first traced speculatively, and only valid
+ * deltas which still fit the regions are traced for real, as functions
+ * labelled with the scan origin. Rejected hits leave nothing behind;
+ * the bytes stay unknown.
+ */
+void
+Analyser::trace_scanned_prologues (void)
+{
+  SpeculativeTracer spec (this->image, this->thread_count);
+  CodeScanner scanner;
+  std::vector<CodeScanner::Hit> hits;
+  std::vector<SpeculativeTracer::Delta> deltas;
+  std::vector<SpeculativeTracer::Delta>::const_iterator itr;
+  std::vector<uint32_t> roots;
+  RegionMap::const_iterator ritr;
+  const Image::Object *obj;
+  const Region *reg;
+  size_t n;
+
+  for (ritr = this->regions.begin (); ritr != this->regions.end (); ++ritr)
+    {
+      if (ritr->second.get_type () != Region::UNKNOWN)
+        continue;
+
+      obj = this->image->get_object_at_address (ritr->first);
+      if (obj == NULL or !obj->is_executable ())
+        continue;
+
+      scanner.scan (obj->get_data_at (ritr->first), ritr->first,
+                    ritr->second.get_size (), &hits);
+    }
+
+  for (n = 0; n < hits.size (); n++)
+    roots.push_back (hits[n].address);
+
+  spec.trace (roots, &this->regions, &deltas);
+  this->stats.scan_hits += hits.size ();
+  this->report_progress ();
+
+  for (itr = deltas.begin (); itr != deltas.end (); ++itr)
+    {
+      reg = this->get_region_at_address (itr->root);
+      if (reg == NULL or reg->get_type () != Region::UNKNOWN
+          or !this->is_delta_applicable (&*itr))
+        continue;
+
+      if (!this->take_guess ())
+        break;
+
+      Label lab (itr->root, Label::FUNCTION);
+      lab.set_origin (Label::SCAN);
+      this->set_label (lab);
+      this->add_code_trace_address (itr->root, TraceQueue::SCAN);
+      this->trace_code ();
+      this->stats.scanned_functions++;
+    }
+
+  if (this->is_verbose ())
+    std::cerr << scanner.get_stats ()->bytes
+              << " unknown code byte(s) scanned, "
+              << this->stats.scan_hits << " prologue(s) found, "
+              << this->stats.scanned_functions << " traced as functions.\n";
+}
+
+/** Names functions whose code matches signatures of library functions.
+ *
+ * Functions named already keep their names, but are still noted as
+ * library ones. A name used by another label gets the address appended,
+ * as the same library function may be linked in more than once.
+ */
+void
+Analyser::match_signatures (void)
+{
+  std::vector<std::vector<uint8_t> > relocated;
+  std::set<std::string> names;
+  LabelMap::const_iterator litr;
+  LabelMap::iterator itr;
+  LEFM::const_iterator fitr;
+  const SignatureIndex::Signature *sig;
+  const Image::Object *obj;
+  const LEFM *fixups;
+  std::vector<uint8_t> *mask;
+  std::string name;
+  uint32_t offset;
+  size_t functions;
+  size_t n;
+
+  relocated.resize (this->image->get_object_count ());
+
+  for (litr = this->labels.begin (); litr != this->labels.end (); ++litr)
+    if (!litr->second.get_name ().empty ())
+      names.insert (litr->second.get_name ());
+
+  this->library_functions.clear ();
+  functions = 0;
+
+  for (itr = this->labels.begin (); itr != this->labels.end (); ++itr)
+    {
+      if (itr->second.get_type () != Label::FUNCTION)
+        continue;
+
+      obj = this->image->get_object_at_address (itr->first);
+      if (obj == NULL or !obj->is_executable ())
+        continue;
+
+      functions++;
+      mask = &relocated[obj->get_index ()];
+
+      if (mask->empty ())
+        {
+          mask->resize (obj->get_data ()->size (), 0);
+          fixups = this->le->get_fixups_for_object (obj->get_index ());
+
+          for (fitr = fixups->begin (); fitr != fixups->end (); ++fitr)
+            for (n = fitr->first; n < fitr->first + 4 and n < mask->size (); n++)
+              (*mask)[n] = 1;
+        }
+
+      offset = itr->first - obj->get_base_address ();
+      sig = this->signatures->match (obj->get_data_at (itr->first),
+                                     &(*mask)[offset], mask->size () - offset);
+      if (sig == NULL)
+        continue;
+
+      this->library_functions.push_back (itr->first);
+
+      if (!itr->second.get_name ().empty ())
+        continue;
+
+      name = sig->name;
+
+      if (!names.insert (name).second)
+        {
+          std::ostringstream oss;
+
+          oss << sig->name << "_" << std::hex << itr->first;
+          name = oss.str ();
+          names.insert (name);
+        }
+
+      /* Only the name is new; a function found by the scan stays so */
+      Label named (itr->first, Label::FUNCTION, name);
+      named.set_origin (itr->second.get_origin ());
+      itr->second = named;
+    }
+
+  this->stats.library_functions = this->library_functions.size ();
+
+  {
+    const SignatureIndex::Stats *sstats = this->signatures->get_stats ();
+
+    std::cerr << this->stats.library_functions << " of " << functions
+              << " function(s) matched " << this->signatures->get_count ()
+              << " signature(s), " << sstats->ambiguous << " ambiguous.\n";
+  }
+}
+
+/** Groups functions which are copies of each other.
+ *
+ * A function spans from its label to the next function label, or to the
+ * end of its code region; tiny functions are left out, as they are alike
+ * by nature.
+ */
+void
+Analyser::cluster_duplicates (void)
+{
+  FunctionHasher hasher (this->image, this->le, this->thread_count,
+                         this->find_near_duplicates);
+  std::vector<FunctionHasher::Function> funcs;
+  LabelMap::const_iterator itr;
+  LabelMap::const_iterator next;
+  const Region *reg;
+  size_t end;
+  size_t n;
+
+  for (itr = this->labels.begin (); itr != this->labels.end (); ++itr)
+    {
+      if (itr->second.get_type () != Label::FUNCTION)
+        continue;
+
+      reg = this->get_region_at_address (itr->first);
+      if (reg == NULL or reg->get_type () != Region::CODE)
+        continue;
+
+      end = reg->get_end_address ();
+
+      for (next = std::next (itr);
+           next != this->labels.end () and next->first < end; ++next)
+        {
+          if (next->second.get_type () == Label::FUNCTION)
+            {
+              end = next->first;
+              break;
+            }
+        }
+
+      if (end - itr->first < DUPLICATE_MIN_SIZE)
+        continue;
+
+      FunctionHasher::Function func;
+      func.address = itr->first;
+      func.size = end - itr->first;
+      funcs.push_back (func);
+    }
+
+  hasher.hash (&funcs);
+  hasher.find_clusters (funcs, this->duplicates.edit ());
+
+  this->stats.duplicate_clusters = this->duplicates->size ();
+  this->stats.duplicate_functions = 0;
+
+  for (n = 0; n < this->duplicates->size (); n++)
+    if ((*this->duplicates)[n].kind == FunctionHasher::EXACT)
+      this->stats.duplicate_functions
+        += (*this->duplicates)[n].functions.size ();
+
+  std::cerr << funcs.size () << " function(s) hashed, "
+            << this->stats.duplicate_clusters << " cluster(s) of copies, "
+            << this->stats.duplicate_functions
+            << " function(s) in exact ones.\n";
+}
+
+Analyser::Analyser (void)
+{
+  this->le    = NULL;
+  this->image = NULL;
+  this->symbols = NULL;
+  this->pending_relocs_pos = 0;
+  this->trace_confidence = TraceQueue::ENTRY;
+  this->stats = Stats ();
+  this->thread_count = 1;
+  this->speculate = false;
+  this->scan_code = true;
+  this->find_duplicates = false;
+  this->find_near_duplicates = false;
+  this->known_type = KnownFile::NOT_KNOWN;
+  this->budget = Budget ();
+  this->show_progress = false;
+  this->account_memory = false;
+  this->phase = Phase ();
+  this->phase.name = "initial";
+}
+
+Analyser::Analyser (const Analyser &other)
+{
+  *this = other;
+}
 
 Analyser::Analyser (LinearExecutable *le, Image *img, SymbolMap *syms)
 {
   this->le    = le;
   this->image = img;
   this->symbols = syms;
+  this->pending_relocs_pos = 0;
+  this->trace_confidence = TraceQueue::ENTRY;
+  this->stats = Stats ();
+  this->thread_count = 1;
+  this->speculate = false;
+  this->scan_code = true;
+  this->find_duplicates = false;
+  this->find_near_duplicates = false;
   this->add_initial_regions ();
   this->known_type = KnownFile::NOT_KNOWN;
+  this->budget = Budget ();
+  this->show_progress = false;
+  this->account_memory = false;
+  this->phase = Phase ();
+  this->phase.name = "initial";
 }
 
 Analyser &
@@ -485,11 +1464,109 @@ Analyser::operator= (const Analyser &other)
   this->image  = other.image;
   this->symbols = other.symbols;
   this->disasm = other.disasm;
+  this->thread_count = other.thread_count;
+  this->speculate = other.speculate;
+  this->scan_code = other.scan_code;
+  this->signatures = other.signatures;
+  this->library_functions.clear ();
+  this->find_duplicates = other.find_duplicates;
+  this->find_near_duplicates = other.find_near_duplicates;
+  this->duplicates.reset ();
+  this->changed_functions.clear ();
+  this->trace_runs.reset ();
+  this->functions.reset ();
+  this->data.reset ();
+  this->tracer.reset ();
+  if (other.tracer)
+    this->tracer.reset (new ParallelTracer (other.image,
+                                            other.tracer->get_thread_count ()));
+  this->pending_relocs_pos = 0;
+  this->trace_confidence = TraceQueue::ENTRY;
+  this->stats = Stats ();
+  this->decode_cache.clear ();
+  this->decode_cache.set_memory_limit (other.decode_cache.get_memory_limit ());
   this->known_type = other.known_type;
+  this->timings.reset ();
+  this->budget = other.budget;
+  this->show_progress = other.show_progress;
+  this->account_memory = other.account_memory;
+  this->phase = Phase ();
+  this->phase.name = "initial";
   this->add_initial_regions ();
   return *this;
 }
 
+/** Makes given analyser a copy of this one, to be changed on its own.
+ *
+ * Unlike assignment, which only copies the settings, the whole state of
+ * the analysis is taken. Regions and labels are shared node by node, and
+ * the larger parts of the rest (references, traced runs, functions, data
+ * runs, relocs, duplicates and timings) are shared whole, until changed
+ * by either analyser; so the fork costs only the changes made later.
+ * Pointers to regions and labels taken from this analyser before the fork
+ * may not be used to change it afterwards.
+ */
+void
+Analyser::fork (Analyser *ret) const
+{
+  *ret = *this;
+  ret->regions = this->regions;
+  ret->labels = this->labels;
+  ret->code_trace_queue = this->code_trace_queue;
+  ret->trace_confidence = this->trace_confidence;
+  ret->pending_relocs = this->pending_relocs;
+  ret->pending_relocs_pos = this->pending_relocs_pos;
+  ret->reloc_guesses = this->reloc_guesses;
+  ret->xrefs = this->xrefs;
+  ret->stats = this->stats;
+  ret->library_functions = this->library_functions;
+  ret->duplicates = this->duplicates;
+  ret->changed_functions = this->changed_functions;
+  ret->trace_runs = this->trace_runs;
+  ret->functions = this->functions;
+  ret->data = this->data;
+  ret->timings = this->timings;
+}
+
+struct RegionEqual
+{
+  bool
+  operator() (const Region &a, const Region &b) const
+  {
+    return a.get_address () == b.get_address ()
+           and a.get_size () == b.get_size ()
+           and a.get_type () == b.get_type ()
+           and a.get_origin () == b.get_origin ();
+  }
+};
+
+struct LabelEqual
+{
+  bool
+  operator() (const Label &a, const Label &b) const
+  {
+    return a.get_address () == b.get_address ()
+           and a.get_type () == b.get_type ()
+           and a.get_origin () == b.get_origin ()
+           and a.get_name () == b.get_name ();
+  }
+};
+
+/** Lists regions and labels which differ between two analysers.
+ *
+ * Meant for forks of one another; parts they still share are skipped
+ * without being compared, so the time taken follows the amount of
+ * changes. The changes point into both analysers.
+ */
+void
+Analyser::diff (const Analyser &before, const Analyser &after,
+                std::vector<RegionChange> *regions,
+                std::vector<LabelChange> *labels)
+{
+  RegionMap::diff (before.regions, after.regions, RegionEqual (), regions);
+  LabelMap::diff (before.labels, after.labels, LabelEqual (), labels);
+}
+
 Label *
 Analyser::get_next_label (const Label *lab)
 {
@@ -516,6 +1593,50 @@ Analyser::insert_region (const Region &reg)
   this->insert_region (parent, reg);
 }
 
+static bool
+region_address_less (const Region &a, const Region &b)
+{
+  return a.get_address () < b.get_address ();
+}
+
+/** Inserts a batch of regions, in a single pass over the region map.
+ *
+ * The batch is expected to be sorted by address; if it is not, a sorted
+ * copy is made. Each region is applied the same way as by insert_region().
+ */
+void
+Analyser::insert_regions (const std::vector<Region> &regs)
+{
+  std::vector<Region> sorted;
+  const std::vector<Region> *batch;
+  RegionMap::iterator itr;
+  size_t n;
+
+  batch = &regs;
+  if (!std::is_sorted (regs.begin (), regs.end (), region_address_less))
+    {
+      sorted = regs;
+      std::stable_sort (sorted.begin (), sorted.end (), region_address_less);
+      batch = &sorted;
+    }
+
+  itr = this->regions.begin ();
+
+  for (n = 0; n < batch->size (); n++)
+    {
+      const Region &reg = (*batch)[n];
+
+      itr = seek_lower_bound (&this->regions, itr, reg.get_address ());
+      if (itr == this->regions.end () or itr->first != reg.get_address ())
+        {
+          assert (itr != this->regions.begin ());
+          --itr;
+        }
+
+      itr = this->insert_region (itr, reg);
+    }
+}
+
 void
 Analyser::set_label (const Label &lab)
 {
@@ -531,6 +1652,48 @@ Analyser::set_label (const Label &lab)
   this->labels[lab.get_address ()] = lab;
 }
 
+static bool
+label_address_less (const Label &a, const Label &b)
+{
+  return a.get_address () < b.get_address ();
+}
+
+/** Sets a batch of labels, in a single pass over the label map.
+ *
+ * The batch is expected to be sorted by address; if it is not, a sorted
+ * copy is made. Labels at addresses which are already labelled are used
+ * to improve the existing ones, like in set_label().
+ */
+void
+Analyser::set_labels (const std::vector<Label> &labs)
+{
+  std::vector<Label> sorted;
+  const std::vector<Label> *batch;
+  LabelMap::iterator itr;
+  size_t n;
+
+  batch = &labs;
+  if (!std::is_sorted (labs.begin (), labs.end (), label_address_less))
+    {
+      sorted = labs;
+      std::stable_sort (sorted.begin (), sorted.end (), label_address_less);
+      batch = &sorted;
+    }
+
+  itr = this->labels.begin ();
+
+  for (n = 0; n < batch->size (); n++)
+    {
+      const Label &lab = (*batch)[n];
+
+      itr = seek_lower_bound (&this->labels, itr, lab.get_address ());
+      if (itr != this->labels.end () and itr->first == lab.get_address ())
+        itr->second.improve_from (lab);
+      else
+        itr = this->labels.emplace_hint (itr, lab.get_address (), lab);
+    }
+}
+
 void
 Analyser::remove_label (uint32_t addr)
 {
@@ -553,40 +1716,1013 @@ Analyser::improve_label (const Label &lab)
   return label;
 }
 
+/** Sets amount of threads used for decoding code while tracing.
+ *
+ * The result does not depend on it; with one thread, nothing is decoded
+ * ahead of tracing.
+ */
 void
-Analyser::run (void)
+Analyser::set_thread_count (size_t count)
 {
-  this->add_symbols_to_labels ();
-  this->add_eip_to_labels ();
-  this->add_labels_to_trace_queue ();
-  std::cerr << "Tracing code directly accessible from the entry point...\n";
-  this->trace_code ();
-  std::cerr << "Tracing text relocs for vtables...\n";
-  this->trace_vtables ();
-  std::cerr << "Tracing remaining relocs for functions and data...\n";
-  this->trace_remaining_relocs ();
+  this->thread_count = count;
+
+  if (count > 1)
+    this->tracer.reset (new ParallelTracer (this->image, count));
+  else
+    this->tracer.reset ();
 }
 
-const Analyser::RegionMap *
-Analyser::get_regions (void) const
+/** Enables tracing of reloc guesses as speculative, revertible deltas.
+ *
+ * Without it, guesses are traced one by one in order of relocs, and a
+ * guess found to be data only has its failed run turned into data.
+ */
+void
+Analyser::set_speculation (bool enable)
 {
-  return &this->regions;
+  this->speculate = enable;
 }
 
-const Analyser::LabelMap *
-Analyser::get_labels (void) const
+/** Tells if counters of the analysis are printed after each part; that
+ * is with progress lines, or always in debug builds. */
+bool
+Analyser::is_verbose (void) const
 {
-  return &this->labels;
+#ifdef DEBUG
+  return true;
+#else
+  return this->show_progress;
+#endif
 }
 
-const Label *
-Analyser::get_label (uint32_t addr) const
+/** Enables scanning of unknown code for functions nothing refers to. */
+void
+Analyser::set_code_scan (bool enable)
 {
-  Analyser::LabelMap::const_iterator itr;
+  this->scan_code = enable;
+}
 
-  itr = this->labels.find (addr);
-  if (itr == this->labels.end ())
-    return NULL;
+/** Sets signatures of library functions to name functions with. */
+void
+Analyser::set_signatures (const std::shared_ptr<SignatureIndex> &sigs)
+{
+  this->signatures = sigs;
+}
+
+/** Enables grouping of functions which are copies of each other.
+ *
+ * @param near Also group functions which differ only by displacements
+ *     and immediates.
+ */
+void
+Analyser::set_duplicate_detection (bool enable, bool near)
+{
+  this->find_duplicates = enable;
+  this->find_near_duplicates = near;
+}
+
+/** Limits memory for instructions kept from tracing for printing. */
+void
+Analyser::set_decode_cache_limit (size_t bytes)
+{
+  this->decode_cache.set_memory_limit (bytes);
+}
+
+/** Sets limits of work, applied to each phase of the analysis.
+ *
+ * A phase which exceeds any of them stops tracing, and code it did not
+ * reach is left unknown; later phases start with a fresh budget.
+ */
+void
+Analyser::set_budget (const Budget &budget)
+{
+  this->budget = budget;
+}
+
+/** Enables progress lines, printed at most once per second. */
+void
+Analyser::set_progress (bool enable)
+{
+  this->show_progress = enable;
+}
+
+/** Enables measuring memory of main structures at the end of each phase.
+ */
+void
+Analyser::set_memory_accounting (bool enable)
+{
+  this->account_memory = enable;
+}
+
+/** Parses budget given as comma separated `instructions=N`, `guesses=N`
+ * and `seconds=N` items. */
+bool
+Analyser::parse_budget (const std::string &spec, Budget *ret)
+{
+  std::istringstream iss (spec);
+  std::string item;
+  std::string key;
+  size_t pos;
+  char *end;
+  double value;
+
+  *ret = Budget ();
+
+  while (std::getline (iss, item, ','))
+    {
+      pos = item.find ('=');
+      if (pos == std::string::npos)
+        return false;
+
+      key = item.substr (0, pos);
+      value = strtod (item.c_str () + pos + 1, &end);
+      if (*end != '\0' or end == item.c_str () + pos + 1 or value < 0)
+        return false;
+
+      if (key == "instructions")
+        ret->instructions = value;
+      else if (key == "guesses")
+        ret->guesses = value;
+      else if (key == "seconds")
+        ret->seconds = value;
+      else
+        return false;
+    }
+
+  return true;
+}
+
+void
+Analyser::begin_phase (const char *name)
+{
+  this->phase.name = name;
+  this->phase.instructions = 0;
+  this->phase.guesses = 0;
+  this->phase.start = std::chrono::steady_clock::now ();
+  this->phase.exhausted = false;
+  this->last_progress = this->phase.start;
+  this->end_phase ();
+  this->timings.edit ()->begin (name);
+}
+
+/** Ends timing of the current phase, and measures memory if enabled. */
+void
+Analyser::end_phase (void)
+{
+  MemoryUsage usage;
+
+  this->timings.edit ()->end ();
+
+  if (!this->account_memory)
+    return;
+
+  this->get_memory_usage (&usage);
+  this->timings.edit ()->set_memory (usage);
+}
+
+static void
+print_exhausted (const char *phase, const char *limit)
+{
+  std::cerr << "Warning: Budget of " << limit << " exhausted in " << phase
+            << " phase, the rest is left unknown.\n";
+}
+
+/** Tells whether the current phase used up its instructions or time. */
+bool
+Analyser::is_over_budget (void)
+{
+  const char *limit;
+  std::chrono::duration<double> elapsed;
+
+  if (this->phase.exhausted)
+    return true;
+
+  limit = NULL;
+
+  if (this->budget.instructions != 0
+      and this->phase.instructions >= this->budget.instructions)
+    limit = "instructions";
+  else if (this->budget.seconds > 0)
+    {
+      elapsed = std::chrono::steady_clock::now () - this->phase.start;
+      if (elapsed.count () >= this->budget.seconds)
+        limit = "time";
+    }
+
+  if (limit == NULL)
+    return false;
+
+  print_exhausted (this->phase.name, limit);
+  this->phase.exhausted = true;
+  this->stats.exhausted_phases++;
+  return true;
+}
+
+/** Counts a guess to be traced.
+ * @return False if the phase has no budget left for it.
+ */
+bool
+Analyser::take_guess (void)
+{
+  if (this->is_over_budget ())
+    return false;
+
+  if (this->budget.guesses != 0
+      and this->phase.guesses >= this->budget.guesses)
+    {
+      print_exhausted (this->phase.name, "guesses");
+      this->phase.exhausted = true;
+      this->stats.exhausted_phases++;
+      return false;
+    }
+
+  this->phase.guesses++;
+  this->stats.traced_guesses++;
+  return true;
+}
+
+/** Prints a progress line, if enough time passed since the last one. */
+void
+Analyser::report_progress (void)
+{
+  std::chrono::steady_clock::time_point now;
+  std::chrono::duration<double> elapsed;
+  RegionMap::const_iterator itr;
+  const Image::Object *obj;
+  size_t total, known;
+
+  if (!this->show_progress)
+    return;
+
+  now = std::chrono::steady_clock::now ();
+  if (now - this->last_progress < std::chrono::seconds (1))
+    return;
+
+  this->last_progress = now;
+  total = 0;
+  known = 0;
+
+  for (itr = this->regions.begin (); itr != this->regions.end (); ++itr)
+    {
+      obj = this->image->get_object_at_address (itr->first);
+      if (obj == NULL or !obj->is_executable ())
+        continue;
+
+      total += itr->second.get_size ();
+      if (itr->second.get_type () != Region::UNKNOWN)
+        known += itr->second.get_size ();
+    }
+
+  elapsed = now - this->phase.start;
+
+  PUSH_IOS_FLAGS (&std::cerr);
+  std::cerr.setf (ios::dec, ios::basefield);
+
+  std::cerr << "Progress (" << this->phase.name << "): " << known << " of "
+            << total << " code byte(s) classified ("
+            << (total ? known * 100 / total : 100) << "%), "
+            << this->code_trace_queue.size () << " queued, "
+            << this->pending_relocs->size () - this->pending_relocs_pos
+            << " reloc(s) pending, "
+            << (size_t) (this->phase.instructions
+                         / std::max (elapsed.count (), 0.001))
+            << " instruction(s)/s.\n";
+}
+
+void
+Analyser::run (void)
+{
+  this->add_symbols_to_labels ();
+  this->add_eip_to_labels ();
+  this->add_labels_to_trace_queue ();
+  std::cerr << "Tracing code directly accessible from the entry point...\n";
+  this->begin_phase ("entry");
+  this->trace_code ();
+  std::cerr << "Tracing text relocs for vtables...\n";
+  this->begin_phase ("vtable");
+  this->trace_vtables ();
+  std::cerr << "Tracing remaining relocs for functions and data...\n";
+  this->begin_phase ("reloc");
+  this->trace_remaining_relocs ();
+
+  if (this->scan_code)
+    {
+      std::cerr << "Scanning unknown code for function prologues...\n";
+      this->begin_phase ("scan");
+      this->trace_scanned_prologues ();
+    }
+
+  if (this->signatures)
+    {
+      std::cerr << "Matching functions against library signatures...\n";
+      this->begin_phase ("signature");
+      this->match_signatures ();
+    }
+
+  if (this->find_duplicates)
+    {
+      std::cerr << "Hashing functions for copies...\n";
+      this->begin_phase ("duplicate");
+      this->cluster_duplicates ();
+    }
+
+  this->begin_phase ("index");
+  this->xrefs.edit ()->build (&this->regions);
+  this->functions.edit ()->build (*this->trace_runs, &this->labels,
+                                 &*this->xrefs);
+  this->end_phase ();
+
+  if (this->stats.exhausted_phases > 0)
+    std::cerr << "Warning: " << this->stats.exhausted_phases
+              << " phase(s) stopped by the budget, after "
+              << this->stats.decoded_instructions
+              << " decoded instruction(s).\n";
+
+  /* The same counters are in the report of -T */
+  if (!this->is_verbose ())
+    return;
+
+  {
+    const TraceQueue::Stats *qstats = this->code_trace_queue.get_stats ();
+
+    std::cerr << "Trace queue: " << qstats->pops << " visits, "
+              << qstats->page_switches << " page switches, "
+              << this->stats.stale_traces << " already traced; "
+              << this->stats.region_splits << " region splits, "
+              << this->stats.region_merges << " merges.\n";
+  }
+
+  {
+    const FunctionModel::Stats *fstats = this->functions->get_stats ();
+
+    std::cerr << this->functions->get_function_count () << " function(s) in "
+              << fstats->blocks << " block(s): " << fstats->shared_blocks
+              << " shared, " << fstats->orphan_blocks << " orphan; "
+              << fstats->tail_calls << " tail call(s), "
+              << fstats->call_edges << " call graph edge(s).\n";
+  }
+
+  std::cerr << this->stats.jump_tables << " jump table(s) with "
+            << this->stats.jump_table_cases << " case(s), "
+            << this->stats.indirect_targets
+            << " indirect call target(s) resolved.\n";
+
+  if (this->tracer)
+    {
+      const ParallelTracer::Stats *tstats = this->tracer->get_stats ();
+
+      std::cerr << "Parallel decoding (" << this->tracer->get_thread_count ()
+                << " threads): " << tstats->decoded << " decoded, "
+                << tstats->steals << " steals, "
+                << tstats->hits << " used, "
+                << tstats->misses << " decoded again.\n";
+    }
+}
+
+/** Sets type and origin of given address range, which may span several
+ * regions. */
+void
+Analyser::set_region_type (const Region &range)
+{
+  Region *reg;
+  uint32_t addr, end;
+
+  addr = range.get_address ();
+
+  while (addr < range.get_end_address ())
+    {
+      reg = this->get_region_at_address (addr);
+      if (reg == NULL)
+        {
+          std::cerr << "Warning: Hint of region at an unmapped address: 0x"
+                    << std::hex << addr << ".\n";
+          break;
+        }
+
+      end = std::min (reg->get_end_address (), range.get_end_address ());
+
+      if (reg->get_type () != range.get_type ()
+          or reg->get_origin () != range.get_origin ())
+        {
+          Region part (addr, end - addr, range.get_type ());
+
+          part.set_origin (range.get_origin ());
+          this->insert_region (reg, part);
+        }
+
+      addr = end;
+    }
+}
+
+/** Cuts given address range out of the traced runs. */
+void
+Analyser::clip_trace_runs (uint32_t start, uint32_t end)
+{
+  std::vector<FunctionModel::Run> runs;
+  size_t n;
+
+  for (n = 0; n < this->trace_runs->size (); n++)
+    {
+      FunctionModel::Run run = (*this->trace_runs)[n];
+
+      if (run.end <= start or run.start >= end)
+        {
+          runs.push_back (run);
+          continue;
+        }
+
+      if (run.start < start)
+        {
+          FunctionModel::Run head = run;
+          head.end = start;
+          head.falls_through = true;
+          runs.push_back (head);
+        }
+
+      if (run.end > end)
+        {
+          run.start = end;
+          runs.push_back (run);
+        }
+    }
+
+  this->trace_runs.edit ()->swap (runs);
+}
+
+/** Applies a region hint on top of finished analysis.
+ *
+ * The hint may span several regions. Jump labels inside are removed and
+ * traced runs are clipped, as the code they came from is no longer code.
+ */
+void
+Analyser::apply_region_hint (const Region &hint)
+{
+  LabelMap::iterator litr;
+  Region range (hint);
+
+  range.set_origin (Region::HINT);
+  this->set_region_type (range);
+
+  litr = this->labels.lower_bound (hint.get_address ());
+
+  while (litr != this->labels.end ()
+         and litr->first < hint.get_end_address ())
+    {
+      if (litr->second.get_type () == Label::JUMP)
+        litr = this->labels.erase (litr);
+      else
+        ++litr;
+    }
+
+  this->clip_trace_runs (hint.get_address (), hint.get_end_address ());
+}
+
+static bool
+is_in_ranges (const std::map<uint32_t, uint32_t> &ranges, uint32_t addr)
+{
+  std::map<uint32_t, uint32_t>::const_iterator itr;
+
+  itr = ranges.upper_bound (addr);
+  if (itr == ranges.begin ())
+    return false;
+
+  --itr;
+  return (addr < itr->second);
+}
+
+/** Checks if a traced address was reached only from code which is gone.
+ *
+ * Named labels, the entry point and fixup targets are kept, as they do
+ * not come from tracing alone.
+ * @param fall_in True if code which is gone ran into the address.
+ */
+bool
+Analyser::is_guess_orphaned (uint32_t target, bool fall_in,
+                             const std::map<uint32_t, uint32_t> &gone)
+{
+  LabelMap::const_iterator litr;
+  const XrefIndex::Ref *refs;
+  size_t count;
+  size_t n;
+
+  if (target == this->get_entry_address ()
+      or this->le->get_fixup_addresses ()->count (target) != 0)
+    return false;
+
+  litr = this->labels.find (target);
+  if (litr != this->labels.end ()
+      and (!litr->second.get_name ().empty ()
+           or litr->second.get_type () == Label::DATA
+           or litr->second.get_type () == Label::VTABLE))
+    return false;
+
+  refs = this->xrefs->get_refs_to (target, &count);
+  if (count == 0 and !fall_in)
+    return false;
+
+  for (n = 0; n < count; n++)
+    if (!is_in_ranges (gone, refs[n].address))
+      return false;
+
+  return true;
+}
+
+/** Withdraws guesses which were made only from code that is no more code.
+ *
+ * Targets referenced just from the dropped runs lose their labels; runs
+ * traced from them are made unknown and their own targets are checked in
+ * turn. Addresses within such runs which are still referenced from
+ * elsewhere, or by fixups, are queued for tracing again.
+ * @param dropped Former code, with falls_through set if it ran into the
+ *     code after it.
+ * @param changed Receives ranges of the runs made unknown.
+ */
+void
+Analyser::invalidate_guesses (const std::vector<FunctionModel::Run> &dropped,
+                              std::vector<Region> *changed)
+{
+  std::map<uint32_t, FunctionModel::Run> runs_at;
+  std::map<uint32_t, FunctionModel::Run>::const_iterator ritr;
+  std::map<uint32_t, uint32_t> gone;
+  std::vector<FunctionModel::Run> work;
+  std::vector<FunctionModel::Run> reopened;
+  LinearExecutable::AddressSet::const_iterator fitr;
+  const LinearExecutable::AddressSet *fixup_targets;
+  const XrefIndex::Ref *refs;
+  FunctionModel::Run run;
+  std::vector<uint32_t> targets;
+  LabelMap::iterator litr;
+  uint32_t target;
+  bool fall_in;
+  size_t count;
+  size_t n, k;
+
+  if (dropped.empty ())
+    return;
+
+  for (n = 0; n < this->trace_runs->size (); n++)
+    runs_at[(*this->trace_runs)[n].start] = (*this->trace_runs)[n];
+
+  for (n = 0; n < dropped.size (); n++)
+    gone[dropped[n].start] = dropped[n].end;
+
+  work = dropped;
+
+  while (!work.empty ())
+    {
+      run = work.back ();
+      work.pop_back ();
+      targets.clear ();
+
+      for (n = this->xrefs->find_source_index (run.start);
+           n < this->xrefs->get_source_count ()
+           and this->xrefs->get_source (n) < run.end; n++)
+        {
+          refs = this->xrefs->get_refs_from (this->xrefs->get_source (n),
+                                            &count);
+
+          for (k = 0; k < count; k++)
+            targets.push_back (refs[k].address);
+        }
+
+      /* The one past last is the code which the run ran into */
+      if (run.falls_through)
+        targets.push_back (run.end);
+
+      for (n = 0; n < targets.size (); n++)
+        {
+          fall_in = (run.falls_through and n + 1 == targets.size ());
+
+          if (!this->is_guess_orphaned (targets[n], fall_in, gone))
+            continue;
+
+          litr = this->labels.find (targets[n]);
+          if (litr != this->labels.end ())
+            {
+              this->labels.erase (litr);
+              this->stats.withdrawn_guesses++;
+            }
+
+          ritr = runs_at.find (targets[n]);
+          if (ritr == runs_at.end () or is_in_ranges (gone, targets[n]))
+            continue;
+
+          gone[ritr->second.start] = ritr->second.end;
+          work.push_back (ritr->second);
+          reopened.push_back (ritr->second);
+        }
+    }
+
+  fixup_targets = this->le->get_fixup_addresses ();
+
+  for (n = 0; n < reopened.size (); n++)
+    {
+      run = reopened[n];
+
+      this->set_region_type (Region (run.start, run.end - run.start,
+                                     Region::UNKNOWN));
+      this->clip_trace_runs (run.start, run.end);
+      changed->push_back (Region (run.start, run.end - run.start));
+    }
+
+  /* What live code or fixups still point at is code again */
+  for (n = 0; n < reopened.size (); n++)
+    {
+      run = reopened[n];
+
+      for (k = this->xrefs->find_target_index (run.start);
+           k < this->xrefs->get_target_count ()
+           and this->xrefs->get_target (k) < run.end; k++)
+        {
+          target = this->xrefs->get_target (k);
+
+          litr = this->labels.find (target);
+
+          if (litr != this->labels.end ()
+              and litr->second.get_type () != Label::DATA
+              and litr->second.get_type () != Label::VTABLE
+              and !this->is_guess_orphaned (target, false, gone))
+            this->add_code_trace_address (target);
+        }
+
+      for (fitr = fixup_targets->lower_bound (run.start);
+           fitr != fixup_targets->end () and *fitr < run.end; ++fitr)
+        this->add_code_trace_address (*fitr);
+    }
+}
+
+/** Applies a label hint on top of finished analysis.
+ *
+ * Name and type of the hint replace those of an existing label. Code
+ * labels are queued for tracing; if they point into data of executable
+ * object, which analysis found, the rest of that region is made unknown
+ * again, as it was probably a rejected guess. Data from hints or known
+ * file fixups, of this run or saved with the analysis, is kept.
+ * @return True if the label was changed.
+ */
+bool
+Analyser::apply_label_hint (const Label &hint)
+{
+  LabelMap::iterator itr;
+  Label::Type type;
+  std::string name;
+  Region *reg;
+
+  itr = this->labels.find (hint.get_address ());
+
+  if (itr == this->labels.end ())
+    this->labels[hint.get_address ()] = hint;
+  else
+    {
+      type = itr->second.get_type ();
+      name = itr->second.get_name ();
+
+      if ((hint.get_type () == Label::UNKNOWN or hint.get_type () == type)
+          and (hint.get_name ().empty () or hint.get_name () == name))
+        return false;
+
+      if (hint.get_type () != Label::UNKNOWN)
+        type = hint.get_type ();
+
+      if (!hint.get_name ().empty ())
+        name = hint.get_name ();
+
+      itr->second = Label (hint.get_address (), type, name);
+    }
+
+  type = this->labels[hint.get_address ()].get_type ();
+  if (type == Label::VTABLE or type == Label::DATA)
+    return true;
+
+  reg = this->get_region_at_address (hint.get_address ());
+  if (reg == NULL)
+    return true;
+
+  if (reg->get_type () == Region::DATA and type != Label::UNKNOWN
+      and this->image->get_object_at_address (hint.get_address ())
+            ->is_executable ())
+    {
+      if (reg->get_origin () != Region::ANALYSIS)
+        return true;
+
+      this->insert_region (reg, Region (hint.get_address (),
+                                        reg->get_end_address ()
+                                        - hint.get_address (),
+                                        Region::UNKNOWN));
+    }
+
+  this->add_code_trace_address (hint.get_address (), TraceQueue::SYMBOL);
+  return true;
+}
+
+static bool
+region_end_less (const Region &reg, uint32_t addr)
+{
+  return reg.get_end_address () <= addr;
+}
+
+/** Applies hints before the analysis; labels do not replace existing ones.
+ */
+void
+Analyser::set_hints (const std::vector<Region> &regs,
+                     const std::vector<Label> &labs)
+{
+  size_t n;
+
+  for (n = 0; n < regs.size (); n++)
+    this->apply_region_hint (regs[n]);
+
+  this->set_labels (labs);
+}
+
+/** Updates results of earlier analysis with new hints and symbols.
+ *
+ * Only code reachable from changed labels is traced; the relocs, vtables
+ * and scans of the full analysis are not repeated. Code hinted as data
+ * takes back the guesses traced only from it. Functions which have any
+ * block in a changed place are listed as changed.
+ */
+void
+Analyser::run_incremental (const std::vector<Region> &regs,
+                           const std::vector<Label> &labs)
+{
+  std::vector<FunctionModel::Run> dropped;
+  std::vector<Label> batch;
+  std::vector<Region> changed;
+  std::vector<Region>::const_iterator citr;
+  const FunctionModel::Function *func;
+  const FunctionModel::Block *blk;
+  size_t first_run;
+  size_t n, k;
+
+  batch = labs;
+
+  if (this->symbols != NULL)
+    for (auto it = this->symbols->begin(); it != this->symbols->end(); it++)
+      {
+        const Symbol *symbol = &(*it);
+
+        batch.push_back (Label (symbol->get_address(), symbol->get_type(),
+                                symbol->get_name()));
+      }
+
+  /* Traced code which the hints turn into something else */
+  for (n = 0; n < regs.size (); n++)
+    {
+      if (regs[n].get_type () == Region::CODE)
+        continue;
+
+      for (k = 0; k < this->trace_runs->size (); k++)
+        {
+          FunctionModel::Run run = (*this->trace_runs)[k];
+
+          if (run.end <= regs[n].get_address ()
+              or run.start >= regs[n].get_end_address ())
+            continue;
+
+          run.falls_through = (run.end > regs[n].get_end_address ()
+                               or run.falls_through);
+          run.start = std::max (run.start, regs[n].get_address ());
+          run.end = std::min<uint32_t> (run.end, regs[n].get_end_address ());
+          dropped.push_back (run);
+        }
+    }
+
+  for (n = 0; n < regs.size (); n++)
+    {
+      this->apply_region_hint (regs[n]);
+      changed.push_back (regs[n]);
+    }
+
+  this->stats.withdrawn_guesses = 0;
+  this->invalidate_guesses (dropped, &changed);
+
+  this->stats.changed_labels = 0;
+
+  for (n = 0; n < batch.size (); n++)
+    {
+      if (!this->apply_label_hint (batch[n]))
+        continue;
+
+      this->stats.changed_labels++;
+      changed.push_back (Region (batch[n].get_address ()));
+    }
+
+  first_run = this->trace_runs->size ();
+
+  std::cerr << "Tracing code reachable from changed labels...\n";
+  this->begin_phase ("incremental");
+  this->trace_code ();
+
+  for (n = first_run; n < this->trace_runs->size (); n++)
+    changed.push_back (Region ((*this->trace_runs)[n].start,
+                               (*this->trace_runs)[n].end
+                               - (*this->trace_runs)[n].start));
+
+  if (this->find_duplicates)
+    {
+      std::cerr << "Hashing functions for copies...\n";
+      this->cluster_duplicates ();
+    }
+
+  this->begin_phase ("index");
+  this->xrefs.edit ()->build (&this->regions);
+  this->functions.edit ()->build (*this->trace_runs, &this->labels,
+                                 &*this->xrefs);
+  this->end_phase ();
+
+  /* Overlapping ranges are joined, so they are sorted by end as well */
+  std::sort (changed.begin (), changed.end (), region_address_less);
+
+  for (n = 0, k = 0; n < changed.size (); n++)
+    {
+      if (k > 0 and changed[n].get_address ()
+                    <= changed[k - 1].get_end_address ())
+        {
+          if (changed[n].get_end_address () > changed[k - 1].get_end_address ())
+            changed[k - 1] = Region (changed[k - 1].get_address (),
+                                     changed[n].get_end_address ()
+                                     - changed[k - 1].get_address ());
+        }
+      else
+        changed[k++] = changed[n];
+    }
+
+  changed.resize (k);
+  this->changed_functions.clear ();
+
+  for (n = 0; n < this->functions->get_function_count (); n++)
+    {
+      func = this->functions->get_function (n);
+
+      for (k = 0; k < func->blocks.size (); k++)
+        {
+          blk = this->functions->get_block (func->blocks[k]);
+          citr = std::lower_bound (changed.begin (), changed.end (),
+                                   blk->start, region_end_less);
+
+          if (citr != changed.end () and citr->get_address () < blk->end)
+            break;
+        }
+
+      if (k < func->blocks.size ())
+        this->changed_functions.push_back (func->entry);
+    }
+
+  this->stats.changed_functions = this->changed_functions.size ();
+
+  std::cerr << "Incremental analysis: " << std::dec << regs.size ()
+            << " region hint(s), " << this->stats.changed_labels
+            << " changed label(s), " << this->stats.withdrawn_guesses
+            << " guess(es) withdrawn, "
+            << this->trace_runs->size () - first_run
+            << " run(s) traced; " << this->stats.changed_functions
+            << " of " << this->functions->get_function_count ()
+            << " function(s) changed.\n";
+}
+
+const Analyser::RegionMap *
+Analyser::get_regions (void) const
+{
+  return &this->regions;
+}
+
+const Analyser::LabelMap *
+Analyser::get_labels (void) const
+{
+  return &this->labels;
+}
+
+const Label *
+Analyser::get_label (uint32_t addr) const
+{
+  Analyser::LabelMap::const_iterator itr;
+
+  itr = this->labels.find (addr);
+  if (itr == this->labels.end ())
+    return NULL;
 
   return &itr->second;
 }
+
+/** Tells whether a function was recognized as a library one. */
+bool
+Analyser::is_library_function (uint32_t addr) const
+{
+  return std::binary_search (this->library_functions.begin (),
+                             this->library_functions.end (), addr);
+}
+
+const XrefIndex *
+Analyser::get_xrefs (void) const
+{
+  return &*this->xrefs;
+}
+
+const Analyser::Stats *
+Analyser::get_stats (void) const
+{
+  return &this->stats;
+}
+
+const TraceQueue *
+Analyser::get_trace_queue (void) const
+{
+  return &this->code_trace_queue;
+}
+
+const DecodeCache *
+Analyser::get_decode_cache (void) const
+{
+  return &this->decode_cache;
+}
+
+const std::vector<FunctionHasher::Cluster> *
+Analyser::get_duplicates (void) const
+{
+  return &*this->duplicates;
+}
+
+/** Gives wall and CPU time of finished phases of the analysis. */
+const RunStats *
+Analyser::get_timings (void) const
+{
+  return &*this->timings;
+}
+
+/** Splits data regions into typed runs, for printing.
+ *
+ * To be called when regions and labels are final; the runs are not
+ * updated when they change later.
+ */
+void
+Analyser::classify_data (void)
+{
+  this->data.edit ()->build (this->image, this->le, &this->regions,
+                             &this->labels, this->thread_count);
+}
+
+/** Adds estimated memory of structures of the analysis, and of the
+ * executable, image and symbols it was given. */
+void
+Analyser::get_memory_usage (MemoryUsage *ret) const
+{
+  LabelMap::const_iterator itr;
+  size_t names;
+
+  if (this->le != NULL)
+    this->le->get_memory_usage (ret);
+
+  if (this->image != NULL)
+    this->image->get_memory_usage (ret);
+
+  if (this->symbols != NULL)
+    this->symbols->get_memory_usage (ret);
+
+  names = 0;
+  for (itr = this->labels.begin (); itr != this->labels.end (); ++itr)
+    names += itr->second.get_name_memory ();
+
+  ret->add ("regions", this->regions.size ()
+                       * tree_node_memory<RegionMap::value_type> ());
+  ret->add ("labels", this->labels.size ()
+                      * tree_node_memory<LabelMap::value_type> ());
+  ret->add ("label_names", names);
+  ret->add ("trace_queue", this->code_trace_queue.get_memory_used ());
+  ret->add ("trace_runs", vector_memory (*this->trace_runs));
+  ret->add ("relocs", vector_memory (*this->pending_relocs)
+                      + vector_memory (this->reloc_guesses));
+  ret->add ("xrefs", this->xrefs->get_memory_used ());
+  ret->add ("functions", this->functions->get_memory_used ());
+  ret->add ("data_runs", this->data->get_memory_used ());
+  ret->add ("decode_cache", this->decode_cache.get_memory_used ());
+
+  if (this->tracer)
+    ret->add ("parallel_trace", this->tracer->get_memory_used ());
+}
+
+/** Gives entries of functions changed by incremental analysis. */
+const std::vector<uint32_t> *
+Analyser::get_changed_functions (void) const
+{
+  return &this->changed_functions;
+}
+
+const FunctionModel *
+Analyser::get_function_model (void) const
+{
+  return &*this->functions;
+}
+
+const DataModel *
+Analyser::get_data_model (void) const
+{
+  return &*this->data;
+}
+
+/** Gives text of an instruction, if it was decoded with text by tracing. */
+bool
+Analyser::get_decoded_text (uint32_t addr, size_t length, Instruction *inst)
+{
+  return this->decode_cache.lookup_text (addr, length, inst);
+}
@@ -17,13 +17,28 @@
 #ifndef LEDISASM_ANALYSER_H
 #define LEDISASM_ANALYSER_H
 
-#include <deque>
 #include <inttypes.h>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "data_model.hpp"
+#include "decode_cache.hpp"
 #include "disassembler.hpp"
+#include "function_hash.hpp"
+#include "function_model.hpp"
 #include "known_file.hpp"
+#include "parallel_trace.hpp"
+#include "persistent_map.hpp"
+#include "run_stats.hpp"
+#include "signatures.hpp"
+#include "speculation.hpp"
+#include "trace_queue.hpp"
+#include "util.hpp"
+#include "value_tracker.hpp"
+#include "xrefs.hpp"
 
 class LinearExecutable;
 class Image;
@@ -34,32 +49,138 @@ class SymbolMap;
 class Analyser
 {
 public:
-  typedef std::map<uint32_t, Region> RegionMap;
-  typedef std::map<uint32_t, Label>  LabelMap;
+  typedef PersistentMap<uint32_t, Region> RegionMap;
+  typedef PersistentMap<uint32_t, Label>  LabelMap;
+  typedef RegionMap::Change RegionChange;
+  typedef LabelMap::Change  LabelChange;
+
+  /** Counters of work done by the analysis. */
+  struct Stats
+  {
+    size_t region_splits;
+    size_t region_merges;
+    size_t stale_traces;  /**< queued addresses found already traced */
+    size_t discarded_guesses;
+    size_t jump_tables;
+    size_t jump_table_cases;
+    size_t indirect_targets;  /**< from relocated immediates */
+    size_t scan_hits;
+    size_t scanned_functions;
+    size_t library_functions;
+    size_t duplicate_clusters;
+    size_t duplicate_functions;  /**< in exact clusters */
+    size_t changed_labels;       /**< by incremental analysis */
+    size_t withdrawn_guesses;    /**< labels only reached from data */
+    size_t changed_functions;
+    size_t decoded_instructions;  /**< by tracing */
+    size_t exhausted_phases;      /**< stopped by the budget */
+    size_t traced_guesses;        /**< reloc guesses and scan hits */
+  };
+
+  /** Limits of work for each phase of the analysis; zero is no limit. */
+  struct Budget
+  {
+    size_t instructions;  /**< decoded while tracing */
+    size_t guesses;       /**< reloc guesses and scan hits traced */
+    double seconds;
+  };
+
+protected:
+  /** Reloc target waiting to be investigated by trace_code(). */
+  struct PendingReloc
+  {
+    uint32_t address;
+    bool     in_data;
+  };
+
+  /** Work done by the current phase, to be checked against the budget. */
+  struct Phase
+  {
+    const char *name;
+    size_t instructions;
+    size_t guesses;
+    std::chrono::steady_clock::time_point start;
+    bool exhausted;
+  };
+
+  /** Indirect jump through a table of case addresses. */
+  struct JumpTable
+  {
+    uint32_t jump;   /**< address of the jmp instruction */
+    uint32_t table;
+    size_t   count;  /**< from bound check, or zero if unknown */
+  };
 
 protected:
   RegionMap            regions;
   LabelMap             labels;
-  std::deque<uint32_t> code_trace_queue;
+  TraceQueue           code_trace_queue;
+  TraceQueue::Confidence trace_confidence;
+  CopyOnWrite<std::vector<PendingReloc> > pending_relocs;
+  size_t               pending_relocs_pos;
+  std::vector<uint32_t> reloc_guesses;
+  CopyOnWrite<XrefIndex> xrefs;
+  Stats                stats;
   LinearExecutable    *le;
   Image               *image;
   SymbolMap           *symbols;
   Disassembler         disasm;
+  std::shared_ptr<ParallelTracer> tracer;
+  DecodeCache          decode_cache;
+  size_t               thread_count;
+  bool                 speculate;
+  bool                 scan_code;
+  std::shared_ptr<SignatureIndex> signatures;
+  std::vector<uint32_t> library_functions;
+  bool                 find_duplicates;
+  bool                 find_near_duplicates;
+  CopyOnWrite<std::vector<FunctionHasher::Cluster> > duplicates;
+  std::vector<uint32_t> changed_functions;
+  CopyOnWrite<std::vector<FunctionModel::Run> > trace_runs;
+  CopyOnWrite<FunctionModel> functions;
+  CopyOnWrite<DataModel> data;
   KnownFile::Type      known_type;
+  Budget               budget;
+  Phase                phase;
+  CopyOnWrite<RunStats> timings;
+  bool                 account_memory;
+  bool                 show_progress;
+  std::chrono::steady_clock::time_point last_progress;
 
+  friend class AnalysisDatabase;
   friend class KnownFile;
 
 protected:
   void  add_region (const Region &reg);
 
   void  add_initial_regions (void);
+  uint32_t get_entry_address (void) const;
   void  add_eip_to_labels (void);
   void  add_symbols_to_labels (void);
   void  add_labels_to_trace_queue (void);
   void  add_code_trace_address (uint32_t addr);
+  void  add_code_trace_address (uint32_t addr,
+                                TraceQueue::Confidence confidence);
+  void  add_xref (uint32_t source, uint32_t target, XrefIndex::Type type);
+
+  void  begin_phase (const char *name);
+  void  end_phase (void);
+  bool  is_over_budget (void);
+  bool  take_guess (void);
+  void  report_progress (void);
+  bool  is_verbose (void) const;
 
   void  trace_code (void);
+  bool  trace_next_pending_reloc (void);
   void  trace_code_at_address (uint32_t start_addr);
+  void  match_jump_table (uint32_t addr, const uint8_t *data, size_t size,
+                          int bound_reg, uint32_t bound, JumpTable *ret);
+  void  trace_jump_table (const JumpTable *table);
+  void  trace_indirect_target (uint32_t addr, uint32_t target,
+                               ValueTracker::Use use);
+  void  predecode_trace_queue (void);
+  void  decode_instruction (uint32_t addr, const void *data, size_t length,
+                            Instruction *inst);
 
   bool is_valid_acceptable_instruction (Instruction *inst);
 
@@ -68,10 +189,27 @@ protected:
   Region * get_region (uint32_t address);
 
   void insert_region (Region *parent, const Region &reg);
+  RegionMap::iterator insert_region (RegionMap::iterator parent,
+                                     const Region &reg);
   void check_merge_regions (uint32_t addr);
+  RegionMap::iterator merge_regions (RegionMap::iterator itr);
 
   void trace_vtables (void);
   void trace_remaining_relocs (void);
+  void trace_guesses_speculatively (void);
+  bool is_delta_applicable (const SpeculativeTracer::Delta *delta);
+  void mark_bad_run (const SpeculativeTracer::Delta *delta);
+  void trace_scanned_prologues (void);
+  void match_signatures (void);
+  void cluster_duplicates (void);
+  void set_region_type (const Region &range);
+  void clip_trace_runs (uint32_t start, uint32_t end);
+  void apply_region_hint (const Region &hint);
+  bool apply_label_hint (const Label &hint);
+  bool is_guess_orphaned (uint32_t target, bool fall_in,
+                          const std::map<uint32_t, uint32_t> &gone);
+  void invalidate_guesses (const std::vector<FunctionModel::Run> &dropped,
+                           std::vector<Region> *changed);
 
 public:
   Analyser (void);
@@ -79,21 +217,55 @@ public:
   Analyser (LinearExecutable *le, Image *img, SymbolMap *syms);
 
   Analyser &operator= (const Analyser &other);
+  void fork (Analyser *ret) const;
 
   Label * get_next_label (const Label *lab);
   Label * get_next_label (uint32_t addr);
   Region *get_next_region (const Region *reg);
 
   void insert_region (const Region &reg);
+  void insert_regions (const std::vector<Region> &regs);
   void set_label (const Label &lab);
+  void set_labels (const std::vector<Label> &labs);
   void remove_label (uint32_t addr);
   Label * improve_label (const Label &lab);
 
+  void set_thread_count (size_t count);
+  void set_speculation (bool enable);
+  void set_code_scan (bool enable);
+  void set_signatures (const std::shared_ptr<SignatureIndex> &sigs);
+  void set_duplicate_detection (bool enable, bool near);
+  void set_decode_cache_limit (size_t bytes);
+  void set_budget (const Budget &budget);
+  void set_progress (bool enable);
+  void set_memory_accounting (bool enable);
+  void set_hints (const std::vector<Region> &regs,
+                  const std::vector<Label> &labs);
   void run (void);
+  void run_incremental (const std::vector<Region> &regs,
+                        const std::vector<Label> &labs);
+  void classify_data (void);
 
   const RegionMap *  get_regions (void) const;
   const LabelMap *  get_labels (void) const;
   const Label *  get_label (uint32_t addr) const;
+  bool  is_library_function (uint32_t addr) const;
+  const XrefIndex *  get_xrefs (void) const;
+  const Stats *  get_stats (void) const;
+  const TraceQueue *  get_trace_queue (void) const;
+  const DecodeCache *  get_decode_cache (void) const;
+  const std::vector<FunctionHasher::Cluster> *  get_duplicates (void) const;
+  const FunctionModel *  get_function_model (void) const;
+  const DataModel *  get_data_model (void) const;
+  const std::vector<uint32_t> *  get_changed_functions (void) const;
+  const RunStats *  get_timings (void) const;
+  void  get_memory_usage (MemoryUsage *ret) const;
+  bool  get_decoded_text (uint32_t addr, size_t length, Instruction *inst);
+
+  static void diff (const Analyser &before, const Analyser &after,
+                    std::vector<RegionChange> *regions,
+                    std::vector<LabelChange> *labels);
+  static bool parse_budget (const std::string &spec, Budget *ret);
 };
 
 #endif // LEDISASM_ANALYSER_H
@@ -0,0 +1,360 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file analysis_db.cpp
+ *     Implementation of methods for AnalysisDatabase class.
+ * @par Purpose:
+ *     Implementation of AnalysisDatabase class methods, which save and load
+ *     regions, labels and other results of analysis.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "analyser.hpp"
+#include "analysis_db.hpp"
+#include "error.hpp"
+#include "image.hpp"
+#include "label.hpp"
+#include "regions.hpp"
+#include "util.hpp"
+
+#define DB_MAGIC "LEDB"
+
+/* Header: magic, version, fingerprint (2 dwords), known file type and
+ * amount of sections; then offset and record count of each section. */
+#define HEADER_SIZE      24
+#define SECTION_ENTRY    8
+
+static const size_t record_sizes[] = {
+  12,  /* REGIONS: address, size, type and origin */
+  12,  /* LABELS: address, type and origin, name offset */
+  1,   /* STRINGS */
+  4,   /* LIBRARY: address */
+  12,  /* XREFS: source, target, type */
+  12   /* RUNS: start, end, falls through */
+};
+
+/** Hashes layout and relocated data of all objects. */
+uint64_t
+AnalysisDatabase::get_fingerprint (const Image *image)
+{
+  const Image::Object *obj;
+  const Image::DataVector *data;
+  uint64_t hash;
+  size_t n, k;
+
+  hash = hash_step (FNV_OFFSET_BASIS, image->get_object_count ());
+
+  for (n = 0; n < image->get_object_count (); n++)
+    {
+      obj = image->get_object (n);
+      data = obj->get_data ();
+
+      hash = hash_step (hash, obj->get_base_address ());
+      hash = hash_step (hash, obj->is_executable ());
+      hash = hash_step (hash, data->size ());
+
+      for (k = 0; k < data->size (); k++)
+        hash = hash_step (hash, (*data)[k]);
+    }
+
+  return hash;
+}
+
+void
+AnalysisDatabase::put_u32 (Buffer *buf, uint32_t value)
+{
+  uint8_t bytes[4];
+
+  write_le<uint32_t> (bytes, value);
+  buf->insert (buf->end (), bytes, bytes + 4);
+}
+
+/** Finds a section of loaded file, checking it is within the file. */
+void
+AnalysisDatabase::get_section (const Buffer &file, size_t index,
+                               size_t record_size, View *ret)
+{
+  const uint8_t *entry;
+  uint32_t offset;
+
+  entry = &file[HEADER_SIZE + index * SECTION_ENTRY];
+  offset = read_le<uint32_t> (entry);
+  ret->count = read_le<uint32_t> (entry + 4);
+
+  if (offset > file.size ()
+      or ret->count > (file.size () - offset) / record_size)
+    throw Error() << "Analysis database section " << index
+                  << " is out of bounds.";
+
+  ret->data = &file[0] + offset;
+}
+
+/** Writes regions, labels and references of finished analysis. */
+void
+AnalysisDatabase::save (const Analyser *anal, const std::string &fname)
+{
+  Buffer sections[SECTION_COUNT];
+  Buffer header;
+  Analyser::RegionMap::const_iterator ritr;
+  Analyser::LabelMap::const_iterator litr;
+  const XrefIndex::Ref *refs;
+  std::ofstream ofs;
+  uint64_t fingerprint;
+  uint32_t offset;
+  size_t count;
+  size_t n, k;
+
+  for (ritr = anal->regions.begin (); ritr != anal->regions.end (); ++ritr)
+    {
+      put_u32 (&sections[REGIONS], ritr->second.get_address ());
+      put_u32 (&sections[REGIONS], ritr->second.get_size ());
+      put_u32 (&sections[REGIONS], ritr->second.get_type ()
+                                   | (ritr->second.get_origin () << 8));
+    }
+
+  /* Empty names point to the NUL at start of the pool */
+  sections[STRINGS].push_back (0);
+
+  for (litr = anal->labels.begin (); litr != anal->labels.end (); ++litr)
+    {
+      const std::string name = litr->second.get_name ();
+
+      put_u32 (&sections[LABELS], litr->first);
+      put_u32 (&sections[LABELS], litr->second.get_type ()
+                                  | (litr->second.get_origin () << 8));
+
+      if (name.empty ())
+        put_u32 (&sections[LABELS], 0);
+      else
+        {
+          put_u32 (&sections[LABELS], sections[STRINGS].size ());
+          sections[STRINGS].insert (sections[STRINGS].end (), name.begin (),
+                                    name.end ());
+          sections[STRINGS].push_back (0);
+        }
+    }
+
+  while (sections[STRINGS].size () % 4 != 0)
+    sections[STRINGS].push_back (0);
+
+  for (n = 0; n < anal->library_functions.size (); n++)
+    put_u32 (&sections[LIBRARY], anal->library_functions[n]);
+
+  for (n = 0; n < anal->xrefs->get_source_count (); n++)
+    {
+      refs = anal->xrefs->get_refs_from (anal->xrefs->get_source (n), &count);
+
+      for (k = 0; k < count; k++)
+        {
+          put_u32 (&sections[XREFS], anal->xrefs->get_source (n));
+          put_u32 (&sections[XREFS], refs[k].address);
+          put_u32 (&sections[XREFS], refs[k].type);
+        }
+    }
+
+  for (n = 0; n < anal->trace_runs->size (); n++)
+    {
+      put_u32 (&sections[RUNS], (*anal->trace_runs)[n].start);
+      put_u32 (&sections[RUNS], (*anal->trace_runs)[n].end);
+      put_u32 (&sections[RUNS], (*anal->trace_runs)[n].falls_through);
+    }
+
+  fingerprint = get_fingerprint (anal->image);
+
+  header.insert (header.end (), DB_MAGIC, DB_MAGIC + 4);
+  put_u32 (&header, VERSION);
+  put_u32 (&header, fingerprint & 0xffffffff);
+  put_u32 (&header, fingerprint >> 32);
+  put_u32 (&header, anal->known_type);
+  put_u32 (&header, SECTION_COUNT);
+
+  offset = HEADER_SIZE + SECTION_COUNT * SECTION_ENTRY;
+
+  for (n = 0; n < SECTION_COUNT; n++)
+    {
+      put_u32 (&header, offset);
+      put_u32 (&header, sections[n].size () / record_sizes[n]);
+      offset += sections[n].size ();
+    }
+
+  ofs.open (fname, std::ios::binary);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  ofs.write ((const char *) &header[0], header.size ());
+
+  for (n = 0; n < SECTION_COUNT; n++)
+    if (!sections[n].empty ())
+      ofs.write ((const char *) &sections[n][0], sections[n].size ());
+
+  if (!ofs)
+    throw Error() << "Error writing file: " << fname;
+}
+
+/** Replaces results of analysis with ones read from a file.
+ *
+ * The analyser must be made for the same executable, with the same
+ * options affecting relocation. Duplicates are searched again, if
+ * enabled, as they are not stored.
+ */
+void
+AnalysisDatabase::load (Analyser *anal, const std::string &fname)
+{
+  Buffer file;
+  View views[SECTION_COUNT];
+  std::ifstream ifs;
+  const Image::Object *obj;
+  const uint8_t *rec;
+  uint64_t fingerprint;
+  uint32_t value;
+  size_t prev_end;
+  size_t n;
+
+  ifs.open (fname, std::ios::binary);
+  if (!ifs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  file.assign (std::istreambuf_iterator<char> (ifs),
+               std::istreambuf_iterator<char> ());
+
+  if (file.size () < HEADER_SIZE
+      or memcmp (&file[0], DB_MAGIC, 4) != 0)
+    throw Error() << "Not an analysis database: " << fname;
+
+  value = read_le<uint32_t> (&file[4]);
+  if (value != VERSION)
+    throw Error() << "Analysis database " << fname << " has version "
+                  << value << ", expected " << (int) VERSION << ".";
+
+  fingerprint = read_le<uint64_t> (&file[8]);
+  if (fingerprint != get_fingerprint (anal->image))
+    throw Error() << "Analysis database " << fname
+                  << " was made for another executable.";
+
+  if (read_le<uint32_t> (&file[20]) != SECTION_COUNT
+      or file.size () < HEADER_SIZE + SECTION_COUNT * SECTION_ENTRY)
+    throw Error() << "Analysis database " << fname << " is damaged.";
+
+  for (n = 0; n < SECTION_COUNT; n++)
+    get_section (file, n, record_sizes[n], &views[n]);
+
+  if (views[STRINGS].count == 0
+      or views[STRINGS].data[views[STRINGS].count - 1] != 0)
+    throw Error() << "Analysis database " << fname
+                  << " has unterminated names.";
+
+  anal->regions.clear ();
+  prev_end = 0;
+
+  for (n = 0; n < views[REGIONS].count; n++)
+    {
+      rec = views[REGIONS].data + n * 12;
+      value = read_le<uint32_t> (rec + 8);
+
+      if ((value & 0xff) > Region::VTABLE or (value >> 8) > Region::KNOWN)
+        throw Error() << "Analysis database " << fname
+                      << " has region of unknown type " << value << ".";
+
+      Region reg (read_le<uint32_t> (rec), read_le<uint32_t> (rec + 4),
+                  (Region::Type) (value & 0xff));
+      reg.set_origin ((Region::Origin) (value >> 8));
+
+      /* Regions are saved in order, without overlaps, within objects */
+      obj = anal->image->get_object_at_address (reg.get_address ());
+      if (reg.get_size () == 0 or reg.get_address () < prev_end
+          or obj == NULL
+          or reg.get_size () > obj->get_base_address ()
+                               + obj->get_data ()->size ()
+                               - reg.get_address ())
+        throw Error() << "Analysis database " << fname << " is damaged.";
+
+      prev_end = reg.get_end_address ();
+      anal->regions[reg.get_address ()] = reg;
+    }
+
+  anal->labels.clear ();
+
+  for (n = 0; n < views[LABELS].count; n++)
+    {
+      rec = views[LABELS].data + n * 12;
+      value = read_le<uint32_t> (rec + 4);
+
+      if ((value & 0xff) > Label::DATA or (value >> 8) > Label::SCAN
+          or read_le<uint32_t> (rec + 8) >= views[STRINGS].count)
+        throw Error() << "Analysis database " << fname
+                      << " has damaged label " << n << ".";
+
+      Label lab (read_le<uint32_t> (rec), (Label::Type) (value & 0xff),
+                 (const char *) views[STRINGS].data
+                 + read_le<uint32_t> (rec + 8));
+      lab.set_origin ((Label::Origin) (value >> 8));
+      anal->labels[lab.get_address ()] = lab;
+    }
+
+  anal->library_functions.clear ();
+
+  for (n = 0; n < views[LIBRARY].count; n++)
+    anal->library_functions.push_back (
+        read_le<uint32_t> (views[LIBRARY].data + n * 4));
+
+  anal->xrefs.edit ()->clear ();
+
+  for (n = 0; n < views[XREFS].count; n++)
+    {
+      XrefIndex::Xref xref;
+
+      rec = views[XREFS].data + n * 12;
+      value = read_le<uint32_t> (rec + 8);
+
+      if (value > XrefIndex::VTABLE)
+        throw Error() << "Analysis database " << fname
+                      << " has reference of unknown type " << value << ".";
+
+      xref.source = read_le<uint32_t> (rec);
+      xref.target = read_le<uint32_t> (rec + 4);
+      xref.type = (XrefIndex::Type) value;
+      anal->xrefs.edit ()->add (xref);
+    }
+
+  anal->trace_runs.edit ()->clear ();
+
+  for (n = 0; n < views[RUNS].count; n++)
+    {
+      FunctionModel::Run run;
+
+      rec = views[RUNS].data + n * 12;
+      run.start = read_le<uint32_t> (rec);
+      run.end = read_le<uint32_t> (rec + 4);
+      run.falls_through = read_le<uint32_t> (rec + 8) != 0;
+      anal->trace_runs.edit ()->push_back (run);
+    }
+
+  anal->known_type = (KnownFile::Type) read_le<uint32_t> (&file[16]);
+
+  anal->xrefs.edit ()->build (&anal->regions);
+  anal->functions.edit ()->build (*anal->trace_runs, &anal->labels,
+                                 &*anal->xrefs);
+
+  if (anal->find_duplicates)
+    {
+      std::cerr << "Hashing functions for copies...\n";
+      anal->cluster_duplicates ();
+    }
+
+  std::cerr << "Loaded " << std::dec << anal->regions.size ()
+            << " region(s) and " << anal->labels.size ()
+            << " label(s) from analysis database.\n";
+}
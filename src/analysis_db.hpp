@@ -0,0 +1,80 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file analysis_db.hpp
+ *     Header file for analysis_db.cpp, with declaration of AnalysisDatabase.
+ * @par Purpose:
+ *     Storage for AnalysisDatabase class which writes results of analysis
+ *     into a file, and reads them back instead of analysing again.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_ANALYSIS_DB_H
+#define LEDISASM_ANALYSIS_DB_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Analyser;
+class Image;
+
+/** Analysis results kept in a file.
+ *
+ * The file starts with a header and a table of sections; each section is
+ * an array of fixed size little endian records, aligned to 4 bytes, so it
+ * can be indexed directly once the file is in memory. Label names are
+ * offsets into a pool of NUL terminated strings.
+ *
+ * The header holds a fingerprint of the relocated image, and a database
+ * is refused when loaded for another executable, or when its version
+ * differs. Cross references and functions are stored as recorded while
+ * tracing, and indexed again when loaded.
+ */
+class AnalysisDatabase
+{
+public:
+  enum
+  {
+    VERSION = 2
+  };
+
+protected:
+  enum Section
+  {
+    REGIONS,
+    LABELS,
+    STRINGS,
+    LIBRARY,
+    XREFS,
+    RUNS,
+    SECTION_COUNT
+  };
+
+  typedef std::vector<uint8_t> Buffer;
+
+  /** Section of a loaded file. */
+  struct View
+  {
+    const uint8_t *data;
+    size_t count;
+  };
+
+protected:
+  static uint64_t get_fingerprint (const Image *image);
+  static void put_u32 (Buffer *buf, uint32_t value);
+  static void get_section (const Buffer &file, size_t index,
+                           size_t record_size, View *ret);
+
+public:
+  static void save (const Analyser *anal, const std::string &fname);
+  static void load (Analyser *anal, const std::string &fname);
+};
+
+#endif // LEDISASM_ANALYSIS_DB_H
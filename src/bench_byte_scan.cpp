@@ -0,0 +1,232 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file bench_byte_scan.cpp
+ *     Benchmark of the byte scanning kernels.
+ * @par Purpose:
+ *     Times the scalar, SSE2 and AVX2 kernels finding runs of zeros and
+ *     text on buffers of zeros, of text and of both mixed with binary
+ *     bytes, and checks all kernels find the same runs.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "byte_scan.hpp"
+
+typedef std::vector<uint8_t> Buffer;
+
+static const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+/** Gives next number of a fixed sequence, so every run scans the same. */
+static uint32_t
+next_random (uint32_t *state)
+{
+  *state = *state * 1103515245 + 12345;
+  return *state >> 8;
+}
+
+static void
+fill_zero (Buffer *buf)
+{
+  std::fill (buf->begin (), buf->end (), 0);
+}
+
+static void
+fill_text (Buffer *buf)
+{
+  uint32_t state;
+  size_t n;
+
+  state = 1;
+
+  for (n = 0; n < buf->size (); n++)
+    {
+      if (next_random (&state) % 64 == 0)
+        (*buf)[n] = '\n';
+      else
+        (*buf)[n] = 0x20 + next_random (&state) % 0x5f;
+    }
+}
+
+/** Fills runs of zeros, text and binary bytes of random lengths, like
+ * data objects of an executable. */
+static void
+fill_mixed (Buffer *buf)
+{
+  uint32_t state;
+  size_t n, len;
+  size_t kind;
+
+  state = 1;
+  n = 0;
+
+  while (n < buf->size ())
+    {
+      kind = next_random (&state) % 3;
+      len = 1 + next_random (&state) % (kind == 2 ? 16 : 256);
+
+      for (; len > 0 and n < buf->size (); len--, n++)
+        {
+          if (kind == 0)
+            (*buf)[n] = 0;
+          else if (kind == 1)
+            (*buf)[n] = 0x20 + next_random (&state) % 0x5f;
+          else
+            (*buf)[n] = 0x80 | next_random (&state);
+        }
+    }
+}
+
+/** Walks the buffer as data classification does: each run of zeros or
+ * text is measured at once, other bytes are stepped over one by one.
+ * @return Amount of steps made, the same for every correct kernel.
+ */
+static uint64_t
+scan_buffer (const Buffer &buf, ScanFunc zeros, ScanFunc text)
+{
+  uint64_t steps;
+  size_t pos, n;
+
+  steps = 0;
+
+  for (pos = 0; pos < buf.size (); pos += n)
+    {
+      n = zeros (&buf[pos], buf.size () - pos);
+      if (n == 0)
+        n = text (&buf[pos], buf.size () - pos);
+      if (n == 0)
+        n = 1;
+
+      steps++;
+    }
+
+  return steps;
+}
+
+/** Times the best of given amount of rounds; gives MiB per second. */
+static double
+time_kernels (const Buffer &buf, ScanFunc zeros, ScanFunc text,
+              size_t rounds, uint64_t *steps)
+{
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> elapsed;
+  double best;
+  size_t r;
+
+  best = 0;
+  *steps = 0;
+
+  for (r = 0; r < rounds; r++)
+    {
+      start = std::chrono::steady_clock::now ();
+      *steps = scan_buffer (buf, zeros, text);
+      elapsed = std::chrono::steady_clock::now () - start;
+
+      if (r == 0 or elapsed.count () < best)
+        best = elapsed.count ();
+    }
+
+  if (best <= 0)
+    return 0;
+
+  return buf.size () / (1024.0 * 1024.0) / best;
+}
+
+int
+main (int argc, char **argv)
+{
+  void (*fills[]) (Buffer *) = { fill_zero, fill_text, fill_mixed };
+  const char *fill_names[] = { "zero", "text", "mixed" };
+  ScanFunc zeros, text;
+  ScanLevel level;
+  Buffer buf;
+  uint64_t steps, first_steps;
+  unsigned long mib, rounds;
+  double speed;
+  char *end;
+  size_t f;
+  int l;
+  bool failed;
+
+  mib = 64;
+  rounds = 5;
+
+  if (argc > 3)
+    {
+      std::cerr << "Usage: " << argv[0] << " [<MiB> [<rounds>]]\n";
+      return 1;
+    }
+
+  if (argc > 1)
+    {
+      mib = strtoul (argv[1], &end, 0);
+      if (*end != '\0' or mib == 0)
+        {
+          std::cerr << "Invalid buffer size: " << argv[1] << "\n";
+          return 1;
+        }
+    }
+
+  if (argc > 2)
+    {
+      rounds = strtoul (argv[2], &end, 0);
+      if (*end != '\0' or rounds == 0)
+        {
+          std::cerr << "Invalid amount of rounds: " << argv[2] << "\n";
+          return 1;
+        }
+    }
+
+  buf.resize (mib << 20);
+  level = get_scan_level ();
+  failed = false;
+
+  std::cout << "Buffers of " << mib << " MiB, best of " << rounds
+            << " round(s); the processor supports " << level_names[level]
+            << ".\n";
+  std::cout << std::left << std::setw (8) << "buffer" << std::setw (8)
+            << "kernel" << std::right << std::setw (12) << "MiB/s"
+            << std::setw (12) << "steps" << "\n";
+
+  for (f = 0; f < sizeof (fills) / sizeof (fills[0]); f++)
+    {
+      fills[f] (&buf);
+      first_steps = 0;
+
+      for (l = SCAN_SCALAR; l <= SCAN_AVX2; l++)
+        {
+          if (l > level or !get_scan_kernels ((ScanLevel) l, &zeros, &text))
+            continue;
+
+          speed = time_kernels (buf, zeros, text, rounds, &steps);
+
+          std::cout << std::left << std::setw (8) << fill_names[f]
+                    << std::setw (8) << level_names[l] << std::right
+                    << std::fixed << std::setprecision (1) << std::setw (12)
+                    << speed << std::setw (12) << steps << "\n";
+
+          if (l == SCAN_SCALAR)
+            first_steps = steps;
+          else if (steps != first_steps)
+            {
+              std::cerr << "Kernel " << level_names[l] << " differs from "
+                        << level_names[SCAN_SCALAR] << " on " << fill_names[f]
+                        << " buffer.\n";
+              failed = true;
+            }
+        }
+    }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file byte_scan.cpp
+ *     Implementation of scanning of runs of bytes.
+ * @par Purpose:
+ *     Scalar, SSE2 and AVX2 kernels finding length of leading zeros and
+ *     text characters; the best one for the processor is chosen when first
+ *     used. The processor check is shared with other kernels.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include "byte_scan.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define BYTE_SCAN_X86
+# include <immintrin.h>
+#endif
+
+struct ScanKernels
+{
+  ScanFunc zeros;
+  ScanFunc text;
+};
+
+/** Text is printable ASCII, tab, line feed or carriage return. */
+static inline bool
+is_text (uint8_t ch)
+{
+  return (ch >= 0x20 and ch < 0x7f) or ch == '\t' or ch == '\n'
+         or ch == '\r';
+}
+
+static size_t
+count_zeros_scalar (const uint8_t *data, size_t len)
+{
+  size_t x;
+
+  for (x = 0; x < len and data[x] == 0; x++)
+    ;
+
+  return x;
+}
+
+static size_t
+count_text_scalar (const uint8_t *data, size_t len)
+{
+  size_t x;
+
+  for (x = 0; x < len and is_text (data[x]); x++)
+    ;
+
+  return x;
+}
+
+#ifdef BYTE_SCAN_X86
+
+/* Vector loops stop at the first block with a byte out of the run; a tail
+ * shorter than a block is given to the narrower kernel. */
+
+__attribute__ ((target ("sse2")))
+static size_t
+count_zeros_sse2 (const uint8_t *data, size_t len)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i block;
+  unsigned int mask;
+  size_t x;
+
+  for (x = 0; x + 16 <= len; x += 16)
+    {
+      block = _mm_loadu_si128 ((const __m128i *) (data + x));
+      mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, zero));
+      if (mask != 0xffff)
+        return x + __builtin_ctz (~mask);
+    }
+
+  return x + count_zeros_scalar (data + x, len - x);
+}
+
+__attribute__ ((target ("sse2")))
+static size_t
+count_text_sse2 (const uint8_t *data, size_t len)
+{
+  /* Signed compares; bytes from 0x80 up are negative, so not above 0x1f */
+  const __m128i low = _mm_set1_epi8 (0x1f);
+  const __m128i high = _mm_set1_epi8 (0x7f);
+  const __m128i tab = _mm_set1_epi8 ('\t');
+  const __m128i lf = _mm_set1_epi8 ('\n');
+  const __m128i cr = _mm_set1_epi8 ('\r');
+  __m128i block;
+  __m128i text;
+  unsigned int mask;
+  size_t x;
+
+  for (x = 0; x + 16 <= len; x += 16)
+    {
+      block = _mm_loadu_si128 ((const __m128i *) (data + x));
+      text = _mm_and_si128 (_mm_cmpgt_epi8 (block, low),
+                            _mm_cmplt_epi8 (block, high));
+      text = _mm_or_si128 (text, _mm_cmpeq_epi8 (block, tab));
+      text = _mm_or_si128 (text, _mm_cmpeq_epi8 (block, lf));
+      text = _mm_or_si128 (text, _mm_cmpeq_epi8 (block, cr));
+      mask = _mm_movemask_epi8 (text);
+      if (mask != 0xffff)
+        return x + __builtin_ctz (~mask);
+    }
+
+  return x + count_text_scalar (data + x, len - x);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t
+count_zeros_avx2 (const uint8_t *data, size_t len)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i block;
+  unsigned int mask;
+  size_t x;
+
+  for (x = 0; x + 32 <= len; x += 32)
+    {
+      block = _mm256_loadu_si256 ((const __m256i *) (data + x));
+      mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, zero));
+      if (mask != 0xffffffff)
+        return x + __builtin_ctz (~mask);
+    }
+
+  return x + count_zeros_sse2 (data + x, len - x);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t
+count_text_avx2 (const uint8_t *data, size_t len)
+{
+  const __m256i low = _mm256_set1_epi8 (0x1f);
+  const __m256i high = _mm256_set1_epi8 (0x7f);
+  const __m256i tab = _mm256_set1_epi8 ('\t');
+  const __m256i lf = _mm256_set1_epi8 ('\n');
+  const __m256i cr = _mm256_set1_epi8 ('\r');
+  __m256i block;
+  __m256i text;
+  unsigned int mask;
+  size_t x;
+
+  for (x = 0; x + 32 <= len; x += 32)
+    {
+      block = _mm256_loadu_si256 ((const __m256i *) (data + x));
+      text = _mm256_and_si256 (_mm256_cmpgt_epi8 (block, low),
+                               _mm256_cmpgt_epi8 (high, block));
+      text = _mm256_or_si256 (text, _mm256_cmpeq_epi8 (block, tab));
+      text = _mm256_or_si256 (text, _mm256_cmpeq_epi8 (block, lf));
+      text = _mm256_or_si256 (text, _mm256_cmpeq_epi8 (block, cr));
+      mask = _mm256_movemask_epi8 (text);
+      if (mask != 0xffffffff)
+        return x + __builtin_ctz (~mask);
+    }
+
+  return x + count_text_sse2 (data + x, len - x);
+}
+
+#endif // BYTE_SCAN_X86
+
+static ScanLevel
+detect_scan_level (void)
+{
+#ifdef BYTE_SCAN_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2"))
+    return SCAN_AVX2;
+
+  if (__builtin_cpu_supports ("sse2"))
+    return SCAN_SSE2;
+#endif
+
+  return SCAN_SCALAR;
+}
+
+/** Gives the widest vector instructions the processor has; checked once.
+ */
+ScanLevel
+get_scan_level (void)
+{
+  static const ScanLevel level = detect_scan_level ();
+
+  return level;
+}
+
+/** Gives kernels which use given instructions, for comparing them.
+ *
+ * The processor is not checked; kernels above get_scan_level() must not
+ * be called.
+ * @return False if no such kernels are built in.
+ */
+bool
+get_scan_kernels (ScanLevel level, ScanFunc *zeros, ScanFunc *text)
+{
+  switch (level)
+    {
+    case SCAN_SCALAR:
+      *zeros = count_zeros_scalar;
+      *text = count_text_scalar;
+      return true;
+
+#ifdef BYTE_SCAN_X86
+    case SCAN_SSE2:
+      *zeros = count_zeros_sse2;
+      *text = count_text_sse2;
+      return true;
+
+    case SCAN_AVX2:
+      *zeros = count_zeros_avx2;
+      *text = count_text_avx2;
+      return true;
+#endif
+
+    default:
+      return false;
+    }
+}
+
+static ScanKernels
+select_kernels (void)
+{
+  ScanKernels ret;
+
+  ret.zeros = count_zeros_scalar;
+  ret.text = count_text_scalar;
+  get_scan_kernels (get_scan_level (), &ret.zeros, &ret.text);
+
+  return ret;
+}
+
+static const ScanKernels &
+get_kernels (void)
+{
+  static const ScanKernels kernels = select_kernels ();
+
+  return kernels;
+}
+
+/** Gives length of the run of zeros at start of given data. */
+size_t
+count_zero_bytes (const uint8_t *data, size_t len)
+{
+  return get_kernels ().zeros (data, len);
+}
+
+/** Gives length of the run of text characters at start of given data. */
+size_t
+count_text_bytes (const uint8_t *data, size_t len)
+{
+  return get_kernels ().text (data, len);
+}
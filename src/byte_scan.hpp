@@ -0,0 +1,41 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file byte_scan.hpp
+ *     Header file for byte_scan.cpp, with scanning of runs of bytes.
+ * @par Purpose:
+ *     Finds length of leading runs of zeros and of text characters, using
+ *     vector instructions when the processor has them; tells other
+ *     kernels which instructions they may use.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_BYTE_SCAN_H
+#define LEDISASM_BYTE_SCAN_H
+
+#include <inttypes.h>
+#include <cstddef>
+
+/** Widest vector instructions which scanning kernels may use. */
+enum ScanLevel
+{
+  SCAN_SCALAR,
+  SCAN_SSE2,
+  SCAN_AVX2
+};
+
+/** Gives length of the run at start of given data. */
+typedef size_t (*ScanFunc) (const uint8_t *data, size_t len);
+
+ScanLevel get_scan_level (void);
+bool get_scan_kernels (ScanLevel level, ScanFunc *zeros, ScanFunc *text);
+
+size_t count_zero_bytes (const uint8_t *data, size_t len);
+size_t count_text_bytes (const uint8_t *data, size_t len);
+
+#endif // LEDISASM_BYTE_SCAN_H
@@ -0,0 +1,322 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file code_scan.cpp
+ *     Implementation of methods for CodeScanner class.
+ * @par Purpose:
+ *     Implementation of CodeScanner class methods, which search raw bytes
+ *     of code objects for padding and function prologues.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include "byte_scan.hpp"
+#include "code_scan.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define CODE_SCAN_X86
+# include <immintrin.h>
+#endif
+
+/** Alignment of functions which are accepted without padding before. */
+#define SCAN_FRAME_ALIGN 16
+/** Alignment of functions which are accepted after a single pad byte. */
+#define SCAN_PAD_ALIGN 4
+
+static inline bool
+is_padding_byte (uint8_t b)
+{
+  return (b == 0x90 or b == 0xcc or b == 0x00);
+}
+
+static inline bool
+is_frame_at (const uint8_t *data)
+{
+  return (data[0] == 0x55
+          and ((data[1] == 0x89 and data[2] == 0xe5)
+               or (data[1] == 0x8b and data[2] == 0xec)));
+}
+
+/** Fills bitmap words of whole 32 byte blocks; gives count of bytes done.
+ *
+ * Two bytes after a block are read too, for the frame pattern.
+ */
+typedef size_t (*BlockFunc) (const uint8_t *data, size_t size,
+                             uint32_t *padding, uint32_t *frames);
+
+static size_t
+find_blocks_scalar (const uint8_t *data, size_t size,
+                    uint32_t *padding, uint32_t *frames)
+{
+  (void) data;
+  (void) size;
+  (void) padding;
+  (void) frames;
+
+  return 0;
+}
+
+#ifdef CODE_SCAN_X86
+
+__attribute__ ((target ("sse2")))
+static size_t
+find_blocks_sse2 (const uint8_t *data, size_t size,
+                  uint32_t *padding, uint32_t *frames)
+{
+  const __m128i nop  = _mm_set1_epi8 ((char) 0x90);
+  const __m128i int3 = _mm_set1_epi8 ((char) 0xcc);
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i push = _mm_set1_epi8 ((char) 0x55);
+  const __m128i mov1 = _mm_set1_epi8 ((char) 0x89);
+  const __m128i ebp1 = _mm_set1_epi8 ((char) 0xe5);
+  const __m128i mov2 = _mm_set1_epi8 ((char) 0x8b);
+  const __m128i ebp2 = _mm_set1_epi8 ((char) 0xec);
+  uint32_t pad_bits, frame_bits;
+  __m128i v0, v1, v2, m;
+  size_t half;
+  size_t pos;
+
+  for (pos = 0; pos + 32 + 2 <= size; pos += 32)
+    {
+      pad_bits = 0;
+      frame_bits = 0;
+
+      for (half = 0; half < 32; half += 16)
+        {
+          v0 = _mm_loadu_si128 ((const __m128i *) (data + pos + half));
+          v1 = _mm_loadu_si128 ((const __m128i *) (data + pos + half + 1));
+          v2 = _mm_loadu_si128 ((const __m128i *) (data + pos + half + 2));
+
+          m = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (v0, nop),
+                                          _mm_cmpeq_epi8 (v0, int3)),
+                            _mm_cmpeq_epi8 (v0, zero));
+          pad_bits |= (uint32_t) _mm_movemask_epi8 (m) << half;
+
+          m = _mm_and_si128
+                (_mm_cmpeq_epi8 (v0, push),
+                 _mm_or_si128 (_mm_and_si128 (_mm_cmpeq_epi8 (v1, mov1),
+                                              _mm_cmpeq_epi8 (v2, ebp1)),
+                               _mm_and_si128 (_mm_cmpeq_epi8 (v1, mov2),
+                                              _mm_cmpeq_epi8 (v2, ebp2))));
+          frame_bits |= (uint32_t) _mm_movemask_epi8 (m) << half;
+        }
+
+      padding[pos / 32] = pad_bits;
+      frames[pos / 32] = frame_bits;
+    }
+
+  return pos;
+}
+
+__attribute__ ((target ("avx2")))
+static size_t
+find_blocks_avx2 (const uint8_t *data, size_t size,
+                  uint32_t *padding, uint32_t *frames)
+{
+  const __m256i nop  = _mm256_set1_epi8 ((char) 0x90);
+  const __m256i int3 = _mm256_set1_epi8 ((char) 0xcc);
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i push = _mm256_set1_epi8 ((char) 0x55);
+  const __m256i mov1 = _mm256_set1_epi8 ((char) 0x89);
+  const __m256i ebp1 = _mm256_set1_epi8 ((char) 0xe5);
+  const __m256i mov2 = _mm256_set1_epi8 ((char) 0x8b);
+  const __m256i ebp2 = _mm256_set1_epi8 ((char) 0xec);
+  __m256i v0, v1, v2, m;
+  size_t pos;
+
+  for (pos = 0; pos + 32 + 2 <= size; pos += 32)
+    {
+      v0 = _mm256_loadu_si256 ((const __m256i *) (data + pos));
+      v1 = _mm256_loadu_si256 ((const __m256i *) (data + pos + 1));
+      v2 = _mm256_loadu_si256 ((const __m256i *) (data + pos + 2));
+
+      m = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (v0, nop),
+                                            _mm256_cmpeq_epi8 (v0, int3)),
+                           _mm256_cmpeq_epi8 (v0, zero));
+      padding[pos / 32] = (uint32_t) _mm256_movemask_epi8 (m);
+
+      m = _mm256_and_si256
+            (_mm256_cmpeq_epi8 (v0, push),
+             _mm256_or_si256 (_mm256_and_si256 (_mm256_cmpeq_epi8 (v1, mov1),
+                                                _mm256_cmpeq_epi8 (v2, ebp1)),
+                              _mm256_and_si256 (_mm256_cmpeq_epi8 (v1, mov2),
+                                                _mm256_cmpeq_epi8 (v2, ebp2))));
+      frames[pos / 32] = (uint32_t) _mm256_movemask_epi8 (m);
+    }
+
+  return pos;
+}
+
+#endif // CODE_SCAN_X86
+
+static BlockFunc
+select_block_kernel (void)
+{
+#ifdef CODE_SCAN_X86
+  switch (get_scan_level ())
+    {
+    case SCAN_AVX2:
+      return find_blocks_avx2;
+
+    case SCAN_SSE2:
+      return find_blocks_sse2;
+
+    default:
+      break;
+    }
+#endif
+
+  return find_blocks_scalar;
+}
+
+CodeScanner::CodeScanner (void)
+{
+  this->stats = Stats ();
+}
+
+/** Makes bitmaps of padding bytes and of stack frame setups.
+ *
+ * Bit n of word n / 32 stands for the byte at offset n. Whole blocks go
+ * through the widest kernel the processor has, chosen when first used.
+ */
+void
+CodeScanner::find_blocks (const uint8_t *data, size_t size,
+                          std::vector<uint32_t> *padding,
+                          std::vector<uint32_t> *frames)
+{
+  static const BlockFunc kernel = select_block_kernel ();
+  size_t pos;
+
+  padding->assign ((size + 31) / 32, 0);
+  frames->assign ((size + 31) / 32, 0);
+
+  if (size == 0)
+    return;
+
+  pos = kernel (data, size, &(*padding)[0], &(*frames)[0]);
+
+  for (; pos < size; pos++)
+    {
+      if (is_padding_byte (data[pos]))
+        (*padding)[pos / 32] |= 1u << (pos % 32);
+
+      if (pos + 3 <= size and is_frame_at (data + pos))
+        (*frames)[pos / 32] |= 1u << (pos % 32);
+    }
+}
+
+/** Checks for a function prologue at given bytes. */
+bool
+CodeScanner::match_prologue (const uint8_t *data, size_t size, Kind *ret)
+{
+  uint8_t seen;
+  size_t n;
+
+  if (size >= 3 and is_frame_at (data))
+    {
+      *ret = FRAME;
+      return true;
+    }
+
+  if ((size >= 3 and data[0] == 0x83 and data[1] == 0xec)
+      or (size >= 6 and data[0] == 0x81 and data[1] == 0xec))
+    {
+      *ret = SUB_ESP;
+      return true;
+    }
+
+  /* Distinct registers only, and never esp */
+  seen = 0;
+  for (n = 0; n < size and data[n] >= 0x50 and data[n] <= 0x57; n++)
+    {
+      if (data[n] == 0x54 or (seen & (1 << (data[n] - 0x50))) != 0)
+        break;
+
+      seen |= 1 << (data[n] - 0x50);
+    }
+
+  if (n >= 3)
+    {
+      *ret = PUSH_REGS;
+      return true;
+    }
+
+  return false;
+}
+
+/** Finds likely function starts within given bytes.
+ *
+ * @param address Address of the first byte; the range is expected to be
+ *     an unknown region, so its start follows code or another region.
+ */
+void
+CodeScanner::scan (const uint8_t *data, uint32_t address, size_t size,
+                   std::vector<Hit> *ret)
+{
+  std::vector<uint32_t> padding;
+  std::vector<uint32_t> frames;
+  uint32_t aligned, pad_aligned;
+  uint32_t carry, carry2;
+  uint32_t bits;
+  size_t pos;
+  size_t w;
+  Hit hit;
+
+  this->stats.bytes += size;
+  find_blocks (data, size, &padding, &frames);
+
+  /* Bits of offsets at function alignment, the same for every word */
+  aligned = 0;
+  for (pos = (SCAN_FRAME_ALIGN - address % SCAN_FRAME_ALIGN)
+             % SCAN_FRAME_ALIGN;
+       pos < 32; pos += SCAN_FRAME_ALIGN)
+    aligned |= 1u << pos;
+
+  pad_aligned = 0;
+  for (pos = (SCAN_PAD_ALIGN - address % SCAN_PAD_ALIGN) % SCAN_PAD_ALIGN;
+       pos < 32; pos += SCAN_PAD_ALIGN)
+    pad_aligned |= 1u << pos;
+
+  /* The start of range counts as if long padding was before it */
+  carry = 1;
+  carry2 = 3;
+
+  for (w = 0; w < padding.size (); w++)
+    {
+      /* First bytes after padding runs, and aligned frame setups */
+      bits = ~padding[w] & ((padding[w] << 1) | carry);
+      this->stats.padding_runs += __builtin_popcount (bits);
+
+      /* A lone pad byte, like a zero ending a string or an immediate, is
+       * too common; it counts only before an aligned address */
+      bits &= (padding[w] << 2) | carry2 | pad_aligned;
+
+      carry = padding[w] >> 31;
+      carry2 = padding[w] >> 30;
+      bits |= frames[w] & aligned;
+
+      while (bits != 0)
+        {
+          pos = w * 32 + __builtin_ctz (bits);
+          bits &= bits - 1;
+
+          if (pos >= size
+              or !match_prologue (data + pos, size - pos, &hit.kind))
+            continue;
+
+          hit.address = address + pos;
+          ret->push_back (hit);
+          this->stats.hits++;
+        }
+    }
+}
+
+const CodeScanner::Stats *
+CodeScanner::get_stats (void) const
+{
+  return &this->stats;
+}
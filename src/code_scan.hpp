@@ -0,0 +1,72 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file code_scan.hpp
+ *     Header file for code_scan.cpp, with declaration of CodeScanner class.
+ * @par Purpose:
+ *     Storage for CodeScanner class which searches raw bytes of code
+ *     objects for function prologues, to find functions nothing refers to.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_CODE_SCAN_H
+#define LEDISASM_CODE_SCAN_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+
+/** Finds likely function starts within bytes of unknown code.
+ *
+ * A prologue counts only at the start of the scanned range, right after
+ * a run of at least two padding bytes (nop, int3 or zero), after a single
+ * one at a 4 byte boundary, or, for the stack frame setup, at a 16 byte
+ * boundary. Matching is done on whole blocks of
+ * bytes at once, with SSE2 or AVX2 when the processor has them.
+ */
+class CodeScanner
+{
+public:
+  enum Kind
+  {
+    FRAME,      /**< push ebp; mov ebp,esp */
+    PUSH_REGS,  /**< three or more register pushes, as Watcom saves them */
+    SUB_ESP     /**< sub esp,imm */
+  };
+
+  struct Hit
+  {
+    uint32_t address;
+    Kind     kind;
+  };
+
+  struct Stats
+  {
+    size_t bytes;
+    size_t padding_runs;
+    size_t hits;
+  };
+
+protected:
+  Stats stats;
+
+protected:
+  static void find_blocks (const uint8_t *data, size_t size,
+                           std::vector<uint32_t> *padding,
+                           std::vector<uint32_t> *frames);
+  static bool match_prologue (const uint8_t *data, size_t size, Kind *ret);
+
+public:
+  CodeScanner (void);
+
+  void scan (const uint8_t *data, uint32_t address, size_t size,
+             std::vector<Hit> *ret);
+  const Stats *get_stats (void) const;
+};
+
+#endif // LEDISASM_CODE_SCAN_H
@@ -0,0 +1,271 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file data_model.cpp
+ *     Implementation of methods for DataModel class.
+ * @par Purpose:
+ *     Implementation of DataModel class methods, which classify contents
+ *     of data regions once, before they are printed.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+#include "byte_scan.hpp"
+#include "data_model.hpp"
+#include "image.hpp"
+#include "label.hpp"
+#include "le.hpp"
+#include "regions.hpp"
+
+static bool
+run_address_less (const DataModel::Run &run, uint32_t addr)
+{
+  return run.address < addr;
+}
+
+static bool
+run_less (const DataModel::Run &a, const DataModel::Run &b)
+{
+  return a.address < b.address;
+}
+
+static void
+add_run (std::vector<DataModel::Run> *ret, uint32_t addr, uint32_t size,
+         DataModel::Type type)
+{
+  DataModel::Run run;
+
+  run.address = addr;
+  run.size = size;
+  run.type = type;
+  ret->push_back (run);
+}
+
+DataModel::DataModel (void)
+{
+  this->stats = Stats ();
+}
+
+/** Splits one data region into runs.
+ *
+ * Raw bytes are joined into one run only within a chunk, so every label
+ * and fixup starts a new run.
+ */
+void
+DataModel::classify_region (const Input &in, const Region *reg,
+                            std::vector<Run> *ret)
+{
+  const Image::Object *obj;
+  const LEFM *fups;
+  LEFM::const_iterator fitr;
+  LabelMap::const_iterator litr;
+  const uint8_t *data;
+  uint32_t addr;
+  uint32_t base;
+  size_t len;
+  size_t x;
+  bool raw;
+
+  obj = in.image->get_object_at_address (reg->get_address ());
+  if (obj == NULL)
+    return;
+
+  base = obj->get_base_address ();
+  fups = in.le->get_fixups_for_object (obj->get_index ());
+  fitr = fups->begin ();
+  addr = reg->get_address ();
+
+  while (addr < reg->get_end_address ())
+    {
+      len = reg->get_end_address () - addr;
+
+      litr = in.labels->upper_bound (addr);
+      if (litr != in.labels->end ())
+        len = std::min<size_t> (len, litr->first - addr);
+
+      while (fitr != fups->end () and fitr->first <= addr - base)
+        ++fitr;
+
+      if (fitr != fups->end ())
+        len = std::min<size_t> (len, fitr->first - (addr - base));
+
+      /* Only the chunk start may hold a fixup */
+      if (len >= 4 and fups->find (addr - base) != fups->end ())
+        {
+          add_run (ret, addr, 4, POINTER);
+          addr += 4;
+          len -= 4;
+        }
+
+      raw = false;
+
+      while (len > 0)
+        {
+          data = obj->get_data_at (addr);
+
+          x = count_zero_bytes (data, len);
+
+          if (x >= 4)
+            {
+              add_run (ret, addr, x, ZEROS);
+              raw = false;
+              addr += x;
+              len -= x;
+              continue;
+            }
+
+          x = count_text_bytes (data, len);
+
+          if (x >= 4)
+            {
+              if (x < len and data[x] == 0)
+                add_run (ret, addr, x + 1, STRING);
+              else
+                add_run (ret, addr, x, ASCII);
+
+              raw = false;
+              addr += ret->back ().size;
+              len -= ret->back ().size;
+              continue;
+            }
+
+          if (raw)
+            ret->back ().size++;
+          else
+            add_run (ret, addr, 1, RAW);
+
+          raw = true;
+          addr++;
+          len--;
+        }
+    }
+}
+
+/** Classifies data regions which start in given object. */
+void
+DataModel::classify_object (const Input &in, size_t index,
+                            std::vector<Run> *ret)
+{
+  const Image::Object *obj;
+  RegionMap::const_iterator itr;
+  uint32_t end;
+
+  obj = in.image->get_object (index);
+  end = obj->get_base_address () + obj->get_data ()->size ();
+
+  for (itr = in.regions->lower_bound (obj->get_base_address ());
+       itr != in.regions->end () and itr->first < end; ++itr)
+    {
+      if (itr->second.get_type () == Region::DATA)
+        classify_region (in, &itr->second, ret);
+    }
+}
+
+void
+DataModel::run_worker (const Input *in,
+                       std::vector<std::vector<Run> > *objects,
+                       std::atomic<size_t> *next)
+{
+  size_t n;
+
+  while ((n = next->fetch_add (1)) < objects->size ())
+    classify_object (*in, n, &(*objects)[n]);
+}
+
+/** Classifies all data regions, using up to given amount of threads. */
+void
+DataModel::build (const Image *image, const LinearExecutable *le,
+                  const RegionMap *regions, const LabelMap *labels,
+                  size_t thread_count)
+{
+  std::vector<std::vector<Run> > objects (image->get_object_count ());
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next (0);
+  Input in;
+  size_t n, k;
+
+  this->clear ();
+
+  in.image = image;
+  in.le = le;
+  in.regions = regions;
+  in.labels = labels;
+
+  for (n = 1; n < thread_count and n < objects.size (); n++)
+    {
+      try
+        {
+          threads.push_back (std::thread (&DataModel::run_worker, &in,
+                                          &objects, &next));
+        }
+      catch (const std::system_error &)
+        {
+          break;
+        }
+    }
+
+  run_worker (&in, &objects, &next);
+
+  for (n = 0; n < threads.size (); n++)
+    threads[n].join ();
+
+  for (n = 0; n < objects.size (); n++)
+    {
+      this->runs.insert (this->runs.end (), objects[n].begin (),
+                         objects[n].end ());
+
+      for (k = 0; k < objects[n].size (); k++)
+        this->stats.runs[objects[n][k].type]++;
+    }
+
+  /* Objects are normally in address order already */
+  if (!std::is_sorted (this->runs.begin (), this->runs.end (), run_less))
+    std::sort (this->runs.begin (), this->runs.end (), run_less);
+}
+
+void
+DataModel::clear (void)
+{
+  this->runs.clear ();
+  this->stats = Stats ();
+}
+
+/** Gives index of the first run at or after given address. */
+size_t
+DataModel::find_run (uint32_t addr) const
+{
+  return std::lower_bound (this->runs.begin (), this->runs.end (), addr,
+                           run_address_less) - this->runs.begin ();
+}
+
+size_t
+DataModel::get_run_count (void) const
+{
+  return this->runs.size ();
+}
+
+const DataModel::Run *
+DataModel::get_run (size_t index) const
+{
+  return &this->runs[index];
+}
+
+const DataModel::Stats *
+DataModel::get_stats (void) const
+{
+  return &this->stats;
+}
+
+size_t
+DataModel::get_memory_used (void) const
+{
+  return this->runs.capacity () * sizeof (Run);
+}
@@ -0,0 +1,104 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file data_model.hpp
+ *     Header file for data_model.cpp, with declaration of DataModel.
+ * @par Purpose:
+ *     Storage for DataModel class which splits data regions into runs of
+ *     pointers, zero fill, strings and raw bytes.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_DATA_MODEL_H
+#define LEDISASM_DATA_MODEL_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "persistent_map.hpp"
+
+class Image;
+class Label;
+class LinearExecutable;
+class Region;
+
+/** Typed runs covering all data regions, in address order.
+ *
+ * Each region is cut at labels and fixups into chunks, and every chunk is
+ * split into runs the way they are printed: a fixup at the chunk start is
+ * a pointer, then at least four zeros are a fill, at least four printable
+ * characters are a string, and anything else is raw bytes. Objects are
+ * classified in parallel.
+ */
+class DataModel
+{
+public:
+  enum Type
+  {
+    RAW,
+    POINTER,
+    ZEROS,
+    STRING,   /**< zero terminated; size includes the terminator */
+    ASCII
+  };
+
+  struct Run
+  {
+    uint32_t address;
+    uint32_t size;
+    uint8_t  type;
+  };
+
+  struct Stats
+  {
+    size_t runs[ASCII + 1];  /**< by type */
+  };
+
+protected:
+  typedef PersistentMap<uint32_t, Region> RegionMap;
+  typedef PersistentMap<uint32_t, Label> LabelMap;
+
+  struct Input
+  {
+    const Image *image;
+    const LinearExecutable *le;
+    const RegionMap *regions;
+    const LabelMap *labels;
+  };
+
+protected:
+  std::vector<Run> runs;
+  Stats stats;
+
+protected:
+  static void classify_region (const Input &in, const Region *reg,
+                               std::vector<Run> *ret);
+  static void classify_object (const Input &in, size_t index,
+                               std::vector<Run> *ret);
+  static void run_worker (const Input *in,
+                          std::vector<std::vector<Run> > *objects,
+                          std::atomic<size_t> *next);
+
+public:
+  DataModel (void);
+
+  void build (const Image *image, const LinearExecutable *le,
+              const RegionMap *regions, const LabelMap *labels,
+              size_t thread_count);
+  void clear (void);
+
+  size_t find_run (uint32_t addr) const;
+  size_t get_run_count (void) const;
+  const Run *get_run (size_t index) const;
+  const Stats *get_stats (void) const;
+  size_t get_memory_used (void) const;
+};
+
+#endif // LEDISASM_DATA_MODEL_H
@@ -0,0 +1,265 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file decode_cache.cpp
+ *     Implementation of methods for DecodeCache class.
+ * @par Purpose:
+ *     Implementation of DecodeCache class methods, which keep instructions
+ *     decoded while tracing for reuse when printing.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <cassert>
+#include <limits>
+
+#include "decode_cache.hpp"
+#include "instruction.hpp"
+
+DecodeCache::DecodeCache (size_t memory_limit)
+{
+  this->current = NULL;
+  this->current_start = 0;
+  this->memory_used = 0;
+  this->memory_limit = memory_limit;
+  this->hint_run = this->runs.end ();
+  this->hint_index = 0;
+  this->stats = Stats ();
+}
+
+DecodeCache::DecodeCache (const DecodeCache &other)
+{
+  *this = other;
+}
+
+DecodeCache &
+DecodeCache::operator= (const DecodeCache &other)
+{
+  this->runs = other.runs;
+  this->run_order = other.run_order;
+  this->current = NULL;
+  this->current_start = 0;
+  this->memory_used = other.memory_used;
+  this->memory_limit = other.memory_limit;
+  this->hint_run = this->runs.end ();
+  this->hint_index = 0;
+  this->stats = other.stats;
+  return *this;
+}
+
+void
+DecodeCache::set_memory_limit (size_t limit)
+{
+  this->memory_limit = limit;
+  this->evict ();
+}
+
+size_t
+DecodeCache::get_memory_limit (void) const
+{
+  return this->memory_limit;
+}
+
+size_t
+DecodeCache::get_memory_used (void) const
+{
+  return this->memory_used;
+}
+
+size_t
+DecodeCache::get_run_memory (const Run *run)
+{
+  return sizeof (Run) + run->records.size () * sizeof (Record)
+         + run->text.size ();
+}
+
+/** Drops oldest runs until memory use fits the limit. */
+void
+DecodeCache::evict (void)
+{
+  RunMap::iterator itr;
+
+  while (this->memory_used > this->memory_limit
+         and !this->run_order.empty ())
+    {
+      itr = this->runs.find (this->run_order.front ());
+      this->run_order.pop_front ();
+
+      if (itr == this->runs.end () or &itr->second == this->current)
+        continue;
+
+      this->memory_used -= get_run_memory (&itr->second);
+      this->stats.evicted_runs++;
+      this->runs.erase (itr);
+    }
+
+  this->hint_run = this->runs.end ();
+}
+
+/** Starts recording a run of instructions, replacing any previous one.
+ * Nothing is recorded while the cache is disabled.
+ */
+void
+DecodeCache::begin_run (uint32_t address)
+{
+  Run *run;
+
+  assert (this->current == NULL);
+
+  if (this->memory_limit == 0)
+    return;
+
+  run = &this->runs[address];
+  this->memory_used -= get_run_memory (run);
+  run->records.clear ();
+  run->text.clear ();
+  this->memory_used += get_run_memory (run);
+
+  this->current = run;
+  this->current_start = address;
+  this->hint_run = this->runs.end ();
+}
+
+void
+DecodeCache::add (uint32_t address, Instruction *inst)
+{
+  Record rec;
+  std::string text;
+
+  if (this->current == NULL)
+    return;
+
+  text = inst->get_string ();
+  if (text.empty () or text.size () > std::numeric_limits<uint16_t>::max ())
+    return;
+
+  rec.address  = address;
+  rec.target   = inst->get_target ();
+  rec.text_pos = this->current->text.size ();
+  rec.text_len = text.size ();
+  rec.size     = inst->get_size ();
+  rec.type     = inst->get_type ();
+  rec.valid    = inst->is_valid ();
+
+  this->current->records.push_back (rec);
+  this->current->text += text;
+  this->memory_used += sizeof (Record) + text.size ();
+  this->stats.records++;
+}
+
+/** Finishes the current run; a run not kept is forgotten. */
+void
+DecodeCache::end_run (bool keep)
+{
+  if (this->current == NULL)
+    return;
+
+  if (keep and !this->current->records.empty ())
+    {
+      this->current = NULL;
+      this->run_order.push_back (this->current_start);
+      this->evict ();
+      return;
+    }
+
+  this->memory_used -= get_run_memory (this->current);
+  this->runs.erase (this->current_start);
+  this->current = NULL;
+}
+
+void
+DecodeCache::clear (void)
+{
+  assert (this->current == NULL);
+
+  this->runs.clear ();
+  this->run_order.clear ();
+  this->memory_used = 0;
+  this->hint_run = this->runs.end ();
+}
+
+/** Finds record of an instruction starting at given address.
+ *
+ * Lookups in increasing addresses, as made by the printer, continue from
+ * the previous one without searching.
+ */
+const DecodeCache::Record *
+DecodeCache::find (uint32_t address)
+{
+  RunMap::const_iterator itr;
+  const std::vector<Record> *records;
+  size_t lo, hi, mid;
+
+  itr = this->hint_run;
+  if (itr != this->runs.end ())
+    {
+      records = &itr->second.records;
+
+      if (this->hint_index < records->size ()
+          and (*records)[this->hint_index].address == address)
+        return &(*records)[this->hint_index++];
+    }
+
+  itr = this->runs.upper_bound (address);
+  if (itr == this->runs.begin ())
+    return NULL;
+
+  --itr;
+  records = &itr->second.records;
+  lo = 0;
+  hi = records->size ();
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if ((*records)[mid].address < address)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  if (lo == records->size () or (*records)[lo].address != address)
+    return NULL;
+
+  this->hint_run = itr;
+  this->hint_index = lo + 1;
+  return &(*records)[lo];
+}
+
+/** Gives an instruction with its text, if it was kept.
+ *
+ * @return False if the instruction is not recorded or does not fit within
+ *     the length; it has to be decoded then.
+ */
+bool
+DecodeCache::lookup_text (uint32_t address, size_t length, Instruction *ret)
+{
+  const Record *rec;
+  RunMap::const_iterator run;
+
+  rec = this->find (address);
+  if (rec == NULL or rec->size > length)
+    {
+      this->stats.misses++;
+      return false;
+    }
+
+  run = this->hint_run;
+  ret->string = run->second.text.substr (rec->text_pos, rec->text_len);
+  ret->size   = rec->size;
+  ret->type   = (Instruction::Type) rec->type;
+  ret->target = rec->target;
+  ret->valid  = (rec->valid != 0);
+  this->stats.hits++;
+  return true;
+}
+
+const DecodeCache::Stats *
+DecodeCache::get_stats (void) const
+{
+  return &this->stats;
+}
@@ -0,0 +1,104 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file decode_cache.hpp
+ *     Header file for decode_cache.cpp, with declaration of DecodeCache.
+ * @par Purpose:
+ *     Storage for DecodeCache class which keeps instructions decoded while
+ *     tracing, so that printing does not have to decode them again.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_DECODE_CACHE_H
+#define LEDISASM_DECODE_CACHE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class Instruction;
+
+/** Compact records of instructions, in runs as they were traced.
+ *
+ * Each run is a stream of records for instructions which were decoded by
+ * libopcodes, with their text, so the printer can use them without
+ * decoding again. Instructions decoded natively have no text and are not
+ * recorded; the printer decodes them again, which is as fast as a lookup.
+ * Once the memory limit is reached, the oldest runs are evicted. A limit
+ * of zero, the default, disables the cache.
+ */
+class DecodeCache
+{
+public:
+  struct Record
+  {
+    uint32_t address;
+    uint32_t target;
+    uint32_t text_pos;    /**< offset of text within the run */
+    uint16_t text_len;
+    uint8_t  size;
+    uint8_t  type;
+    uint8_t  valid;
+  };
+
+  struct Stats
+  {
+    size_t records;
+    size_t evicted_runs;
+    size_t hits;
+    size_t misses;
+  };
+
+protected:
+  struct Run
+  {
+    std::vector<Record> records;
+    std::string text;
+  };
+
+  typedef std::map<uint32_t, Run> RunMap;
+
+protected:
+  RunMap runs;
+  std::deque<uint32_t> run_order;
+  Run *current;
+  uint32_t current_start;
+  size_t memory_used;
+  size_t memory_limit;
+  RunMap::const_iterator hint_run;
+  size_t hint_index;
+  Stats stats;
+
+protected:
+  static size_t get_run_memory (const Run *run);
+  void evict (void);
+  const Record *find (uint32_t address);
+
+public:
+  DecodeCache (size_t memory_limit = 0);
+  DecodeCache (const DecodeCache &other);
+  DecodeCache &operator= (const DecodeCache &other);
+
+  void set_memory_limit (size_t limit);
+  size_t get_memory_limit (void) const;
+  size_t get_memory_used (void) const;
+
+  void begin_run (uint32_t address);
+  void add (uint32_t address, Instruction *inst);
+  void end_run (bool keep);
+  void clear (void);
+
+  bool lookup_text (uint32_t address, size_t length, Instruction *ret);
+
+  const Stats *get_stats (void) const;
+};
+
+#endif // LEDISASM_DECODE_CACHE_H
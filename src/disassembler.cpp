@@ -18,12 +18,14 @@
 #include <cassert>
 #include <cctype>
 #include <cstdarg>
+#include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 #include "disassembler.hpp"
 #include "instruction.hpp"
 #include "util.hpp"
+#include "x86_decoder.hpp"
 
 static std::string
 strip (std::string str)
@@ -54,6 +56,19 @@ lower (const std::string &str)
   return out;
 }
 
+static bool
+is_acceptable_text (const std::string &text)
+{
+  const char *invalids[] = {"(bad)", "ss", "gs"};
+
+  for (size_t i = 0; i < sizeof(invalids)/sizeof(invalids[0]); ++i) {
+      if (text.compare(invalids[i]) == 0) {
+          return false;
+      }
+  }
+  return true;
+}
+
 
 struct DisassemblerContext
 {
@@ -83,13 +98,19 @@ Disassembler::Disassembler (void)
 
 Disassembler::Disassembler (const Disassembler &other)
 {
+  this->info = NULL;
   *this = other;
 }
 
 Disassembler &
 Disassembler::operator= (const Disassembler &other)
 {
+  if (this == &other)
+    return *this;
+
+  delete this->info;
   this->info = new disassemble_info (*other.info);
+  this->print_insn = other.print_insn;
   return *this;
 }
 
@@ -129,6 +150,7 @@ Disassembler::disassemble (uint32_t addr, const void *data, size_t length,
   inst->size   = size;
   inst->type   = Instruction::MISC;
   inst->target = 0;
+  inst->valid  = is_acceptable_text (inst->string);
 
   if (size == 0)
     return;
@@ -141,6 +163,108 @@ Disassembler::disassemble (uint32_t addr, const void *data, size_t length,
   set_target_and_type(addr, data, inst);
 }
 
+/** Decodes an instruction with the native decoder only.
+ *
+ * @return False if the native decoder does not cover the instruction.
+ */
+bool
+Disassembler::decode_native (uint32_t addr, const void *data, size_t length,
+                             Instruction *inst)
+{
+  size_t size;
+  bool valid;
+
+  size = X86Decoder::decode_length ((const uint8_t *) data, length, &valid);
+  if (size == 0)
+    return false;
+
+  inst->string.clear ();
+  inst->size   = size;
+  inst->type   = Instruction::MISC;
+  inst->target = 0;
+  inst->valid  = valid;
+
+  if (valid)
+    set_target_and_type (addr, data, inst);
+
+  return true;
+}
+
+/** Decodes length, type and target of an instruction, without its text.
+ *
+ * Meant for code analysis; common instructions are decoded natively,
+ * the rest goes through libopcodes like in disassemble().
+ */
+void
+Disassembler::decode (uint32_t addr, const void *data, size_t length,
+                      Instruction *inst)
+{
+  assert (length > 0);
+
+  if (!this->decode_native (addr, data, length, inst))
+    {
+      this->disassemble (addr, data, length, inst);
+      return;
+    }
+
+#ifdef DEBUG
+  this->compare_decoders (addr, data, length, &std::cerr);
+#endif
+}
+
+static const char *
+get_type_name (Instruction::Type type)
+{
+  switch (type)
+    {
+    case Instruction::COND_JUMP:
+      return "cond_jump";
+    case Instruction::JUMP:
+      return "jump";
+    case Instruction::CALL:
+      return "call";
+    case Instruction::RET:
+      return "ret";
+    default:
+      return "misc";
+    }
+}
+
+/** Decodes an instruction natively and with libopcodes, and compares.
+ *
+ * Size, type, target and validity are compared; on a difference, both
+ * decodings are written to given stream.
+ * @return False if the decoders disagree; true if they agree, or the
+ *     native decoder does not cover the instruction.
+ */
+bool
+Disassembler::compare_decoders (uint32_t addr, const void *data,
+                                size_t length, std::ostream *os)
+{
+  Instruction native;
+  Instruction ref;
+
+  if (!this->decode_native (addr, data, length, &native))
+    return true;
+
+  this->disassemble (addr, data, length, &ref);
+
+  if (ref.size == native.size and ref.type == native.type
+      and ref.target == native.target and ref.valid == native.valid)
+    return true;
+
+  PUSH_IOS_FLAGS (os);
+  os->setf (std::ios::hex, std::ios::basefield);
+  *os << "Warning: Native decoder disagrees with libopcodes at 0x" << addr
+      << " (" << ref.string << "): size " << std::dec << native.size
+      << " instead of " << ref.size << ", type "
+      << get_type_name (native.type) << " instead of "
+      << get_type_name (ref.type) << ", target 0x" << std::hex
+      << native.target << " instead of 0x" << ref.target << ", valid "
+      << native.valid << " instead of " << ref.valid << ".\n";
+  return false;
+}
+
 void
 Disassembler::set_target_and_type (uint32_t addr, const void *data, Instruction *inst)
 {
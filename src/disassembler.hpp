@@ -18,6 +18,7 @@
 #define LEDISASM_DISASSEMBLER_H
 
 #include <inttypes.h>
+#include <ostream>
 #include <string>
 
 // Some versions of libopcodes require prior inclusion of config.h
@@ -42,6 +43,8 @@ protected:
   static void print_address (bfd_vma address, disassemble_info *info);
   void set_target_and_type (uint32_t addr, const void *data,
       Instruction *inst);
+  bool decode_native (uint32_t addr, const void *data, size_t length,
+                      Instruction *inst);
   
 public:
   Disassembler (void);
@@ -51,6 +54,10 @@ public:
   Instruction disassemble (uint32_t addr, const std::string &data);
   void disassemble (uint32_t addr, const void *data, size_t length,
                     Instruction *ret);
+  void decode (uint32_t addr, const void *data, size_t length,
+               Instruction *ret);
+  bool compare_decoders (uint32_t addr, const void *data, size_t length,
+                         std::ostream *os);
 };
 
 #endif // LEDISASM_DISASSEMBLER_H
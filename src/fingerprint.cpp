@@ -0,0 +1,222 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file fingerprint.cpp
+ *     Implementation of methods for RegionFingerprint class.
+ * @par Purpose:
+ *     Implementation of RegionFingerprint and FingerprintStreamBuf class
+ *     methods, which hash regions, labels and printed text of a run.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include "analyser.hpp"
+#include "error.hpp"
+#include "fingerprint.hpp"
+#include "label.hpp"
+#include "regions.hpp"
+#include "util.hpp"
+
+FingerprintStreamBuf::FingerprintStreamBuf (std::ostream *stream,
+                                            bool discard)
+{
+  this->stream = stream;
+  this->previous = stream->rdbuf (this);
+  this->target = discard ? NULL : this->previous;
+  this->hash = FNV_OFFSET_BASIS;
+}
+
+FingerprintStreamBuf::~FingerprintStreamBuf (void)
+{
+  this->stream->flush ();
+  this->stream->rdbuf (this->previous);
+}
+
+FingerprintStreamBuf::int_type
+FingerprintStreamBuf::overflow (int_type ch)
+{
+  if (traits_type::eq_int_type (ch, traits_type::eof ()))
+    return traits_type::not_eof (ch);
+
+  this->hash = hash_step (this->hash,
+                          (uint8_t) traits_type::to_char_type (ch));
+
+  if (this->target == NULL)
+    return ch;
+
+  return this->target->sputc (traits_type::to_char_type (ch));
+}
+
+std::streamsize
+FingerprintStreamBuf::xsputn (const char *s, std::streamsize n)
+{
+  std::streamsize k;
+
+  for (k = 0; k < n; k++)
+    this->hash = hash_step (this->hash, (uint8_t) s[k]);
+
+  if (this->target == NULL)
+    return n;
+
+  return this->target->sputn (s, n);
+}
+
+int
+FingerprintStreamBuf::sync (void)
+{
+  if (this->target == NULL)
+    return 0;
+
+  return this->target->pubsync ();
+}
+
+/** Takes hash of all text since the previous region ended. */
+void
+FingerprintStreamBuf::end_region (uint32_t address)
+{
+  this->regions.push_back (std::make_pair (address, this->hash));
+  this->hash = FNV_OFFSET_BASIS;
+}
+
+const FingerprintStreamBuf::HashVector *
+FingerprintStreamBuf::get_region_hashes (void) const
+{
+  return &this->regions;
+}
+
+/** Hashes every region with labels inside it; text hashes are taken from
+ * the given buffer, if the regions were printed through it. */
+void
+RegionFingerprint::compute (const Analyser *anal,
+                            const FingerprintStreamBuf *text,
+                            EntryVector *ret)
+{
+  const Analyser::RegionMap *regions;
+  const Analyser::LabelMap *labels;
+  const FingerprintStreamBuf::HashVector *texts = NULL;
+  Analyser::RegionMap::const_iterator ritr;
+  Analyser::LabelMap::const_iterator litr;
+  const Region *reg;
+  std::string name;
+  Entry entry;
+  uint64_t hash;
+  size_t n, k;
+
+  regions = anal->get_regions ();
+  labels = anal->get_labels ();
+
+  if (text != NULL)
+    texts = text->get_region_hashes ();
+
+  ret->clear ();
+  ret->reserve (regions->size ());
+  litr = labels->begin ();
+  n = 0;
+
+  for (ritr = regions->begin (); ritr != regions->end (); ++ritr, n++)
+    {
+      reg = &ritr->second;
+
+      hash = hash_step (FNV_OFFSET_BASIS, reg->get_address ());
+      hash = hash_step (hash, reg->get_size ());
+      hash = hash_step (hash, reg->get_type ());
+
+      while (litr != labels->end () and litr->first < reg->get_address ())
+        ++litr;
+
+      for (; litr != labels->end ()
+             and litr->first < reg->get_end_address (); ++litr)
+        {
+          name = litr->second.get_name ();
+
+          hash = hash_step (hash, litr->first);
+          hash = hash_step (hash, litr->second.get_type ());
+
+          for (k = 0; k < name.size (); k++)
+            hash = hash_step (hash, (uint8_t) name[k]);
+        }
+
+      entry.address = ritr->first;
+      entry.structure = hash;
+      entry.text = 0;
+
+      if (texts != NULL and n < texts->size ()
+          and (*texts)[n].first == ritr->first)
+        entry.text = (*texts)[n].second;
+
+      ret->push_back (entry);
+    }
+}
+
+/** Finds the first region which differs between two runs.
+ *
+ * @return True if a difference was found; its address is then set.
+ */
+bool
+RegionFingerprint::find_divergence (const EntryVector &first,
+                                    const EntryVector &second,
+                                    uint32_t *address)
+{
+  size_t n;
+
+  for (n = 0; n < first.size () and n < second.size (); n++)
+    {
+      if (first[n].address != second[n].address)
+        {
+          *address = std::min (first[n].address, second[n].address);
+          return true;
+        }
+
+      if (first[n].structure != second[n].structure
+          or first[n].text != second[n].text)
+        {
+          *address = first[n].address;
+          return true;
+        }
+    }
+
+  if (n < first.size ())
+    {
+      *address = first[n].address;
+      return true;
+    }
+
+  if (n < second.size ())
+    {
+      *address = second[n].address;
+      return true;
+    }
+
+  return false;
+}
+
+/** Writes one line per region: address, structure hash and text hash. */
+void
+RegionFingerprint::save (const EntryVector &entries, const std::string &fname)
+{
+  std::ofstream ofs;
+  size_t n;
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    throw Error () << "Error opening file: " << fname;
+
+  PUSH_IOS_FLAGS (&ofs);
+  ofs.setf (std::ios::hex, std::ios::basefield);
+  ofs << std::setfill ('0');
+
+  ofs << "# le_disasm region fingerprints: address structure text\n";
+
+  for (n = 0; n < entries.size (); n++)
+    ofs << std::setw (8) << entries[n].address << " "
+        << std::setw (16) << entries[n].structure << " "
+        << std::setw (16) << entries[n].text << "\n";
+}
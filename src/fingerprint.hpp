@@ -0,0 +1,81 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file fingerprint.hpp
+ *     Header file for fingerprint.cpp, with declaration of RegionFingerprint.
+ * @par Purpose:
+ *     Storage for RegionFingerprint class which hashes the result of a run
+ *     per region, so that runs can be compared cheaply.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_FINGERPRINT_H
+#define LEDISASM_FINGERPRINT_H
+
+#include <inttypes.h>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Analyser;
+
+/** Stream buffer hashing output of a stream, while installed on it.
+ *
+ * Output is passed on to the previous buffer of the stream, or dropped if
+ * asked to; it is given back to the stream on destruction. The hash is
+ * taken and restarted at the end of each printed region.
+ */
+class FingerprintStreamBuf : public std::streambuf
+{
+public:
+  typedef std::vector<std::pair<uint32_t, uint64_t> > HashVector;
+
+protected:
+  std::ostream *stream;
+  std::streambuf *previous;
+  std::streambuf *target;  /**< NULL if output is dropped */
+  uint64_t hash;
+  HashVector regions;
+
+protected:
+  virtual int_type overflow (int_type ch);
+  virtual std::streamsize xsputn (const char *s, std::streamsize n);
+  virtual int sync (void);
+
+public:
+  FingerprintStreamBuf (std::ostream *stream, bool discard);
+  virtual ~FingerprintStreamBuf (void);
+
+  void end_region (uint32_t address);
+  const HashVector *get_region_hashes (void) const;
+};
+
+/** Hashes of each region: its bounds, type and labels, and its text. */
+class RegionFingerprint
+{
+public:
+  struct Entry
+  {
+    uint32_t address;
+    uint64_t structure;
+    uint64_t text;  /**< zero if the region was not printed */
+  };
+
+  typedef std::vector<Entry> EntryVector;
+
+public:
+  static void compute (const Analyser *anal,
+                       const FingerprintStreamBuf *text, EntryVector *ret);
+  static bool find_divergence (const EntryVector &first,
+                               const EntryVector &second, uint32_t *address);
+  static void save (const EntryVector &entries, const std::string &fname);
+};
+
+#endif // LEDISASM_FINGERPRINT_H
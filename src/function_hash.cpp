@@ -0,0 +1,250 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file function_hash.cpp
+ *     Implementation of methods for FunctionHasher class.
+ * @par Purpose:
+ *     Implementation of FunctionHasher class methods, which hash code of
+ *     functions and group functions of equal hashes.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+#include "function_hash.hpp"
+#include "image.hpp"
+#include "le.hpp"
+#include "util.hpp"
+#include "x86_decoder.hpp"
+
+FunctionHasher::FunctionHasher (const Image *image, const LinearExecutable *le,
+                                size_t thread_count, bool near)
+{
+  this->image = image;
+  this->le = le;
+  this->thread_count = std::max (thread_count, (size_t) 1);
+  this->near = near;
+}
+
+/** Hashes code of a function; masked bytes are hashed as a value no byte
+ * can have.
+ */
+void
+FunctionHasher::hash_function (std::vector<uint8_t> *relocated,
+                               Function *func) const
+{
+  const Image::Object *obj;
+  const LEFM *fixups;
+  LEFM::const_iterator itr;
+  const uint8_t *data;
+  uint32_t offset;
+  uint64_t hash;
+  size_t operands;
+  size_t pos, len, n;
+  bool valid;
+
+  obj = this->image->get_object_at_address (func->address);
+  data = obj->get_data_at (func->address);
+  offset = func->address - obj->get_base_address ();
+  fixups = this->le->get_fixups_for_object (obj->get_index ());
+
+  relocated->assign (func->size, 0);
+  itr = fixups->lower_bound (offset >= 3 ? offset - 3 : 0);
+
+  for (; itr != fixups->end () and itr->first < offset + func->size; ++itr)
+    for (n = std::max (itr->first, offset);
+         n < itr->first + 4 and n < offset + func->size; n++)
+      (*relocated)[n - offset] = 1;
+
+  hash = hash_step (FNV_OFFSET_BASIS, func->size);
+  for (pos = 0; pos < func->size; pos++)
+    hash = hash_step (hash, (*relocated)[pos] ? 0x100 : data[pos]);
+
+  func->exact = hash;
+  func->near = 0;
+
+  if (!this->near)
+    return;
+
+  hash = hash_step (FNV_OFFSET_BASIS, func->size);
+
+  for (pos = 0; pos < func->size; pos += len)
+    {
+      len = X86Decoder::decode_length (data + pos, func->size - pos, &valid,
+                                       &operands);
+
+      /* Not known to the decoder; the rest is hashed unmasked */
+      if (len == 0)
+        {
+          len = func->size - pos;
+          operands = len;
+        }
+
+      for (n = 0; n < len; n++)
+        hash = hash_step (hash, ((*relocated)[pos + n] or n >= operands)
+                                ? 0x100 : data[pos + n]);
+    }
+
+  func->near = hash;
+}
+
+void
+FunctionHasher::run_worker (std::vector<Function> *funcs,
+                            std::atomic<size_t> *next) const
+{
+  std::vector<uint8_t> relocated;
+  size_t n;
+
+  while ((n = next->fetch_add (1)) < funcs->size ())
+    this->hash_function (&relocated, &(*funcs)[n]);
+}
+
+/** Fills hashes of given functions, which have address and size set. */
+void
+FunctionHasher::hash (std::vector<Function> *funcs) const
+{
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next (0);
+  size_t n;
+
+  for (n = 1; n < this->thread_count and n < funcs->size (); n++)
+    {
+      try
+        {
+          threads.push_back (std::thread (&FunctionHasher::run_worker,
+                                          this, funcs, &next));
+        }
+      catch (const std::system_error &)
+        {
+          break;
+        }
+    }
+
+  this->run_worker (funcs, &next);
+
+  for (n = 0; n < threads.size (); n++)
+    threads[n].join ();
+}
+
+static uint64_t
+get_hash (const FunctionHasher::Function *func, FunctionHasher::Kind kind)
+{
+  return (kind == FunctionHasher::EXACT) ? func->exact : func->near;
+}
+
+/** Orders functions by size and hash, then by address. */
+struct FunctionOrder
+{
+  FunctionHasher::Kind kind;
+
+  FunctionOrder (FunctionHasher::Kind kind) : kind (kind) {}
+
+  bool
+  operator() (const FunctionHasher::Function *a,
+              const FunctionHasher::Function *b) const
+  {
+    if (a->size != b->size)
+      return a->size < b->size;
+
+    if (get_hash (a, this->kind) != get_hash (b, this->kind))
+      return get_hash (a, this->kind) < get_hash (b, this->kind);
+
+    return a->address < b->address;
+  }
+};
+
+/** Groups functions of equal size and hash.
+ *
+ * Near clusters whose functions are all exact copies of each other are
+ * left out, as they are reported as exact ones already.
+ */
+void
+FunctionHasher::cluster (const std::vector<Function> &funcs, Kind kind,
+                         std::vector<Cluster> *ret)
+{
+  std::vector<const Function *> order;
+  size_t first, end, n;
+  bool distinct;
+
+  for (n = 0; n < funcs.size (); n++)
+    order.push_back (&funcs[n]);
+
+  std::sort (order.begin (), order.end (), FunctionOrder (kind));
+
+  for (first = 0; first < order.size (); first = end)
+    {
+      distinct = false;
+
+      for (end = first + 1; end < order.size (); end++)
+        {
+          if (order[end]->size != order[first]->size
+              or get_hash (order[end], kind) != get_hash (order[first], kind))
+            break;
+
+          if (order[end]->exact != order[first]->exact)
+            distinct = true;
+        }
+
+      if (end - first < 2 or (kind == NEAR and !distinct))
+        continue;
+
+      Cluster clu;
+      clu.kind = kind;
+      clu.size = order[first]->size;
+
+      for (n = first; n < end; n++)
+        clu.functions.push_back (order[n]->address);
+
+      ret->push_back (clu);
+    }
+}
+
+static bool
+cluster_less (const FunctionHasher::Cluster &a,
+              const FunctionHasher::Cluster &b)
+{
+  if (a.kind != b.kind)
+    return a.kind < b.kind;
+
+  return a.functions[0] < b.functions[0];
+}
+
+/** Gives clusters of copies, exact ones first, each in address order. */
+void
+FunctionHasher::find_clusters (const std::vector<Function> &funcs,
+                               std::vector<Cluster> *ret) const
+{
+  ret->clear ();
+  cluster (funcs, EXACT, ret);
+
+  if (this->near)
+    cluster (funcs, NEAR, ret);
+
+  std::sort (ret->begin (), ret->end (), cluster_less);
+}
+
+std::ostream &
+operator<< (std::ostream &os, FunctionHasher::Kind kind)
+{
+  switch (kind)
+    {
+    case FunctionHasher::EXACT:
+      os << "exact";
+      break;
+    case FunctionHasher::NEAR:
+      os << "near";
+      break;
+    default:
+      os << "(unknown " << std::dec << (int) kind << ")";
+      break;
+    }
+
+  return os;
+}
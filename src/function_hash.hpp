@@ -0,0 +1,87 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file function_hash.hpp
+ *     Header file for function_hash.cpp, with declaration of FunctionHasher.
+ * @par Purpose:
+ *     Storage for FunctionHasher class which finds functions made of the
+ *     same code, to group copies of a function together.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_FUNCTION_HASH_H
+#define LEDISASM_FUNCTION_HASH_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+class Image;
+class LinearExecutable;
+
+/** Hashes code of functions with parts which differ between copies masked.
+ *
+ * Exact hashes cover all bytes of a function, except dwords changed by
+ * fixups, so copies which refer to different data still match. Near hashes
+ * also mask displacements and immediates of every instruction, including
+ * branch offsets, so copies which differ only by constants match as well.
+ * Functions are hashed in parallel; 64-bit hashes are trusted not to
+ * collide.
+ */
+class FunctionHasher
+{
+public:
+  enum Kind
+  {
+    EXACT,
+    NEAR
+  };
+
+  struct Function
+  {
+    uint32_t address;
+    uint32_t size;
+    uint64_t exact;
+    uint64_t near;
+  };
+
+  /** Functions of the same size and hash, in address order. */
+  struct Cluster
+  {
+    Kind kind;
+    uint32_t size;
+    std::vector<uint32_t> functions;
+  };
+
+protected:
+  const Image *image;
+  const LinearExecutable *le;
+  size_t thread_count;
+  bool near;
+
+protected:
+  void hash_function (std::vector<uint8_t> *relocated, Function *func) const;
+  void run_worker (std::vector<Function> *funcs,
+                   std::atomic<size_t> *next) const;
+  static void cluster (const std::vector<Function> &funcs, Kind kind,
+                       std::vector<Cluster> *ret);
+
+public:
+  FunctionHasher (const Image *image, const LinearExecutable *le,
+                  size_t thread_count, bool near);
+
+  void hash (std::vector<Function> *funcs) const;
+  void find_clusters (const std::vector<Function> &funcs,
+                      std::vector<Cluster> *ret) const;
+};
+
+std::ostream &operator<< (std::ostream &os, FunctionHasher::Kind kind);
+
+#endif // LEDISASM_FUNCTION_HASH_H
@@ -0,0 +1,433 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file function_model.cpp
+ *     Implementation of methods for FunctionModel class.
+ * @par Purpose:
+ *     Implementation of FunctionModel class methods, which partition traced
+ *     code into functions and make the call graph.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+
+#include "function_model.hpp"
+#include "label.hpp"
+#include "memory_usage.hpp"
+#include "xrefs.hpp"
+
+typedef std::pair<uint32_t, uint32_t> Edge;
+
+const uint32_t FunctionModel::NONE;
+
+const uint32_t *
+FunctionModel::Graph::get (size_t index, size_t *count) const
+{
+  *count = this->offsets[index + 1] - this->offsets[index];
+  return &this->targets.front () + this->offsets[index];
+}
+
+/** Makes CSR adjacency of given amount of nodes from sorted edges. */
+static void
+make_graph (size_t nodes, const std::vector<Edge> &edges,
+            std::vector<uint32_t> *offsets, std::vector<uint32_t> *targets)
+{
+  size_t n, e;
+
+  offsets->assign (nodes + 1, 0);
+  targets->clear ();
+  targets->reserve (edges.size () + 1);
+
+  for (n = 0, e = 0; n < nodes; n++)
+    {
+      (*offsets)[n] = targets->size ();
+
+      for (; e < edges.size () and edges[e].first == n; e++)
+        targets->push_back (edges[e].second);
+    }
+
+  (*offsets)[nodes] = targets->size ();
+
+  /* Keeps front () valid for nodes without edges */
+  targets->push_back (FunctionModel::NONE);
+}
+
+FunctionModel::FunctionModel (void)
+{
+  this->clear ();
+}
+
+void
+FunctionModel::clear (void)
+{
+  this->blocks.clear ();
+  this->functions.clear ();
+  make_graph (0, std::vector<Edge> (), &this->callees.offsets,
+              &this->callees.targets);
+  make_graph (0, std::vector<Edge> (), &this->callers.offsets,
+              &this->callers.targets);
+  this->stats = Stats ();
+}
+
+static bool
+run_less (const FunctionModel::Run &a, const FunctionModel::Run &b)
+{
+  return a.start < b.start;
+}
+
+/** Splits runs into blocks at function and jump labels. */
+void
+FunctionModel::make_blocks (const std::vector<Run> &runs,
+                            const PersistentMap<uint32_t, Label> *labels)
+{
+  std::vector<Run> sorted;
+  PersistentMap<uint32_t, Label>::const_iterator itr;
+  Block blk;
+  size_t n;
+
+  sorted = runs;
+  std::sort (sorted.begin (), sorted.end (), run_less);
+
+  blk.function = NONE;
+  blk.shared = false;
+
+  for (n = 0; n < sorted.size (); n++)
+    {
+      blk.start = sorted[n].start;
+      itr = labels->upper_bound (blk.start);
+
+      for (; itr != labels->end () and itr->first < sorted[n].end; ++itr)
+        {
+          if (itr->second.get_type () != Label::FUNCTION
+              and itr->second.get_type () != Label::JUMP)
+            continue;
+
+          blk.end = itr->first;
+          blk.falls_through = true;
+          this->blocks.push_back (blk);
+          blk.start = itr->first;
+        }
+
+      blk.end = sorted[n].end;
+      blk.falls_through = sorted[n].falls_through;
+      this->blocks.push_back (blk);
+    }
+}
+
+static bool
+block_start_less (uint32_t addr, const FunctionModel::Block &blk)
+{
+  return addr < blk.start;
+}
+
+/** Gives index of the block containing an address, or NONE. */
+size_t
+FunctionModel::find_block (uint32_t addr) const
+{
+  std::vector<Block>::const_iterator itr;
+
+  itr = std::upper_bound (this->blocks.begin (), this->blocks.end (), addr,
+                          block_start_less);
+  if (itr == this->blocks.begin ())
+    return NONE;
+
+  --itr;
+  if (itr->end <= addr)
+    return NONE;
+
+  return itr - this->blocks.begin ();
+}
+
+static bool
+function_entry_less (const FunctionModel::Function &func, uint32_t addr)
+{
+  return func.entry < addr;
+}
+
+/** Gives index of the function of given entry, or NONE. */
+size_t
+FunctionModel::find_function (uint32_t entry) const
+{
+  std::vector<Function>::const_iterator itr;
+
+  itr = std::lower_bound (this->functions.begin (), this->functions.end (),
+                          entry, function_entry_less);
+  if (itr == this->functions.end () or itr->entry != entry)
+    return NONE;
+
+  return itr - this->functions.begin ();
+}
+
+/** Makes successors of blocks, and calls from blocks to functions. */
+void
+FunctionModel::make_edges (const XrefIndex *xrefs, Graph *succ,
+                           std::vector<Edge> *calls)
+{
+  std::vector<Edge> edges;
+  const XrefIndex::Ref *refs;
+  uint32_t source;
+  size_t blk, target;
+  size_t count;
+  size_t n, k;
+
+  for (n = 0; n + 1 < this->blocks.size (); n++)
+    {
+      if (this->blocks[n].falls_through
+          and this->blocks[n + 1].start == this->blocks[n].end)
+        edges.push_back (Edge (n, n + 1));
+    }
+
+  for (n = 0; n < xrefs->get_source_count (); n++)
+    {
+      source = xrefs->get_source (n);
+      blk = this->find_block (source);
+      if (blk == NONE)
+        continue;
+
+      refs = xrefs->get_refs_from (source, &count);
+
+      for (k = 0; k < count; k++)
+        {
+          switch (refs[k].type)
+            {
+            case XrefIndex::CALL:
+              target = this->find_function (refs[k].address);
+              if (target != NONE)
+                calls->push_back (Edge (blk, target));
+              break;
+
+            case XrefIndex::JUMP:
+            case XrefIndex::COND_JUMP:
+              target = this->find_block (refs[k].address);
+              if (target != NONE
+                  and this->blocks[target].start == refs[k].address)
+                edges.push_back (Edge (blk, target));
+              break;
+
+            default:
+              break;
+            }
+        }
+    }
+
+  std::sort (edges.begin (), edges.end ());
+  edges.erase (std::unique (edges.begin (), edges.end ()), edges.end ());
+  make_graph (this->blocks.size (), edges, &succ->offsets, &succ->targets);
+}
+
+/** Gives blocks to functions, by walking from each entry in address order.
+ */
+void
+FunctionModel::partition (const Graph &succ)
+{
+  std::vector<uint32_t> entry_of;
+  std::vector<uint32_t> visited;
+  std::vector<uint32_t> stack;
+  const uint32_t *next;
+  Function *func;
+  size_t count;
+  size_t f, n;
+  uint32_t blk;
+
+  entry_of.assign (this->blocks.size (), NONE);
+  visited.assign (this->blocks.size (), NONE);
+
+  for (f = 0; f < this->functions.size (); f++)
+    entry_of[this->find_block (this->functions[f].entry)] = f;
+
+  for (f = 0; f < this->functions.size (); f++)
+    {
+      func = &this->functions[f];
+      stack.push_back (this->find_block (func->entry));
+
+      while (!stack.empty ())
+        {
+          blk = stack.back ();
+          stack.pop_back ();
+
+          if (visited[blk] == f)
+            continue;
+
+          visited[blk] = f;
+
+          if (this->blocks[blk].function == NONE)
+            {
+              this->blocks[blk].function = f;
+              func->blocks.push_back (blk);
+              func->size += this->blocks[blk].end - this->blocks[blk].start;
+            }
+          else
+            {
+              this->blocks[blk].shared = true;
+              func->shared.push_back (blk);
+            }
+
+          next = succ.get (blk, &count);
+
+          for (n = 0; n < count; n++)
+            {
+              if (entry_of[next[n]] != NONE and entry_of[next[n]] != f)
+                func->tail_calls.push_back (entry_of[next[n]]);
+              else
+                stack.push_back (next[n]);
+            }
+        }
+
+      std::sort (func->blocks.begin (), func->blocks.end ());
+      std::sort (func->shared.begin (), func->shared.end ());
+      std::sort (func->tail_calls.begin (), func->tail_calls.end ());
+      func->tail_calls.erase (std::unique (func->tail_calls.begin (),
+                                           func->tail_calls.end ()),
+                              func->tail_calls.end ());
+      this->stats.tail_calls += func->tail_calls.size ();
+    }
+
+  for (n = 0; n < this->blocks.size (); n++)
+    {
+      if (this->blocks[n].function == NONE)
+        this->stats.orphan_blocks++;
+      else if (this->blocks[n].shared)
+        this->stats.shared_blocks++;
+    }
+}
+
+/** Makes the call graph from calls of blocks, given to their owners. */
+void
+FunctionModel::make_call_graph (std::vector<Edge> *calls)
+{
+  std::vector<Edge> edges;
+  size_t n;
+
+  for (n = 0; n < calls->size (); n++)
+    {
+      if (this->blocks[(*calls)[n].first].function != NONE)
+        edges.push_back (Edge (this->blocks[(*calls)[n].first].function,
+                               (*calls)[n].second));
+    }
+
+  std::sort (edges.begin (), edges.end ());
+  edges.erase (std::unique (edges.begin (), edges.end ()), edges.end ());
+  make_graph (this->functions.size (), edges, &this->callees.offsets,
+              &this->callees.targets);
+  this->stats.call_edges = edges.size ();
+
+  for (n = 0; n < edges.size (); n++)
+    std::swap (edges[n].first, edges[n].second);
+
+  std::sort (edges.begin (), edges.end ());
+  make_graph (this->functions.size (), edges, &this->callers.offsets,
+              &this->callers.targets);
+}
+
+/** Makes functions and call graph from scratch.
+ *
+ * @param runs Runs of code made by tracing; they must not overlap.
+ * @param xrefs References, already built.
+ */
+void
+FunctionModel::build (const std::vector<Run> &runs,
+                      const PersistentMap<uint32_t, Label> *labels,
+                      const XrefIndex *xrefs)
+{
+  PersistentMap<uint32_t, Label>::const_iterator itr;
+  std::vector<Edge> calls;
+  Graph succ;
+  size_t blk;
+
+  this->clear ();
+  this->make_blocks (runs, labels);
+
+  for (itr = labels->begin (); itr != labels->end (); ++itr)
+    {
+      if (itr->second.get_type () != Label::FUNCTION)
+        continue;
+
+      blk = this->find_block (itr->first);
+      if (blk == NONE or this->blocks[blk].start != itr->first)
+        continue;
+
+      Function func;
+      func.entry = itr->first;
+      func.size = 0;
+      this->functions.push_back (func);
+    }
+
+  this->make_edges (xrefs, &succ, &calls);
+  this->partition (succ);
+  this->make_call_graph (&calls);
+  this->stats.blocks = this->blocks.size ();
+}
+
+size_t
+FunctionModel::get_function_count (void) const
+{
+  return this->functions.size ();
+}
+
+const FunctionModel::Function *
+FunctionModel::get_function (size_t index) const
+{
+  return &this->functions[index];
+}
+
+const FunctionModel::Function *
+FunctionModel::get_function_at (uint32_t entry) const
+{
+  size_t index;
+
+  index = this->find_function (entry);
+  if (index == NONE)
+    return NULL;
+
+  return &this->functions[index];
+}
+
+const FunctionModel::Block *
+FunctionModel::get_block (size_t index) const
+{
+  return &this->blocks[index];
+}
+
+const uint32_t *
+FunctionModel::get_callees (size_t index, size_t *count) const
+{
+  return this->callees.get (index, count);
+}
+
+const uint32_t *
+FunctionModel::get_callers (size_t index, size_t *count) const
+{
+  return this->callers.get (index, count);
+}
+
+const FunctionModel::Stats *
+FunctionModel::get_stats (void) const
+{
+  return &this->stats;
+}
+
+/** Gives memory of blocks, functions and the call graph, in bytes. */
+size_t
+FunctionModel::get_memory_used (void) const
+{
+  size_t bytes;
+  size_t n;
+
+  bytes = vector_memory (this->blocks) + vector_memory (this->functions)
+          + vector_memory (this->callees.offsets)
+          + vector_memory (this->callees.targets)
+          + vector_memory (this->callers.offsets)
+          + vector_memory (this->callers.targets);
+
+  for (n = 0; n < this->functions.size (); n++)
+    bytes += vector_memory (this->functions[n].blocks)
+             + vector_memory (this->functions[n].shared)
+             + vector_memory (this->functions[n].tail_calls);
+
+  return bytes;
+}
@@ -0,0 +1,127 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file function_model.hpp
+ *     Header file for function_model.cpp, with declaration of FunctionModel.
+ * @par Purpose:
+ *     Storage for FunctionModel class which partitions traced code into
+ *     functions made of blocks, and keeps the call graph between them.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_FUNCTION_MODEL_H
+#define LEDISASM_FUNCTION_MODEL_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "persistent_map.hpp"
+
+class Label;
+class XrefIndex;
+
+/** Functions and call graph, made from traced runs and references.
+ *
+ * Each linear run of traced code is split at labels into blocks, which
+ * are entered only at their start. Blocks are given to functions by
+ * walking jumps and fall-through from each function entry; a block
+ * reached from more than one function is owned by the first one, in
+ * address order, and shared with the others. Jumps and fall-through to
+ * an entry of another function are tail calls.
+ *
+ * The call graph is kept in compressed sparse row layout, both ways;
+ * functions are referred to by their index, in address order.
+ */
+class FunctionModel
+{
+public:
+  /** Linear run of instructions, as traced. */
+  struct Run
+  {
+    uint32_t start;
+    uint32_t end;
+    bool     falls_through;  /**< did not end with jmp or ret */
+  };
+
+  struct Block
+  {
+    uint32_t start;
+    uint32_t end;
+    uint32_t function;       /**< index of the owner, or NONE */
+    bool     falls_through;
+    bool     shared;
+  };
+
+  struct Function
+  {
+    uint32_t entry;
+    size_t   size;                     /**< bytes in owned blocks */
+    std::vector<uint32_t> blocks;      /**< owned, in address order */
+    std::vector<uint32_t> shared;      /**< owned by other functions */
+    std::vector<uint32_t> tail_calls;  /**< indices of functions */
+  };
+
+  struct Stats
+  {
+    size_t blocks;
+    size_t shared_blocks;
+    size_t orphan_blocks;  /**< reached from no function entry */
+    size_t tail_calls;
+    size_t call_edges;
+  };
+
+  static const uint32_t NONE = 0xffffffff;
+
+protected:
+  /** Adjacency lists in CSR layout, indexed by function. */
+  struct Graph
+  {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> targets;
+
+    const uint32_t *get (size_t index, size_t *count) const;
+  };
+
+protected:
+  std::vector<Block> blocks;
+  std::vector<Function> functions;
+  Graph callees;
+  Graph callers;
+  Stats stats;
+
+protected:
+  void make_blocks (const std::vector<Run> &runs,
+                    const PersistentMap<uint32_t, Label> *labels);
+  size_t find_block (uint32_t addr) const;
+  size_t find_function (uint32_t entry) const;
+  void make_edges (const XrefIndex *xrefs, Graph *succ,
+                   std::vector<std::pair<uint32_t, uint32_t> > *calls);
+  void partition (const Graph &succ);
+  void make_call_graph (std::vector<std::pair<uint32_t, uint32_t> > *calls);
+
+public:
+  FunctionModel (void);
+
+  void build (const std::vector<Run> &runs,
+              const PersistentMap<uint32_t, Label> *labels,
+              const XrefIndex *xrefs);
+  void clear (void);
+
+  size_t get_function_count (void) const;
+  const Function *get_function (size_t index) const;
+  const Function *get_function_at (uint32_t entry) const;
+  const Block *get_block (size_t index) const;
+  const uint32_t *get_callees (size_t index, size_t *count) const;
+  const uint32_t *get_callers (size_t index, size_t *count) const;
+  const Stats *get_stats (void) const;
+  size_t get_memory_used (void) const;
+};
+
+#endif // LEDISASM_FUNCTION_MODEL_H
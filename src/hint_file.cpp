@@ -0,0 +1,110 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file hint_file.cpp
+ *     Implementation of methods for HintFile class.
+ * @par Purpose:
+ *     Implementation of HintFile class methods, which parse the file of
+ *     regions and labels given by the user.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "error.hpp"
+#include "hint_file.hpp"
+
+static bool
+parse_number (const std::string &str, uint32_t *ret)
+{
+  unsigned long value;
+  char *end;
+
+  if (str.empty ())
+    return false;
+
+  value = strtoul (str.c_str (), &end, 0);
+  if (*end != '\0' or value > 0xffffffffUL)
+    return false;
+
+  *ret = value;
+  return true;
+}
+
+/** Parses one line which is not empty nor a comment. */
+bool
+HintFile::parse_line (const std::string &line, std::vector<Region> *regions,
+                      std::vector<Label> *labels)
+{
+  std::istringstream iss (line);
+  std::string kind, first, second, rest;
+  uint32_t addr, size;
+
+  iss >> kind >> first >> second >> rest;
+
+  if (!rest.empty () or !parse_number (first, &addr))
+    return false;
+
+  if (kind == "data" or kind == "vtable")
+    {
+      if (!parse_number (second, &size) or size == 0
+          or addr + size < addr)
+        return false;
+
+      regions->push_back (Region (addr, size, (kind == "data")
+                                              ? Region::DATA
+                                              : Region::VTABLE));
+      return true;
+    }
+
+  if (kind == "function" or kind == "jump")
+    {
+      labels->push_back (Label (addr, (kind == "function")
+                                      ? Label::FUNCTION : Label::JUMP,
+                                second));
+      return true;
+    }
+
+  return false;
+}
+
+void
+HintFile::load (const std::string &fname, std::vector<Region> *regions,
+                std::vector<Label> *labels)
+{
+  std::ifstream ifs;
+  std::string line;
+  size_t start, end;
+  size_t line_no;
+
+  ifs.open (fname);
+  if (!ifs.is_open ())
+    throw Error () << "Error opening file: " << fname;
+
+  line_no = 0;
+
+  while (std::getline (ifs, line))
+    {
+      line_no++;
+
+      end = line.find ('#');
+      if (end != std::string::npos)
+        line.erase (end);
+
+      start = line.find_first_not_of (" \t\r");
+      if (start == std::string::npos)
+        continue;
+
+      if (!parse_line (line, regions, labels))
+        throw Error () << "Invalid hint at " << fname << ":" << line_no
+                       << ".";
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file hint_file.hpp
+ *     Header file for hint_file.cpp, with declaration of HintFile.
+ * @par Purpose:
+ *     Storage for HintFile class which reads regions and labels given by
+ *     the user, to be applied on top of the analysis.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_HINT_FILE_H
+#define LEDISASM_HINT_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "label.hpp"
+#include "regions.hpp"
+
+/** Text file of hints, one per line.
+ *
+ * Lines are `data ADDRESS SIZE` or `vtable ADDRESS SIZE` for regions, and
+ * `function ADDRESS [NAME]` or `jump ADDRESS [NAME]` for labels. Numbers
+ * may be decimal or hexadecimal with 0x prefix; `#` starts a comment.
+ * These are the same kinds of hints which KnownFile has built in.
+ */
+class HintFile
+{
+protected:
+  static bool parse_line (const std::string &line,
+                          std::vector<Region> *regions,
+                          std::vector<Label> *labels);
+
+public:
+  static void load (const std::string &fname, std::vector<Region> *regions,
+                    std::vector<Label> *labels);
+};
+
+#endif // LEDISASM_HINT_FILE_H
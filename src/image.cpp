@@ -17,6 +17,7 @@
 #include <cstddef>
 
 #include "image.hpp"
+#include "memory_usage.hpp"
 
 Image::Object::Object (size_t index, uint32_t base_address, bool executable,
                        const DataVector *data)
@@ -88,6 +89,20 @@ Image::get_object_count (void) const
   return this->objects.size ();
 }
 
+/** Adds memory of relocated data of all objects. */
+void
+Image::get_memory_usage (MemoryUsage *ret) const
+{
+  size_t bytes;
+  size_t n;
+
+  bytes = vector_memory (this->objects);
+  for (n = 0; n < this->objects.size (); n++)
+    bytes += vector_memory (this->objects[n].data);
+
+  ret->add ("image_data", bytes);
+}
+
 const Image::Object *
 Image::get_object_at_address (uint32_t address) const
 {
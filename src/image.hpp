@@ -21,6 +21,8 @@
 #include <cstddef>
 #include <vector>
 
+struct MemoryUsage;
+
 class Image
 {
 public:
@@ -57,6 +59,7 @@ public:
   const Object *get_object (size_t index) const;
   const Object *get_object_at_address (uint32_t address) const;
   size_t get_object_count (void) const;
+  void get_memory_usage (MemoryUsage *ret) const;
 };
 
 #endif // LEDISASM_IMAGE_H
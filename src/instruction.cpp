@@ -39,3 +39,15 @@ Instruction::get_size (void)
 {
   return this->size;
 }
+
+/** Says whether the instruction was decoded and is acceptable as code.
+ *
+ * Some byte sequences are decoded by the library, but are not something
+ * a compiler would ever emit (ie. a lone segment prefix); these are
+ * treated as invalid too.
+ */
+bool
+Instruction::is_valid (void)
+{
+  return this->valid;
+}
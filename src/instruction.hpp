@@ -24,6 +24,8 @@ struct Instruction
 {
 protected:
   friend class Disassembler;
+  friend class DecodeCache;
+  friend class ParallelTracer;
 
 public:
   enum Type
@@ -40,12 +42,14 @@ protected:
   std::string string;
   uint32_t    target;
   size_t      size;
+  bool        valid;
 
 public:
   Type        get_type (void);
   std::string get_string (void);
   uint32_t    get_target (void);
   size_t      get_size (void);
+  bool        is_valid (void);
 };
 
 #endif // LEDISASM_INSTRUCTION_H
@@ -14,6 +14,8 @@
  *     the Free Software Foundation; either version 2 of the License, or
  *     (at your option) any later version.
  */
+#include <vector>
+
 #include "known_file.hpp"
 #include "analyser.hpp"
 #include "label.hpp"
@@ -74,71 +76,81 @@ void
 KnownFile::pre_anal_fixups_apply(Analyser &anal)
 {
   const char *ident_str = NULL;
+  std::vector<Region> regions;
+  std::vector<Label> labels;
+  size_t n;
 
   switch (anal.known_type)
     {
     case KnownFile::KNOWN_SYNDWARS_FINAL_MAIN:
       ident_str = "Syndicate Wars Final `main.exe`";
-      anal.insert_region (Region (0x0e581e,   0x76, Region::DATA));
-      anal.insert_region (Region (0x0e5af1,    0xf, Region::DATA));
-      anal.insert_region (Region (0x0e73e2,   0x4e, Region::DATA));
-      anal.insert_region (Region (0x0ea128,  0x202, Region::DATA));
-      anal.insert_region (Region (0x10ae19,   0x25, Region::DATA));
-      anal.insert_region (Region (0x10aeb5,   0x25, Region::DATA));
-      anal.insert_region (Region (0x117830,  0x200, Region::DATA));
-      anal.insert_region (Region (0x1233f3,   0x40, Region::DATA));
-      anal.insert_region (Region (0x12b3d0, 0x2450, Region::DATA));
-      anal.set_label (Label (0x03cd08, Label::JUMP));
-      anal.set_label (Label (0x03fdc8, Label::JUMP));
-      anal.set_label (Label (0x035644, Label::JUMP));
-      anal.set_label (Label (0x13c443, Label::JUMP));
-      anal.set_label (Label (0x140096, Label::FUNCTION));
+      regions.push_back (Region (0x0e581e,   0x76, Region::DATA));
+      regions.push_back (Region (0x0e5af1,    0xf, Region::DATA));
+      regions.push_back (Region (0x0e73e2,   0x4e, Region::DATA));
+      regions.push_back (Region (0x0ea128,  0x202, Region::DATA));
+      regions.push_back (Region (0x10ae19,   0x25, Region::DATA));
+      regions.push_back (Region (0x10aeb5,   0x25, Region::DATA));
+      regions.push_back (Region (0x117830,  0x200, Region::DATA));
+      regions.push_back (Region (0x1233f3,   0x40, Region::DATA));
+      regions.push_back (Region (0x12b3d0, 0x2450, Region::DATA));
+      labels.push_back (Label (0x03cd08, Label::JUMP));
+      labels.push_back (Label (0x03fdc8, Label::JUMP));
+      labels.push_back (Label (0x035644, Label::JUMP));
+      labels.push_back (Label (0x13c443, Label::JUMP));
+      labels.push_back (Label (0x140096, Label::FUNCTION));
       break;
     case KnownFile::KNOWN_SYNDPLUS_FINAL_MAIN:
       ident_str = "Syndicate Plus Final `main.exe`";
-      anal.insert_region (Region (0x014550,  0x018, Region::VTABLE));
-      anal.insert_region (Region (0x014568,  0x0ac, Region::VTABLE));
-      anal.insert_region (Region (0x015C0C,  0x034, Region::VTABLE));
-      anal.insert_region (Region (0x015C40,  0x020, Region::VTABLE));
-      anal.insert_region (Region (0x016508,  0x040, Region::VTABLE));
-      anal.insert_region (Region (0x0175B0,  0x010, Region::VTABLE));
-      anal.insert_region (Region (0x018238,  0x010, Region::VTABLE));
-      anal.insert_region (Region (0x01BE1C,   0x9c, Region::VTABLE));
-      anal.insert_region (Region (0x01D390,  0x0a8, Region::VTABLE));
-      anal.insert_region (Region (0x01D438,  0x014, Region::VTABLE));
-      anal.insert_region (Region (0x01FB50,   0x64, Region::VTABLE));
-      anal.insert_region (Region (0x025830,  0x0b4, Region::VTABLE));
-      anal.insert_region (Region (0x025920,  0x0ec, Region::VTABLE));
-      anal.insert_region (Region (0x026EB0,  0x034, Region::VTABLE));
-      anal.insert_region (Region (0x029760,  0x030, Region::VTABLE));
-      anal.insert_region (Region (0x02C340,  0x044, Region::VTABLE));
-      anal.insert_region (Region (0x02F980,  0x010, Region::VTABLE));
-      anal.insert_region (Region (0x02FCE0,  0x040, Region::VTABLE));
-      anal.insert_region (Region (0x02FE2C,  0x040, Region::VTABLE));
-      anal.insert_region (Region (0x0312F8,  0x044, Region::VTABLE));
-      anal.insert_region (Region (0x0346C0,  0x020, Region::VTABLE));
-      anal.insert_region (Region (0x034A70,  0x020, Region::VTABLE));
-      anal.insert_region (Region (0x034AB0,  0x020, Region::VTABLE));
-      anal.insert_region (Region (0x0375C0,  0x010, Region::VTABLE));
-      anal.insert_region (Region (0x0375D0,  0x030, Region::VTABLE));
-      anal.insert_region (Region (0x040431,   0x25, Region::DATA)); // CSTRING
-      anal.insert_region (Region (0x0404FB,   0x25, Region::DATA)); // CSTRING
-      anal.insert_region (Region (0x04225E,  0x044, Region::VTABLE));
-      anal.insert_region (Region (0x042ADE,   0x08, Region::DATA));
-      anal.insert_region (Region (0x042AE6,   0x08, Region::DATA));
-      anal.insert_region (Region (0x043992,   0x10, Region::VTABLE));
-      anal.insert_region (Region (0x048794,   0x10, Region::VTABLE));
-      anal.insert_region (Region (0x0488BD,   0x10, Region::VTABLE));
-      anal.insert_region (Region (0x0489CC,   0x10, Region::VTABLE));
-      anal.insert_region (Region (0x04A3A7,   0x10, Region::VTABLE));
-      anal.insert_region (Region (0x04FC81,   0x40, Region::DATA));
-      anal.insert_region (Region (0x04FD30,  0x028, Region::DATA));
-      anal.insert_region (Region (0x04FDA3,  0x028, Region::DATA));
-      anal.insert_region (Region (0x04FDE4,  0x010, Region::DATA)); // CSTRING
+      regions.push_back (Region (0x014550,  0x018, Region::VTABLE));
+      regions.push_back (Region (0x014568,  0x0ac, Region::VTABLE));
+      regions.push_back (Region (0x015C0C,  0x034, Region::VTABLE));
+      regions.push_back (Region (0x015C40,  0x020, Region::VTABLE));
+      regions.push_back (Region (0x016508,  0x040, Region::VTABLE));
+      regions.push_back (Region (0x0175B0,  0x010, Region::VTABLE));
+      regions.push_back (Region (0x018238,  0x010, Region::VTABLE));
+      regions.push_back (Region (0x01BE1C,   0x9c, Region::VTABLE));
+      regions.push_back (Region (0x01D390,  0x0a8, Region::VTABLE));
+      regions.push_back (Region (0x01D438,  0x014, Region::VTABLE));
+      regions.push_back (Region (0x01FB50,   0x64, Region::VTABLE));
+      regions.push_back (Region (0x025830,  0x0b4, Region::VTABLE));
+      regions.push_back (Region (0x025920,  0x0ec, Region::VTABLE));
+      regions.push_back (Region (0x026EB0,  0x034, Region::VTABLE));
+      regions.push_back (Region (0x029760,  0x030, Region::VTABLE));
+      regions.push_back (Region (0x02C340,  0x044, Region::VTABLE));
+      regions.push_back (Region (0x02F980,  0x010, Region::VTABLE));
+      regions.push_back (Region (0x02FCE0,  0x040, Region::VTABLE));
+      regions.push_back (Region (0x02FE2C,  0x040, Region::VTABLE));
+      regions.push_back (Region (0x0312F8,  0x044, Region::VTABLE));
+      regions.push_back (Region (0x0346C0,  0x020, Region::VTABLE));
+      regions.push_back (Region (0x034A70,  0x020, Region::VTABLE));
+      regions.push_back (Region (0x034AB0,  0x020, Region::VTABLE));
+      regions.push_back (Region (0x0375C0,  0x010, Region::VTABLE));
+      regions.push_back (Region (0x0375D0,  0x030, Region::VTABLE));
+      regions.push_back (Region (0x040431,   0x25, Region::DATA)); // CSTRING
+      regions.push_back (Region (0x0404FB,   0x25, Region::DATA)); // CSTRING
+      regions.push_back (Region (0x04225E,  0x044, Region::VTABLE));
+      regions.push_back (Region (0x042ADE,   0x08, Region::DATA));
+      regions.push_back (Region (0x042AE6,   0x08, Region::DATA));
+      regions.push_back (Region (0x043992,   0x10, Region::VTABLE));
+      regions.push_back (Region (0x048794,   0x10, Region::VTABLE));
+      regions.push_back (Region (0x0488BD,   0x10, Region::VTABLE));
+      regions.push_back (Region (0x0489CC,   0x10, Region::VTABLE));
+      regions.push_back (Region (0x04A3A7,   0x10, Region::VTABLE));
+      regions.push_back (Region (0x04FC81,   0x40, Region::DATA));
+      regions.push_back (Region (0x04FD30,  0x028, Region::DATA));
+      regions.push_back (Region (0x04FDA3,  0x028, Region::DATA));
+      regions.push_back (Region (0x04FDE4,  0x010, Region::DATA)); // CSTRING
       break;
     case KnownFile::NOT_KNOWN:
       break;
     }
+  for (n = 0; n < regions.size (); n++)
+    regions[n].set_origin (Region::KNOWN);
+
+  /* Hints are merged in one pass each, same as when set one by one */
+  anal.insert_regions (regions);
+  anal.set_labels (labels);
+
   if (ident_str != NULL)
     std::cerr << "Known file: " << ident_str << ".\n";
 }
@@ -16,6 +16,7 @@
 #include <iostream>
 
 #include "label.hpp"
+#include "memory_usage.hpp"
 #include "util.hpp"
 
 Label::Label (uint32_t address, Label::Type type,
@@ -24,6 +25,7 @@ Label::Label (uint32_t address, Label::Type type,
   this->address = address;
   this->name    = name;
   this->type    = type;
+  this->origin  = ANALYSIS;
 }
 
 Label::Label (void)
@@ -31,6 +33,7 @@ Label::Label (void)
   this->address = 0;
   this->name    = "";
   this->type    = UNKNOWN;
+  this->origin  = ANALYSIS;
 }
 
 Label::Label (const Label &other)
@@ -67,6 +70,25 @@ Label::get_name (void) const
   return this->name;
 }
 
+Label::Origin
+Label::get_origin (void) const
+{
+  return this->origin;
+}
+
+void
+Label::set_origin (Label::Origin origin)
+{
+  this->origin = origin;
+}
+
+/** Gives heap memory used by the name. */
+size_t
+Label::get_name_memory (void) const
+{
+  return string_memory (this->name);
+}
+
 std::ostream &
 operator<< (std::ostream &os, const Label &label)
 {
@@ -36,10 +36,18 @@ public:
     DATA
   };
 
+  /** How the label was found. */
+  enum Origin
+  {
+    ANALYSIS,  /**< from symbols, tracing or relocs */
+    SCAN       /**< from scanning unknown code for prologues */
+  };
+
 protected:
   uint32_t address;
   std::string name;
   Label::Type type;
+  Label::Origin origin;
 
 public:
   Label (uint32_t address, Label::Type type = UNKNOWN,
@@ -50,6 +58,9 @@ public:
   virtual uint32_t  get_address (void) const;
   virtual Label::Type  get_type (void) const;
   virtual std::string  get_name (void) const;
+  Label::Origin  get_origin (void) const;
+  void  set_origin (Label::Origin origin);
+  size_t  get_name_memory (void) const;
 
   void improve_from (const Label &lab);
 };
@@ -20,6 +20,7 @@
 
 #include "le.hpp"
 #include "error.hpp"
+#include "memory_usage.hpp"
 #include "util.hpp"
 
 using std::cerr;
@@ -591,6 +592,25 @@ LinearExecutable::get_fixup_addresses (void) const
   return &this->fixup_addresses;
 }
 
+/** Adds estimated memory of object tables and fixups. */
+void
+LinearExecutable::get_memory_usage (MemoryUsage *ret) const
+{
+  size_t fixups;
+  size_t n;
+
+  fixups = vector_memory (this->fixups);
+  for (n = 0; n < this->fixups.size (); n++)
+    fixups += this->fixups[n].size ()
+              * tree_node_memory<FixupMap::value_type> ();
+
+  ret->add ("le_objects", vector_memory (this->objects)
+                          + vector_memory (this->object_pages));
+  ret->add ("le_fixups", fixups);
+  ret->add ("le_fixup_addresses", this->fixup_addresses.size ()
+                                  * tree_node_memory<uint32_t> ());
+}
+
 size_t
 LinearExecutable::get_object_count (void) const
 {
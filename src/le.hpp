@@ -26,6 +26,8 @@
 
 #include "util.hpp"
 
+struct MemoryUsage;
+
 class LinearExecutable
 {
 public:
@@ -149,6 +151,8 @@ public:
   const ObjectPageHeader *get_page_header (size_t index) const;
   size_t                  get_page_file_offset (size_t index) const;
 
+  void                    get_memory_usage (MemoryUsage *ret) const;
+
   static LinearExecutable *load (std::istream *is,
                                  const std::string &name = "stream");
 };
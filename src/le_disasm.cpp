@@ -16,14 +16,20 @@
  *     (at your option) any later version.
  */
 #include <cassert>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <getopt.h>
 
 #include "analyser.hpp"
+#include "analysis_db.hpp"
+#include "disassembler.hpp"
 #include "error.hpp"
+#include "fingerprint.hpp"
+#include "hint_file.hpp"
 #include "image.hpp"
 #include "instruction.hpp"
 #include "known_file.hpp"
@@ -31,7 +37,10 @@
 #include "le.hpp"
 #include "le_image.hpp"
 #include "regions.hpp"
+#include "run_stats.hpp"
+#include "signatures.hpp"
 #include "symbol_map.hpp"
+#include "trace_events.hpp"
 #include "util.hpp"
 
 using std::ios;
@@ -39,6 +48,40 @@ using std::ios;
 struct Options {
   std::string exefile;
   std::string mapfile;
+  std::string xreffile;
+  unsigned long jobs;
+  bool speculate;
+  bool scan_code;
+  unsigned long cache_mb;
+  std::string sigfile;
+  bool collapse_library;
+  std::string dupfile;
+  bool near_duplicates;
+  std::string graphfile;
+  std::string save_db;
+  std::string load_db;
+  std::string hintfile;
+  Analyser::Budget budget;
+  bool progress;
+  std::string statsfile;
+  std::string tracefile;
+  bool deterministic_check;
+  std::string fingerprintfile;
+  bool verify_decoder;
+  bool changed_only;
+
+  Options () : jobs (1), speculate (false), scan_code (true), cache_mb (0),
+    collapse_library (false), near_duplicates (false), budget (),
+    progress (false),
+    deterministic_check (false), verify_decoder (false),
+    changed_only (false) {}
+};
+
+/** Counters of printing, for run statistics. */
+struct PrintStats
+{
+  size_t instructions;
+  size_t decoded;  /**< not kept from tracing, so decoded again */
 };
 
 static void
@@ -99,6 +142,9 @@ print_label (const Label *lab)
       std::cout << "\t/* " << lab->get_address () << " */";
     }
 
+  if (lab->get_origin () == Label::SCAN)
+    std::cout << "\t/* found by code scan */";
+
   std::cout << '\n';
 
   switch (lab->get_type ())
@@ -204,77 +250,6 @@ print_instruction (Instruction *inst, Image *img, LinearExecutable *le,
     std::cout << "\n";
 }
 
-static bool
-data_is_address (const Image::Object *obj, uint32_t addr, size_t len,
-                 LinearExecutable *le)
-{
-  uint32_t offset;
-  const LEFM *fups;
-
-  if (len < 4)
-    return false;
-
-  fups = le->get_fixups_for_object (obj->get_index ());
-  offset = addr - obj->get_base_address ();
-
-  if (fups->find (offset) == fups->end ())
-    return false;
-
-  return true;
-}
-
-static bool
-data_is_zeros (const Image::Object *obj, uint32_t addr, size_t len, size_t *rlen)
-{
-  size_t x;
-  const uint8_t *data;
-
-  data = obj->get_data_at (addr);
-
-  for (x = 0; x < len; x++)
-    {
-      if (data[x] != 0)
-        break;
-    }
-
-  if (x < 4)
-    return false;
-
-  *rlen = x;
-  return true;
-}
-
-static bool
-data_is_string (const Image::Object *obj, uint32_t addr, size_t len, size_t *rlen,
-                bool *zero_terminated)
-{
-  size_t x;
-  const uint8_t *data;
-
-  data = obj->get_data_at (addr);
-
-  for (x = 0; x < len; x++)
-    {
-      if ((data[x] < 0x20 or data[x] >= 0x7f)
-          and not (data[x] == '\t' or data[x] == '\n' or data[x] == '\r'))
-        break;
-    }
-
-  if (x < 4)
-    return false;
-
-  if (x < len and data[x] == 0)
-    {
-      *zero_terminated = true;
-      x += 1;
-    }
-  else
-    *zero_terminated = false;
-
-  *rlen = x;
-  return true;
-}
-
 static void
 print_escaped_string (const uint8_t *data, size_t len)
 {
@@ -297,16 +272,117 @@ print_escaped_string (const uint8_t *data, size_t len)
     }
 }
 
+/** Prints code of a library function as bytes, without disassembling it.
+ *
+ * Labels within the function, and addresses of fixups, are still printed,
+ * so the output reassembles the same.
+ * @return Address after the function.
+ */
+static uint32_t
+print_collapsed_function (uint32_t addr, uint32_t end_addr,
+                          const Image::Object *obj, LinearExecutable *le,
+                          Analyser *anal)
+{
+  const Label *label;
+  const LEFM *fups;
+  LEFM::const_iterator itr;
+  uint32_t func_addr;
+  uint32_t chunk_end;
+  const uint8_t *data;
+  char buffer[8];
+  size_t n;
+
+  label = anal->get_next_label (addr);
+  while (label != NULL and label->get_address () < end_addr
+         and label->get_type () != Label::FUNCTION)
+    label = anal->get_next_label (label);
+
+  if (label != NULL and label->get_address () < end_addr)
+    end_addr = label->get_address ();
+
+  {
+    PUSH_IOS_FLAGS (&std::cout);
+    std::cout.setf (ios::dec, ios::basefield);
+    std::cout << "\t\t/* library function, " << (end_addr - addr)
+              << " bytes not disassembled */\n";
+  }
+
+  fups = le->get_fixups_for_object (obj->get_index ());
+  itr = fups->lower_bound (addr - obj->get_base_address ());
+  func_addr = addr;
+
+  while (addr < end_addr)
+    {
+      if (addr != func_addr)
+        {
+          label = anal->get_label (addr);
+          if (label != NULL)
+            print_label (label);
+        }
+
+      if (itr != fups->end ()
+          and itr->first == addr - obj->get_base_address ()
+          and end_addr - addr >= 4)
+        {
+          uint32_t value;
+
+          value = read_le<uint32_t> (obj->get_data_at (addr));
+          label = anal->get_label (value);
+          if (label != NULL)
+            std::cout << "\t\t.long   " << *label << "\n";
+          else
+            {
+              PUSH_IOS_FLAGS (&std::cout);
+              std::cout.setf (ios::hex, ios::basefield);
+              std::cout.setf (ios::showbase);
+              std::cout << "\t\t.long   " << value << "\n";
+            }
+
+          addr += 4;
+          ++itr;
+          continue;
+        }
+
+      chunk_end = std::min<uint32_t> (end_addr, addr + 8);
+
+      label = anal->get_next_label (addr);
+      if (label != NULL and label->get_address () < chunk_end)
+        chunk_end = label->get_address ();
+
+      while (itr != fups->end ()
+             and itr->first <= addr - obj->get_base_address ())
+        ++itr;
+
+      if (itr != fups->end ()
+          and itr->first + obj->get_base_address () < chunk_end)
+        chunk_end = itr->first + obj->get_base_address ();
+
+      data = obj->get_data_at (addr);
+      std::cout << "\t\t.byte   ";
+
+      for (n = 0; n < chunk_end - addr; n++)
+        {
+          snprintf (buffer, sizeof (buffer), "%s0x%02x", (n > 0 ? ", " : ""),
+                    data[n]);
+          std::cout << buffer;
+        }
+
+      std::cout << "\n";
+      addr = chunk_end;
+    }
+
+  return addr;
+}
+
 static void
 print_region (const Region *reg, const Image::Object *obj, LinearExecutable *le,
-              Image *img, Analyser *anal)
+              Image *img, Analyser *anal, Disassembler *disasm,
+              bool collapse_library, PrintStats *pstats)
 {
   const Label *label;
   size_t addr;
   int bytes_in_line;
-  Disassembler disasm;
   Instruction inst;
-  LEFM::const_iterator itr;
   bool warn_once;
 
 #ifdef DEBUG
@@ -326,28 +402,48 @@ print_region (const Region *reg, const Image::Object *obj, LinearExecutable *le,
           if (label != NULL)
             print_label (label);
 
-          disasm.disassemble (addr, obj->get_data_at (addr),
-                              reg->get_end_address () - addr, &inst);
+          if (collapse_library and label != NULL
+              and label->get_type () == Label::FUNCTION
+              and anal->is_library_function (addr))
+            {
+              addr = print_collapsed_function (addr, reg->get_end_address (),
+                                               obj, le, anal);
+              continue;
+            }
+
+          if (!anal->get_decoded_text (addr, reg->get_end_address () - addr,
+                                       &inst))
+            {
+              disasm->disassemble (addr, obj->get_data_at (addr),
+                                   reg->get_end_address () - addr, &inst);
+              pstats->decoded++;
+            }
           print_instruction (&inst, img, le, anal);
+          pstats->instructions++;
 
           addr += inst.get_size ();
         }
       break;
 
     case Region::DATA:
-      size_t len;
-      size_t size;
+      const DataModel *model;
+      const DataModel::Run *run;
       const Label *label;
-      const LEFM *fups;
-      bool zt;
+      const uint8_t *data;
+      size_t n, k;
 
       bytes_in_line = 0;
+      model = anal->get_data_model ();
 
-      fups = le->get_fixups_for_object (obj->get_index ());
-      itr = fups->begin ();
-
-      while (addr < reg->get_end_address ())
+      for (n = model->find_run (addr); n < model->get_run_count (); n++)
         {
+          run = model->get_run (n);
+          if (run->address >= reg->get_end_address ())
+            break;
+
+          addr = run->address;
+          data = obj->get_data_at (addr);
+
           label = anal->get_label (addr);
           if (label != NULL)
             {
@@ -360,111 +456,77 @@ print_region (const Region *reg, const Image::Object *obj, LinearExecutable *le,
               print_label (label);
             }
 
-          len = reg->get_end_address () - addr;
-
-          label = anal->get_next_label (addr);
-          if (label != NULL)
-            len = std::min (len, label->get_address () - addr);
-
-          while (itr != fups->end ()
-                 and itr->first <= addr - obj->get_base_address ())
-            ++itr;
-
-          if (itr != fups->end ())
-            len = std::min<size_t> (len,
-                                    itr->first
-                                    - (addr - obj->get_base_address ()));
-
-          while (len > 0)
+          if (run->type != DataModel::RAW and bytes_in_line > 0)
             {
-              if (data_is_address (obj, addr, len, le))
-                {
-                  const Label *dlabel;
-                  uint32_t value;
-
-                  if (bytes_in_line > 0)
-                    {
-                      std::cout << "\"\n";
-                      bytes_in_line = 0;
-                    }
+              std::cout << "\"\n";
+              bytes_in_line = 0;
+            }
 
-                  value = read_le<uint32_t> (obj->get_data_at (addr));
-                  dlabel = anal->get_label (value);
-                  if (dlabel != NULL) {
-                      std::cout << "\t\t.long   " << *dlabel << "\n";
-                  } else {
-                      if (warn_once) {
-                          warn_once = false;
-                          std::cerr << "Warning: Data is an address but destination has no label: 0x"
-                            << std::hex << value << ".\n";
-                      }
-
-                      std::cout << " /* Warning: address points to a valid object/reloc, "
-                            "destination has no label */" << "\n";
-                      std::cout << "\t\t.long   0x" << std::hex << value << "\n";
+          switch (run->type)
+            {
+            case DataModel::POINTER:
+              const Label *dlabel;
+              uint32_t value;
+
+              value = read_le<uint32_t> (data);
+              dlabel = anal->get_label (value);
+              if (dlabel != NULL) {
+                  std::cout << "\t\t.long   " << *dlabel << "\n";
+              } else {
+                  if (warn_once) {
+                      warn_once = false;
+                      std::cerr << "Warning: Data is an address but destination has no label: 0x"
+                        << std::hex << value << ".\n";
                   }
 
-                  addr += 4;
-                  len -= 4;
-                }
-              else if (data_is_zeros (obj, addr, len, &size))
-                {
-                  PUSH_IOS_FLAGS (&std::cout);
-                  std::cout.setf (ios::hex, ios::basefield);
-                  std::cout.setf (ios::showbase);
-
-                  if (bytes_in_line > 0)
-                    {
-                      std::cout << "\"\n";
-                      bytes_in_line = 0;
-                    }
-
-                  std::cout << "\t\t.fill   " << size << "\n";
-                  addr += size;
-                  len -= size;
-                }
-              else if (data_is_string (obj, addr, len, &size, &zt))
-                {
-                  if (bytes_in_line > 0)
-                    {
-                      std::cout << "\"\n";
-                      bytes_in_line = 0;
-                    }
-
-                  if (zt)
-                    std::cout << "\t\t.string \"";
-                  else
-                    std::cout << "\t\t.ascii   \"";
-
-                  print_escaped_string (obj->get_data_at (addr), size - zt);
-
-                  std::cout << "\"\n";
-
-                  addr += size;
-                  len -= size;
-                }
-              else
+                  std::cout << " /* Warning: address points to a valid object/reloc, "
+                        "destination has no label */" << "\n";
+                  std::cout << "\t\t.long   0x" << std::hex << value << "\n";
+              }
+              break;
+
+            case DataModel::ZEROS:
+              {
+                PUSH_IOS_FLAGS (&std::cout);
+                std::cout.setf (ios::hex, ios::basefield);
+                std::cout.setf (ios::showbase);
+
+                std::cout << "\t\t.fill   " << run->size << "\n";
+              }
+              break;
+
+            case DataModel::STRING:
+              std::cout << "\t\t.string \"";
+              print_escaped_string (data, run->size - 1);
+              std::cout << "\"\n";
+              break;
+
+            case DataModel::ASCII:
+              std::cout << "\t\t.ascii   \"";
+              print_escaped_string (data, run->size);
+              std::cout << "\"\n";
+              break;
+
+            default:
+              for (k = 0; k < run->size; k++)
                 {
                   char buffer[8];
 
                   if (bytes_in_line == 0)
                     std::cout << "\t\t.ascii  \"";
 
-                  snprintf (buffer, sizeof (buffer), "\\x%02x",
-                            *obj->get_data_at (addr));
+                  snprintf (buffer, sizeof (buffer), "\\x%02x", data[k]);
                   std::cout << buffer;
 
                   bytes_in_line += 1;
-                  
+
                   if (bytes_in_line == 8)
                     {
                       std::cout << "\"\n";
                       bytes_in_line = 0;
                     }
-
-                  addr++;
-                  len--;
                 }
+              break;
             }
         }
 
@@ -530,8 +592,12 @@ print_region (const Region *reg, const Image::Object *obj, LinearExecutable *le,
     }
 }
 
+/** Prints all regions; if given fingerprint buffer is installed on the
+ * output, it is told where each region ends. */
 static void
-print_code (LinearExecutable *le, Image *img, Analyser *anal)
+print_code (LinearExecutable *le, Image *img, Analyser *anal,
+            bool collapse_library, PrintStats *pstats,
+            FingerprintStreamBuf *fingerprint)
 {
   enum Section
   {
@@ -546,6 +612,7 @@ print_code (LinearExecutable *le, Image *img, Analyser *anal)
   const Region *next;
   const Region *reg;
   const Image::Object *obj;
+  Disassembler disasm;
   Section sec = NONE;
 
   regions = anal->get_regions ();
@@ -554,6 +621,8 @@ print_code (LinearExecutable *le, Image *img, Analyser *anal)
 
   for (itr = regions->begin (); itr != regions->end (); ++itr)
     {
+      TraceSpan span ("print_region", "address", itr->first);
+
       reg = &itr->second;
       obj = img->get_object_at_address (reg->get_address ());
 
@@ -574,7 +643,8 @@ print_code (LinearExecutable *le, Image *img, Analyser *anal)
             }
         }
 
-      print_region (reg, obj, le, img, anal);
+      print_region (reg, obj, le, img, anal, &disasm, collapse_library,
+                    pstats);
 
       if (prev != NULL)
         assert (prev->get_end_address () <= reg->get_address ());
@@ -589,10 +659,54 @@ print_code (LinearExecutable *le, Image *img, Analyser *anal)
             print_label (l);
         }
 
+      if (fingerprint != NULL)
+        fingerprint->end_region (itr->first);
+
       prev = reg;
     }
 }
 
+/** Prints only the functions changed by incremental analysis, each one
+ * by its owned blocks, in address order. */
+static void
+print_changed_functions (LinearExecutable *le, Image *img, Analyser *anal,
+                         bool collapse_library, PrintStats *pstats)
+{
+  const std::vector<uint32_t> *changed;
+  const FunctionModel *model;
+  const FunctionModel::Function *func;
+  const FunctionModel::Block *blk;
+  Disassembler disasm;
+  Region reg;
+  size_t n, k;
+
+  changed = anal->get_changed_functions ();
+  model = anal->get_function_model ();
+
+  std::cerr << "Changed function count: " << changed->size () << "\n";
+
+  if (changed->empty ())
+    return;
+
+  std::cout << ".text\n";
+
+  for (n = 0; n < changed->size (); n++)
+    {
+      func = model->get_function_at ((*changed)[n]);
+      if (func == NULL)
+        continue;
+
+      for (k = 0; k < func->blocks.size (); k++)
+        {
+          blk = model->get_block (func->blocks[k]);
+          reg = Region (blk->start, blk->end - blk->start, Region::CODE);
+
+          print_region (&reg, img->get_object_at_address (blk->start), le,
+                        img, anal, &disasm, collapse_library, pstats);
+        }
+    }
+}
+
 void
 debug_print_regions (Analyser *anal)
 {
@@ -607,6 +721,387 @@ debug_print_regions (Analyser *anal)
     std::cout << itr->second << "\n";
 }
 
+static void
+dump_xrefs (Analyser *anal, const std::string &fname)
+{
+  std::ofstream ofs;
+  const XrefIndex *xrefs;
+  const XrefIndex::Ref *refs;
+  const Label *lab;
+  size_t count;
+  size_t n, k;
+  uint32_t target;
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  ofs.setf (ios::hex, ios::basefield);
+  ofs.setf (ios::showbase);
+
+  xrefs = anal->get_xrefs ();
+
+  for (n = 0; n < xrefs->get_target_count (); n++)
+    {
+      target = xrefs->get_target (n);
+      refs = xrefs->get_refs_to (target, &count);
+      lab = anal->get_label (target);
+
+      for (k = 0; k < count; k++)
+        {
+          ofs << refs[k].address << '\t' << target << '\t' << refs[k].type;
+          if (lab != NULL)
+            ofs << '\t' << *lab;
+          ofs << '\n';
+        }
+    }
+}
+
+/** Writes clusters of function copies, one cluster per line. */
+static void
+dump_duplicates (Analyser *anal, const std::string &fname)
+{
+  std::ofstream ofs;
+  const std::vector<FunctionHasher::Cluster> *clusters;
+  const Label *lab;
+  size_t n, k;
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  ofs.setf (ios::hex, ios::basefield);
+  ofs.setf (ios::showbase);
+
+  clusters = anal->get_duplicates ();
+
+  for (n = 0; n < clusters->size (); n++)
+    {
+      const FunctionHasher::Cluster &clu = (*clusters)[n];
+
+      ofs << clu.kind << '\t' << clu.size << '\t' << std::dec
+          << clu.functions.size () << std::hex;
+
+      for (k = 0; k < clu.functions.size (); k++)
+        {
+          lab = anal->get_label (clu.functions[k]);
+          if (lab != NULL)
+            ofs << '\t' << *lab;
+          else
+            ofs << '\t' << clu.functions[k];
+        }
+
+      ofs << '\n';
+    }
+}
+
+/** Writes the call graph in Graphviz DOT format.
+ *
+ * Tail calls are drawn dashed; size of each function is in its tooltip.
+ */
+static void
+dump_call_graph (Analyser *anal, const std::string &fname)
+{
+  std::ofstream ofs;
+  const FunctionModel *model;
+  const FunctionModel::Function *func;
+  const uint32_t *callees;
+  const Label *lab;
+  size_t count;
+  size_t n, k;
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  model = anal->get_function_model ();
+
+  ofs << "digraph calls {\n"
+      << "\tnode [shape=box];\n";
+
+  for (n = 0; n < model->get_function_count (); n++)
+    {
+      func = model->get_function (n);
+      lab = anal->get_label (func->entry);
+
+      ofs << "\tf" << std::dec << n << " [label=\"" << *lab
+          << "\", tooltip=\"" << func->size << " bytes, "
+          << func->blocks.size () << " blocks\"];\n";
+    }
+
+  for (n = 0; n < model->get_function_count (); n++)
+    {
+      callees = model->get_callees (n, &count);
+
+      for (k = 0; k < count; k++)
+        ofs << "\tf" << n << " -> f" << callees[k] << ";\n";
+
+      func = model->get_function (n);
+
+      for (k = 0; k < func->tail_calls.size (); k++)
+        ofs << "\tf" << n << " -> f" << func->tail_calls[k]
+            << " [style=dashed];\n";
+    }
+
+  ofs << "}\n";
+}
+
+/** Writes timing of phases and counters of the run as JSON. */
+static void
+dump_run_stats (RunStats *report, Analyser *anal, LinearExecutable *le,
+                const PrintStats *pstats, uint64_t bytes_emitted,
+                const std::string &fname)
+{
+  std::ofstream ofs;
+  const Analyser::Stats *stats;
+  const DecodeCache::Stats *cstats;
+  const Analyser::RegionMap *regions;
+  const Analyser::LabelMap *labels;
+  Analyser::RegionMap::const_iterator ritr;
+  Analyser::LabelMap::const_iterator litr;
+  size_t region_types[Region::VTABLE + 1] = {0};
+  size_t label_types[Label::DATA + 1] = {0};
+  size_t fixups;
+  size_t n;
+
+  stats = anal->get_stats ();
+  cstats = anal->get_decode_cache ()->get_stats ();
+  regions = anal->get_regions ();
+  labels = anal->get_labels ();
+
+  for (ritr = regions->begin (); ritr != regions->end (); ++ritr)
+    region_types[ritr->second.get_type ()]++;
+
+  for (litr = labels->begin (); litr != labels->end (); ++litr)
+    label_types[litr->second.get_type ()]++;
+
+  fixups = 0;
+  for (n = 0; n < le->get_object_count (); n++)
+    fixups += le->get_fixups_for_object (n)->size ();
+
+  report->set_counter ("analysis_instructions", stats->decoded_instructions);
+  report->set_counter ("print_instructions", pstats->instructions);
+  report->set_counter ("print_decoded_again", pstats->decoded);
+  report->set_counter ("decode_cache_records", cstats->records);
+  report->set_counter ("decode_cache_evicted_runs", cstats->evicted_runs);
+  report->set_counter ("decode_cache_hits", cstats->hits);
+  report->set_counter ("regions", regions->size ());
+  report->set_counter ("regions_unknown", region_types[Region::UNKNOWN]);
+  report->set_counter ("regions_code", region_types[Region::CODE]);
+  report->set_counter ("regions_data", region_types[Region::DATA]);
+  report->set_counter ("regions_vtable", region_types[Region::VTABLE]);
+  report->set_counter ("region_splits", stats->region_splits);
+  report->set_counter ("region_merges", stats->region_merges);
+  report->set_counter ("labels", labels->size ());
+  report->set_counter ("labels_unknown", label_types[Label::UNKNOWN]);
+  report->set_counter ("labels_jump", label_types[Label::JUMP]);
+  report->set_counter ("labels_function", label_types[Label::FUNCTION]);
+  report->set_counter ("labels_vtable", label_types[Label::VTABLE]);
+  report->set_counter ("labels_data", label_types[Label::DATA]);
+  report->set_counter ("traced_guesses", stats->traced_guesses);
+  report->set_counter ("discarded_guesses", stats->discarded_guesses);
+  report->set_counter ("scanned_functions", stats->scanned_functions);
+  report->set_counter ("library_functions", stats->library_functions);
+  report->set_counter ("jump_tables", stats->jump_tables);
+  report->set_counter ("indirect_targets", stats->indirect_targets);
+  report->set_counter ("xrefs", anal->get_xrefs ()->size ());
+  report->set_counter ("data_runs",
+                       anal->get_data_model ()->get_run_count ());
+  report->set_counter ("fixups", fixups);
+  report->set_counter ("exhausted_phases", stats->exhausted_phases);
+  report->set_counter ("bytes_emitted", bytes_emitted);
+  report->set_counter ("peak_rss_bytes", RunStats::get_peak_rss ());
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  report->write_json (&ofs);
+}
+
+/** Writes spans recorded by all threads as Chrome trace events. */
+static void
+dump_trace_events (const std::string &fname)
+{
+  std::ofstream ofs;
+
+  ofs.open (fname);
+  if (!ofs.is_open ())
+    {
+      throw Error() << "Error opening file: " << fname;
+    }
+
+  TraceRecorder::write_json (&ofs);
+}
+
+/** Compares the native instruction decoder with libopcodes, at every
+ * offset of the executable objects. */
+static void
+verify_decoder (const Image *image)
+{
+  Disassembler disasm;
+  const Image::Object *obj;
+  const uint8_t *data;
+  size_t compared;
+  size_t differences;
+  size_t size;
+  size_t n;
+  size_t off;
+
+  compared = 0;
+  differences = 0;
+
+  for (n = 0; n < image->get_object_count (); n++)
+    {
+      obj = image->get_object (n);
+      if (!obj->is_executable ())
+        continue;
+
+      data = &obj->get_data ()->front ();
+      size = obj->get_data ()->size ();
+
+      for (off = 0; off < size; off++)
+        {
+          try
+            {
+              if (!disasm.compare_decoders (obj->get_base_address () + off,
+                                            data + off, size - off,
+                                            &std::cerr))
+                differences++;
+            }
+          catch (const std::runtime_error &)
+            {
+              continue;
+            }
+
+          compared++;
+        }
+    }
+
+  std::cerr << "Decoder check: " << compared << " offset(s) compared, "
+            << differences << " difference(s).\n";
+
+  if (differences > 0)
+    throw Error() << "Decoder check failed.";
+}
+
+/** Sets options of analysis, all but progress, with given amount of
+ * threads. */
+static void
+setup_analyser (Analyser *anal, const Options &options, size_t jobs,
+                const std::shared_ptr<SignatureIndex> &sigs)
+{
+  anal->set_thread_count (jobs);
+  anal->set_speculation (options.speculate);
+  anal->set_code_scan (options.scan_code);
+  anal->set_duplicate_detection (!options.dupfile.empty(),
+                                 options.near_duplicates);
+
+  if (sigs.get() != NULL)
+    anal->set_signatures (sigs);
+
+  anal->set_decode_cache_limit (options.cache_mb << 20);
+  anal->set_budget (options.budget);
+  anal->set_memory_accounting (!options.statsfile.empty());
+}
+
+/** Ends the current phase of the report; with statistics requested, also
+ * records memory used by the structures at that point. Without analyser,
+ * the executable, image and symbols are measured on their own. */
+static void
+end_report_phase (RunStats *report, const Options &options,
+                  const Analyser *anal, const LinearExecutable *le,
+                  const Image *image, const SymbolMap *syms)
+{
+  MemoryUsage usage;
+
+  report->end ();
+
+  if (options.statsfile.empty ())
+    return;
+
+  if (anal != NULL)
+    anal->get_memory_usage (&usage);
+  else
+    {
+      if (le != NULL)
+        le->get_memory_usage (&usage);
+
+      if (image != NULL)
+        image->get_memory_usage (&usage);
+
+      if (syms != NULL)
+        syms->get_memory_usage (&usage);
+    }
+
+  report->set_memory (usage);
+}
+
+/** Analyses the executable, or loads analysis from database and updates
+ * it, then classifies data for printing; phases are added to the report,
+ * if given. */
+static void
+run_analysis (Analyser *anal, const Options &options, LinearExecutable *le,
+              const std::vector<Region> &hint_regions,
+              const std::vector<Label> &hint_labels, RunStats *report)
+{
+  RunStats unused;
+
+  if (report == NULL)
+    report = &unused;
+
+  if (!options.load_db.empty())
+    {
+      report->begin ("load_db");
+      AnalysisDatabase::load (anal, options.load_db);
+      end_report_phase (report, options, anal, NULL, NULL, NULL);
+
+      if (!options.hintfile.empty() or !options.mapfile.empty())
+        {
+          Analyser loaded;
+          std::vector<Analyser::RegionChange> region_changes;
+          std::vector<Analyser::LabelChange> label_changes;
+
+          anal->fork (&loaded);
+          anal->run_incremental (hint_regions, hint_labels);
+
+          Analyser::diff (loaded, *anal, &region_changes, &label_changes);
+          std::cerr << "Changed " << std::dec << region_changes.size ()
+                    << " region(s) and " << label_changes.size ()
+                    << " label(s) of the database.\n";
+        }
+
+      report->append (*anal->get_timings ());
+    }
+  else
+    {
+      report->begin ("known_file");
+      KnownFile::check(*anal, le);
+      KnownFile::pre_anal_fixups_apply(*anal);
+      anal->set_hints (hint_regions, hint_labels);
+      end_report_phase (report, options, anal, NULL, NULL, NULL);
+
+      anal->run ();
+
+      report->append (*anal->get_timings ());
+      report->begin ("known_file_post");
+      KnownFile::post_anal_fixups_apply(*anal);
+      end_report_phase (report, options, anal, NULL, NULL, NULL);
+    }
+
+  report->begin ("classify");
+  anal->classify_data ();
+  end_report_phase (report, options, anal, NULL, NULL, NULL);
+}
+
 void
 main_execute(Options &options)
 {
@@ -614,7 +1109,25 @@ main_execute(Options &options)
   std::unique_ptr<SymbolMap> syms;
   std::unique_ptr<Image> image;
   std::ifstream ifs;
+  std::vector<Region> hint_regions;
+  std::vector<Label> hint_labels;
+  std::shared_ptr<SignatureIndex> sigs;
   Analyser anal;
+  Analyser check_anal;
+  RunStats report;
+  PrintStats pstats = PrintStats ();
+  std::unique_ptr<CountingStreamBuf> counter;
+  std::unique_ptr<FingerprintStreamBuf> text;
+  RegionFingerprint::EntryVector prints;
+  RegionFingerprint::EntryVector check_prints;
+  uint32_t divergence;
+
+  /* Most spans a thread keeps; enough for all regions of a large binary,
+   * and rings only grow as far as spans are recorded */
+  if (!options.tracefile.empty())
+    TraceRecorder::enable (1 << 18);
+
+  report.begin ("load");
 
   syms = std::unique_ptr<SymbolMap>(
       new SymbolMap
@@ -633,20 +1146,126 @@ main_execute(Options &options)
       LinearExecutable::load (&ifs, options.exefile)
   );
 
+  end_report_phase (&report, options, NULL, le.get(), NULL, syms.get());
+  report.begin ("image");
+
   image = std::unique_ptr<Image>(
       create_image (&ifs, le.get())
   );
 
+  end_report_phase (&report, options, NULL, le.get(), image.get(),
+                    syms.get());
+
+  if (options.verify_decoder)
+    {
+      verify_decoder (image.get());
+      return;
+    }
+
+  report.begin ("setup");
+
+  if (options.jobs > 1 and !ParallelTracer::is_supported ())
+    {
+      std::cerr << "Warning: libopcodes is too old for parallel decoding,"
+                   " using one thread.\n";
+      options.jobs = 1;
+    }
+
+  if (!options.sigfile.empty())
+    {
+      sigs.reset (new SignatureIndex);
+      sigs->load_file (options.sigfile);
+      std::cerr << "Loaded " << sigs->get_count ()
+                << " library function signature(s).\n";
+    }
+
+  if (!options.hintfile.empty())
+    HintFile::load (options.hintfile, &hint_regions, &hint_labels);
+
   anal = Analyser (le.get(), image.get(), syms.get());
+  setup_analyser (&anal, options, options.jobs, sigs);
+  anal.set_progress (options.progress);
+  end_report_phase (&report, options, &anal, NULL, NULL, NULL);
+
+  run_analysis (&anal, options, le.get(), hint_regions, hint_labels,
+                &report);
+
+  if (options.deterministic_check)
+    {
+      report.begin ("reference");
+      check_anal = Analyser (le.get(), image.get(), syms.get());
+      setup_analyser (&check_anal, options, 1, sigs);
+      run_analysis (&check_anal, options, le.get(), hint_regions,
+                    hint_labels, NULL);
+
+      {
+        FingerprintStreamBuf text (&std::cout, true);
+        PrintStats check_pstats = PrintStats ();
+
+        print_code (le.get(), image.get(), &check_anal,
+                    options.collapse_library, &check_pstats, &text);
+        RegionFingerprint::compute (&check_anal, &text, &check_prints);
+      }
+      end_report_phase (&report, options, &anal, NULL, NULL, NULL);
+    }
+
+  report.begin ("dump");
+
+  if (!options.save_db.empty())
+    AnalysisDatabase::save (&anal, options.save_db);
 
-  KnownFile::check(anal, le.get());
-  KnownFile::pre_anal_fixups_apply(anal);
+  if (!options.xreffile.empty())
+    dump_xrefs (&anal, options.xreffile);
 
-  anal.run ();
+  if (!options.dupfile.empty())
+    dump_duplicates (&anal, options.dupfile);
 
-  KnownFile::post_anal_fixups_apply(anal);
+  if (!options.graphfile.empty())
+    dump_call_graph (&anal, options.graphfile);
 
-  print_code (le.get(), image.get(), &anal);
+  end_report_phase (&report, options, &anal, NULL, NULL, NULL);
+  report.begin ("print");
+
+  if (!options.statsfile.empty())
+    counter.reset (new CountingStreamBuf (&std::cout));
+
+  if (options.deterministic_check or !options.fingerprintfile.empty())
+    text.reset (new FingerprintStreamBuf (&std::cout, false));
+
+  if (options.changed_only)
+    print_changed_functions (le.get(), image.get(), &anal,
+                             options.collapse_library, &pstats);
+  else
+    print_code (le.get(), image.get(), &anal, options.collapse_library,
+                &pstats, text.get());
+  std::cout.flush ();
+  end_report_phase (&report, options, &anal, NULL, NULL, NULL);
+
+  if (text.get() != NULL)
+    RegionFingerprint::compute (&anal, text.get(), &prints);
+
+  if (!options.fingerprintfile.empty())
+    RegionFingerprint::save (prints, options.fingerprintfile);
+
+  if (!options.statsfile.empty())
+    dump_run_stats (&report, &anal, le.get(), &pstats, counter->get_count (),
+                    options.statsfile);
+
+  if (!options.tracefile.empty())
+    dump_trace_events (options.tracefile);
+
+  if (options.deterministic_check)
+    {
+      if (RegionFingerprint::find_divergence (check_prints, prints,
+                                              &divergence))
+        throw Error() << "Deterministic check failed: output of "
+                      << options.jobs << " job(s) differs from serial run"
+                      << " at region " << std::hex << std::showbase
+                      << divergence << ".";
+
+      std::cerr << "Deterministic check passed for "
+                << prints.size () << " region(s).\n";
+    }
 }
 
 int
@@ -655,13 +1274,34 @@ main (int argc, char **argv)
   static const option longopts[] = {
       {"exefile", required_argument, NULL, 'e'},
       {"mapfile", required_argument, NULL, 'm'},
+      {"xrefs", required_argument, NULL, 'x'},
+      {"jobs", required_argument, NULL, 'j'},
+      {"speculate", no_argument, NULL, 's'},
+      {"cache-size", required_argument, NULL, 'c'},
+      {"no-scan", no_argument, NULL, 'n'},
+      {"signatures", required_argument, NULL, 'S'},
+      {"collapse-library", no_argument, NULL, 'L'},
+      {"duplicates", required_argument, NULL, 'd'},
+      {"near-duplicates", no_argument, NULL, 'D'},
+      {"call-graph", required_argument, NULL, 'g'},
+      {"save-db", required_argument, NULL, 'w'},
+      {"load-db", required_argument, NULL, 'l'},
+      {"hints", required_argument, NULL, 'H'},
+      {"budget", required_argument, NULL, 'b'},
+      {"progress", no_argument, NULL, 'P'},
+      {"stats", required_argument, NULL, 'T'},
+      {"trace-events", required_argument, NULL, 'E'},
+      {"deterministic-check", no_argument, NULL, 'K'},
+      {"fingerprint", required_argument, NULL, 'F'},
+      {"verify-decoder", no_argument, NULL, 'V'},
+      {"changed-only", no_argument, NULL, 'C'},
       {0}};
   bool show_usage = false;
   Options options;
 
   while (1)
     {
-      const int opt = getopt_long(argc, argv, "he:m:", longopts, 0);
+      const int opt = getopt_long(argc, argv, "he:m:x:j:sc:nS:Ld:Dg:w:l:H:b:PT:E:KF:VC", longopts, 0);
 
       if (opt == -1) {
           break;
@@ -674,6 +1314,91 @@ main (int argc, char **argv)
         case 'm':
           options.mapfile = optarg;
           break;
+        case 'x':
+          options.xreffile = optarg;
+          break;
+        case 'j':
+          {
+            char *end;
+
+            options.jobs = strtoul (optarg, &end, 10);
+            if (*end != '\0' or options.jobs == 0)
+              {
+                std::cerr << "Invalid amount of jobs: " << optarg << "\n";
+                show_usage = true;
+              }
+          }
+          break;
+        case 's':
+          options.speculate = true;
+          break;
+        case 'c':
+          {
+            char *end;
+
+            options.cache_mb = strtoul (optarg, &end, 10);
+            if (*end != '\0')
+              {
+                std::cerr << "Invalid decode cache size: " << optarg << "\n";
+                show_usage = true;
+              }
+          }
+          break;
+        case 'n':
+          options.scan_code = false;
+          break;
+        case 'S':
+          options.sigfile = optarg;
+          break;
+        case 'L':
+          options.collapse_library = true;
+          break;
+        case 'd':
+          options.dupfile = optarg;
+          break;
+        case 'D':
+          options.near_duplicates = true;
+          break;
+        case 'g':
+          options.graphfile = optarg;
+          break;
+        case 'w':
+          options.save_db = optarg;
+          break;
+        case 'l':
+          options.load_db = optarg;
+          break;
+        case 'H':
+          options.hintfile = optarg;
+          break;
+        case 'b':
+          if (!Analyser::parse_budget (optarg, &options.budget))
+            {
+              std::cerr << "Invalid budget: " << optarg << "\n";
+              show_usage = true;
+            }
+          break;
+        case 'P':
+          options.progress = true;
+          break;
+        case 'T':
+          options.statsfile = optarg;
+          break;
+        case 'E':
+          options.tracefile = optarg;
+          break;
+        case 'K':
+          options.deterministic_check = true;
+          break;
+        case 'F':
+          options.fingerprintfile = optarg;
+          break;
+        case 'V':
+          options.verify_decoder = true;
+          break;
+        case 'C':
+          options.changed_only = true;
+          break;
         case 'h':
         default: /* '?' */
           show_usage = true;
@@ -684,9 +1409,40 @@ main (int argc, char **argv)
   if (options.exefile.empty())
     show_usage = true;
 
+  /* Runs cut by time differ by nature, comparing them proves nothing */
+  if (options.deterministic_check and options.budget.seconds > 0)
+    {
+      std::cerr << "Budget of seconds cannot be used with -K.\n";
+      show_usage = true;
+    }
+
+  /* Only incremental analysis knows which functions changed */
+  if (options.changed_only
+      and (options.load_db.empty ()
+           or (options.hintfile.empty () and options.mapfile.empty ())))
+    {
+      std::cerr << "Option -C needs -l together with -H or -m.\n";
+      show_usage = true;
+    }
+
+  /* Fingerprints are made of the whole output */
+  if (options.changed_only
+      and (options.deterministic_check or !options.fingerprintfile.empty ()))
+    {
+      std::cerr << "Option -C cannot be used with -K or -F.\n";
+      show_usage = true;
+    }
+
   if (show_usage)
     {
-      std::cerr << "Usage: " << argv[0] << " -e <main.exe> [-m <symbols.map>]\n";
+      std::cerr << "Usage: " << argv[0] << " -e <main.exe> [-m <symbols.map>] [-x <xrefs.txt>]\n"
+                << "    [-j <jobs>] [-s] [-c <cache MiB>] [-n]"
+                   " [-S <signatures.txt> [-L]]\n"
+                << "    [-d <duplicates.txt> [-D]] [-g <calls.dot>]\n"
+                << "    [-w <save.db>] [-l <load.db> [-C]] [-H <hints.txt>]\n"
+                << "    [-b instructions=N,guesses=N,seconds=N] [-P]\n"
+                << "    [-T <stats.json>] [-E <trace.json>] [-K]"
+                   " [-F <fingerprint.txt>] [-V]\n";
       return 1;
     }
 
@@ -20,6 +20,7 @@
 #include "le_image.hpp"
 #include "le.hpp"
 #include "image.hpp"
+#include "trace_events.hpp"
 
 using std::cerr;
 using std::min;
@@ -67,6 +68,8 @@ create_image (std::istream *is, const LinearExecutable *lx)
 
   for (oi = 0; oi < lx->get_object_count (); oi++)
     {
+      TraceSpan span ("create_image_object", "object", oi + 1);
+
       ohdr = lx->get_object_header (oi);
 
       data.clear ();
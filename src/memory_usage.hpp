@@ -0,0 +1,83 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file memory_usage.hpp
+ *     Declaration of MemoryUsage, and estimators of container memory.
+ * @par Purpose:
+ *     Allows structures of the loader, image and analyser to tell how much
+ *     heap memory they use, split into named parts.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_MEMORY_USAGE_H
+#define LEDISASM_MEMORY_USAGE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Heap memory used by named parts of the program, in bytes.
+ *
+ * Sizes are estimates: containers are counted by their capacity or
+ * number of nodes, without allocator overhead.
+ */
+struct MemoryUsage
+{
+  std::vector<std::pair<std::string, uint64_t> > parts;
+
+  void
+  add (const std::string &name, uint64_t bytes)
+  {
+    parts.push_back (std::make_pair (name, bytes));
+  }
+
+  uint64_t
+  get_total (void) const
+  {
+    uint64_t total;
+    size_t n;
+
+    total = 0;
+    for (n = 0; n < parts.size (); n++)
+      total += parts[n].second;
+
+    return total;
+  }
+};
+
+/** Memory of a node of std::map, std::set or PersistentMap; the tree
+ * links and bookkeeping take about four pointers. */
+template <typename T>
+size_t
+tree_node_memory (void)
+{
+  return sizeof (T) + 4 * sizeof (void *);
+}
+
+template <typename T>
+size_t
+vector_memory (const std::vector<T> &vec)
+{
+  return vec.capacity () * sizeof (T);
+}
+
+/** Memory of string contents, unless they are kept inside the object. */
+static inline size_t
+string_memory (const std::string &str)
+{
+  const char *data = str.data ();
+
+  if (data >= (const char *) &str and data < (const char *) (&str + 1))
+    return 0;
+
+  return str.capacity () + 1;
+}
+
+#endif // LEDISASM_MEMORY_USAGE_H
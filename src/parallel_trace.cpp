@@ -0,0 +1,447 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file parallel_trace.cpp
+ *     Implementation of methods for ParallelTracer class.
+ * @par Purpose:
+ *     Implementation of ParallelTracer class methods, which decode the
+ *     code reachable from given addresses using several threads.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <system_error>
+
+#include "disassembler.hpp"
+#include "image.hpp"
+#include "instruction.hpp"
+#include "parallel_trace.hpp"
+#include "regions.hpp"
+#include "trace_events.hpp"
+
+struct ParallelTracer::Worker
+{
+  WorkStealingDeque<uint32_t> queue;
+  Disassembler disasm;
+  size_t decoded;
+  size_t steals;
+
+  Worker (void)
+  {
+    this->decoded = 0;
+    this->steals = 0;
+  }
+};
+
+ParallelTracer::ParallelTracer (const Image *image, size_t thread_count)
+{
+  size_t n;
+
+  this->image = image;
+  this->thread_count = std::max (thread_count, (size_t) 1);
+  this->stats = Stats ();
+  this->workers.reset (new Worker[this->thread_count]);
+  this->generation = 0;
+  this->busy = 0;
+  this->stopping = false;
+  this->regions = NULL;
+  this->pending.store (0);
+  this->work_posted.store (0);
+  this->sleepers.store (0);
+
+  for (n = 0; n < image->get_object_count (); n++)
+    {
+      const Image::Object *obj = image->get_object (n);
+      ObjectState state;
+
+      if (!obj->is_executable ())
+        continue;
+
+      state.base_address = obj->get_base_address ();
+      state.size = obj->get_data ()->size ();
+      this->objects.push_back (std::move (state));
+    }
+
+  this->clear ();
+}
+
+ParallelTracer::~ParallelTracer (void)
+{
+  size_t n;
+
+  {
+    std::lock_guard<std::mutex> guard (this->pool_lock);
+    this->stopping = true;
+  }
+
+  this->wake.notify_all ();
+
+  for (n = 0; n < this->threads.size (); n++)
+    this->threads[n].join ();
+}
+
+/** Forgets all decoded instructions, ie. after regions have changed. */
+void
+ParallelTracer::clear (void)
+{
+  std::vector<ObjectState>::iterator itr;
+  uint32_t n;
+
+  for (itr = this->objects.begin (); itr != this->objects.end (); ++itr)
+    {
+      itr->insns.assign (itr->size, Decoded ());
+      itr->claims.reset (new std::atomic<uint8_t>[itr->size]);
+
+      for (n = 0; n < itr->size; n++)
+        itr->claims[n].store (0, std::memory_order_relaxed);
+    }
+}
+
+size_t
+ParallelTracer::get_thread_count (void) const
+{
+  return this->thread_count;
+}
+
+ParallelTracer::ObjectState *
+ParallelTracer::get_state (uint32_t address)
+{
+  std::vector<ObjectState>::iterator itr;
+
+  for (itr = this->objects.begin (); itr != this->objects.end (); ++itr)
+    {
+      if (address >= itr->base_address
+          and address - itr->base_address < itr->size)
+        return &*itr;
+    }
+
+  return NULL;
+}
+
+/** Decodes one linear run of code, like Analyser::trace_code_at_address().
+ *
+ * The run is bounded by the unknown region it starts in. It also stops at
+ * an instruction start claimed by another run, since from there on both
+ * runs would decode the same instructions.
+ */
+void
+ParallelTracer::trace_run (Worker *worker, uint32_t address)
+{
+  RegionMap::const_iterator itr;
+  const uint8_t *data;
+  ObjectState *state;
+  Instruction inst;
+  size_t end_addr;
+  size_t addr;
+  uint32_t off;
+
+  state = this->get_state (address);
+  if (state == NULL)
+    return;
+
+  itr = this->regions->upper_bound (address);
+  if (itr == this->regions->begin ())
+    return;
+
+  --itr;
+  if (itr->second.get_type () != Region::UNKNOWN
+      or itr->second.get_end_address () <= address)
+    return;
+
+  end_addr = itr->second.get_end_address ();
+  data = &this->image->get_object_at_address (address)->get_data ()->front ();
+
+  for (addr = address; addr < end_addr; addr += inst.get_size ())
+    {
+      off = addr - state->base_address;
+
+      if (state->claims[off].exchange (1) != 0)
+        break;
+
+      try
+        {
+          worker->disasm.decode (addr, data + off, end_addr - addr, &inst);
+        }
+      catch (...)
+        {
+          /* Left undecoded; the replay will decode it and fail the same way */
+          break;
+        }
+
+      state->insns[off].size   = inst.get_size ();
+      state->insns[off].type   = inst.get_type ();
+      state->insns[off].target = inst.get_target ();
+      state->insns[off].valid  = inst.is_valid ();
+      worker->decoded++;
+
+      if (!inst.is_valid ())
+        break;
+
+      if (inst.get_target () != 0)
+        {
+          switch (inst.get_type ())
+            {
+            case Instruction::CALL:
+            case Instruction::COND_JUMP:
+            case Instruction::JUMP:
+              this->pending.fetch_add (1);
+              worker->queue.push (inst.get_target ());
+              this->post_work ();
+              break;
+
+            default:
+              break;
+            }
+        }
+
+      if (inst.get_type () == Instruction::JUMP
+          or inst.get_type () == Instruction::RET)
+        break;
+    }
+}
+
+/** Wakes workers waiting for work; called once an item was queued, or
+ * the last one was done.
+ */
+void
+ParallelTracer::post_work (void)
+{
+  this->work_posted.fetch_add (1);
+
+  if (this->sleepers.load () == 0)
+    return;
+
+  std::lock_guard<std::mutex> guard (this->work_lock);
+  this->work_ready.notify_all ();
+}
+
+/** Waits until work was posted since given count, or the batch is done.
+ *
+ * The sleeper is counted before the count is checked again, so either
+ * the waiter sees a new post, or the poster sees the sleeper and wakes it.
+ */
+void
+ParallelTracer::wait_for_work (uint64_t posted)
+{
+  std::unique_lock<std::mutex> guard (this->work_lock);
+
+  this->sleepers.fetch_add (1);
+
+  while (this->work_posted.load () == posted and this->pending.load () != 0)
+    this->work_ready.wait (guard);
+
+  this->sleepers.fetch_sub (1);
+}
+
+void
+ParallelTracer::run_worker (size_t index)
+{
+  Worker *self = &this->workers[index];
+  uint32_t address = 0;
+  uint64_t posted;
+  size_t n;
+  TraceSpan span ("predecode_worker", "worker", index);
+
+  for (;;)
+    {
+      posted = this->work_posted.load ();
+
+      if (!self->queue.pop (&address))
+        {
+          for (n = 1; n < this->thread_count; n++)
+            {
+              if (this->workers[(index + n) % this->thread_count].queue.steal
+                    (&address))
+                break;
+            }
+
+          if (n == this->thread_count)
+            {
+              if (this->pending.load () == 0)
+                return;
+
+              this->wait_for_work (posted);
+              continue;
+            }
+
+          self->steals++;
+        }
+
+      this->trace_run (self, address);
+
+      if (this->pending.fetch_sub (1) == 1)
+        this->post_work ();
+    }
+}
+
+/** Waits for batches given by predecode(), and works on each of them. */
+void
+ParallelTracer::run_thread (size_t index)
+{
+  uint64_t done = 0;
+
+  for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> guard (this->pool_lock);
+
+        while (!this->stopping and this->generation == done)
+          this->wake.wait (guard);
+
+        if (this->stopping)
+          return;
+
+        done = this->generation;
+      }
+
+      this->run_worker (index);
+
+      {
+        std::lock_guard<std::mutex> guard (this->pool_lock);
+
+        if (--this->busy == 0)
+          this->idle.notify_all ();
+      }
+    }
+}
+
+void
+ParallelTracer::start_threads (void)
+{
+  size_t n;
+
+  for (n = 1; n < this->thread_count; n++)
+    {
+      try
+        {
+          this->threads.push_back (std::thread (&ParallelTracer::run_thread,
+                                                this, n));
+        }
+      catch (const std::system_error &)
+        {
+          /* Work left in its deque will be stolen by the others */
+          break;
+        }
+    }
+}
+
+/** Decodes all code reachable from given addresses.
+ *
+ * Regions must not change while this runs; they only limit how far each
+ * run is decoded. The calling thread works as one of the workers.
+ */
+void
+ParallelTracer::predecode (const std::vector<uint32_t> &roots,
+                           const RegionMap *regions)
+{
+  size_t n;
+
+  if (roots.empty ())
+    return;
+
+  if (this->threads.empty ())
+    this->start_threads ();
+
+  for (n = 0; n < roots.size (); n++)
+    this->workers[n % this->thread_count].queue.push (roots[n]);
+
+  this->regions = regions;
+  this->pending.store (roots.size ());
+
+  {
+    std::lock_guard<std::mutex> guard (this->pool_lock);
+    this->busy = this->threads.size ();
+    this->generation++;
+  }
+
+  this->wake.notify_all ();
+  this->run_worker (0);
+
+  {
+    std::unique_lock<std::mutex> guard (this->pool_lock);
+
+    while (this->busy > 0)
+      this->idle.wait (guard);
+  }
+
+  for (n = 0; n < this->thread_count; n++)
+    {
+      this->stats.decoded += this->workers[n].decoded;
+      this->stats.steals += this->workers[n].steals;
+      this->workers[n].decoded = 0;
+      this->workers[n].steals = 0;
+    }
+}
+
+/** Gives the instruction decoded at given address, if there is one.
+ *
+ * @return False if the address was not decoded, or the instruction
+ *     does not fit within the length, so has to be decoded again.
+ */
+bool
+ParallelTracer::lookup (uint32_t address, size_t length, Instruction *ret)
+{
+  ObjectState *state;
+  const Decoded *insn;
+
+  state = this->get_state (address);
+  if (state == NULL)
+    return false;
+
+  insn = &state->insns[address - state->base_address];
+  if (insn->size == 0 or insn->size > length)
+    {
+      this->stats.misses++;
+      return false;
+    }
+
+  ret->type   = (Instruction::Type) insn->type;
+  ret->string.clear ();
+  ret->size   = insn->size;
+  ret->target = insn->target;
+  ret->valid  = (insn->valid != 0);
+  this->stats.hits++;
+  return true;
+}
+
+const ParallelTracer::Stats *
+ParallelTracer::get_stats (void) const
+{
+  return &this->stats;
+}
+
+/** Gives memory of decoded instructions and claims, per object byte. */
+size_t
+ParallelTracer::get_memory_used (void) const
+{
+  std::vector<ObjectState>::const_iterator itr;
+  size_t ret;
+
+  ret = 0;
+
+  for (itr = this->objects.begin (); itr != this->objects.end (); ++itr)
+    ret += itr->insns.capacity () * sizeof (Decoded)
+           + itr->size * sizeof (std::atomic<uint8_t>);
+
+  return ret;
+}
+
+/** Says whether libopcodes can be called from several threads at once.
+ *
+ * The i386 printer kept its state in static variables until binutils
+ * got styled disassembly, so older versions have to stay serial.
+ */
+bool
+ParallelTracer::is_supported (void)
+{
+#ifdef HAVE_LIBOPCODES_DISASSEMBLER_STYLE
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,173 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file parallel_trace.hpp
+ *     Header file for parallel_trace.cpp, with declaration of ParallelTracer.
+ * @par Purpose:
+ *     Storage for ParallelTracer class which decodes the code reachable
+ *     from given addresses using several threads, before the analyser
+ *     replays the trace.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_PARALLEL_TRACE_H
+#define LEDISASM_PARALLEL_TRACE_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "persistent_map.hpp"
+
+class Disassembler;
+class Image;
+class Instruction;
+class Region;
+
+/** Deque of work items, owned by one thread and robbed by the others.
+ *
+ * The owner takes the newest items, so it keeps working near the code
+ * it has just decoded; thieves take the oldest ones.
+ */
+template <typename T>
+class WorkStealingDeque
+{
+protected:
+  std::deque<T> items;
+  std::mutex lock;
+
+public:
+  void push (const T &item)
+  {
+    std::lock_guard<std::mutex> guard (this->lock);
+    this->items.push_back (item);
+  }
+
+  bool pop (T *ret)
+  {
+    std::lock_guard<std::mutex> guard (this->lock);
+    if (this->items.empty ())
+      return false;
+    *ret = this->items.back ();
+    this->items.pop_back ();
+    return true;
+  }
+
+  bool steal (T *ret)
+  {
+    std::lock_guard<std::mutex> guard (this->lock);
+    if (this->items.empty ())
+      return false;
+    *ret = this->items.front ();
+    this->items.pop_front ();
+    return true;
+  }
+};
+
+/** Decodes reachable code ahead of the analyser, using many threads.
+ *
+ * Only decoding is parallel. Tracing decides regions and labels in an
+ * order-dependent way, so it is not done here; claims of instruction
+ * starts only keep workers from decoding the same run twice. Instead,
+ * every instruction reachable from the roots is decoded once, in
+ * parallel, and the results are kept per address. The analyser then runs
+ * its usual serial trace, taking instructions from this cache, which
+ * makes the result identical to a single thread run.
+ *
+ * Worker threads are started on the first predecode() and kept waiting
+ * between calls, since the analyser predecodes before every trace, often
+ * from just a few roots.
+ */
+class ParallelTracer
+{
+public:
+  typedef PersistentMap<uint32_t, Region> RegionMap;
+
+  /** Instruction decoded by a worker, stored at its start offset. */
+  struct Decoded
+  {
+    uint32_t target;
+    uint8_t  size;    /**< zero if not decoded */
+    uint8_t  type;
+    uint8_t  valid;
+  };
+
+  struct Stats
+  {
+    size_t decoded;   /**< instructions decoded by workers */
+    size_t steals;    /**< work items taken from other threads */
+    size_t hits;      /**< instructions served from the cache */
+    size_t misses;    /**< instructions decoded again while replaying */
+  };
+
+protected:
+  struct ObjectState
+  {
+    uint32_t base_address;
+    uint32_t size;
+    std::vector<Decoded> insns;
+    std::unique_ptr<std::atomic<uint8_t>[]> claims;
+  };
+
+  struct Worker;
+
+protected:
+  const Image *image;
+  size_t thread_count;
+  std::vector<ObjectState> objects;
+  Stats stats;
+
+  /* Pool of threads, woken for each predecode() */
+  std::unique_ptr<Worker[]> workers;
+  std::vector<std::thread> threads;
+  std::mutex pool_lock;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  uint64_t generation;  /**< of the batch being decoded */
+  size_t busy;          /**< pool threads not done with the batch */
+  bool stopping;
+  const RegionMap *regions;  /**< of the batch being decoded */
+  std::atomic<size_t> pending;
+
+  /* Workers out of work wait until an item is queued or the batch ends */
+  std::mutex work_lock;
+  std::condition_variable work_ready;
+  std::atomic<uint64_t> work_posted;
+  std::atomic<size_t> sleepers;
+
+protected:
+  ObjectState *get_state (uint32_t address);
+  void start_threads (void);
+  void run_thread (size_t index);
+  void run_worker (size_t index);
+  void trace_run (Worker *worker, uint32_t address);
+  void post_work (void);
+  void wait_for_work (uint64_t posted);
+
+public:
+  ParallelTracer (const Image *image, size_t thread_count);
+  ~ParallelTracer (void);
+
+  size_t get_thread_count (void) const;
+  void predecode (const std::vector<uint32_t> &roots,
+                  const RegionMap *regions);
+  bool lookup (uint32_t address, size_t length, Instruction *ret);
+  void clear (void);
+  const Stats *get_stats (void) const;
+  size_t get_memory_used (void) const;
+
+  static bool is_supported (void);
+};
+
+#endif // LEDISASM_PARALLEL_TRACE_H
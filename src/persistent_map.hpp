@@ -0,0 +1,977 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file persistent_map.hpp
+ *     Header file with PersistentMap template, an ordered map which shares
+ *     its nodes between copies.
+ * @par Purpose:
+ *     Storage for PersistentMap class, used for regions and labels so that
+ *     snapshots of the analysis are cheap to take and to compare.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_PERSISTENT_MAP_H
+#define LEDISASM_PERSISTENT_MAP_H
+
+#include <inttypes.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/** Ordered map with the interface of std::map, sharing nodes on copy.
+ *
+ * The map is a treap with priorities hashed from the keys, so its shape
+ * depends only on the set of keys. Copying a map only takes a reference
+ * to the root; a node is copied, along with the path leading to it, when
+ * it is first changed through a map which shares it. Two maps coming from
+ * one another can then be compared in time of the changes made.
+ *
+ * Const methods do not touch the nodes, so they may be called from many
+ * threads at once. Non-const ones may copy nodes: after a map is copied,
+ * pointers and iterators taken from it before still read the old values,
+ * but must not be used to change it. Keys must be integers of up to
+ * 32 bits.
+ *
+ * Iterators keep the path from the root to their node, so stepping takes
+ * constant time on average. The first step is found from the root, like
+ * a lookup, and the path is made on the second one; once the map is
+ * changed, it is made again from the key of the node. Only dereferencing
+ * an iterator, not stepping it, makes the nodes on its path owned by the
+ * map.
+ */
+template <typename K, typename V>
+class PersistentMap
+{
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<const K, V> value_type;
+  typedef size_t size_type;
+
+  /** Entry which differs between two maps. */
+  struct Change
+  {
+    K key;
+    const V *before;  /**< NULL if the key was added */
+    const V *after;   /**< NULL if the key was removed */
+  };
+
+protected:
+  struct Node
+  {
+    value_type value;
+    Node *left;
+    Node *right;
+    size_t size;        /**< of the subtree */
+    uint32_t refs;      /**< maps and nodes pointing here */
+    uint32_t priority;
+
+    Node (const value_type &val)
+      : value (val), left (NULL), right (NULL), size (1), refs (1),
+        priority (get_priority (val.first))
+    {
+    }
+  };
+
+  /** Part of a map waiting to be compared: a subtree, or a single node. */
+  struct Cursor
+  {
+    const Node *node;
+    bool subtree;
+  };
+
+  typedef std::vector<Node *> Path;
+
+  /** Place of an iterator within the map. */
+  struct Position
+  {
+    Node *node;
+    Path path;       /**< from the root to the node, once stepped twice */
+    size_t version;  /**< of the map when the path was made */
+    size_t owned;    /**< leading nodes of the path owned by the map */
+    bool stepped;
+    bool writable;   /**< the node is owned by the map */
+
+    Position (Node *n)
+      : node (n), version (0), owned (0), stepped (false), writable (false)
+    {
+    }
+  };
+
+public:
+  class const_iterator;
+
+  class iterator
+  {
+  protected:
+    friend class PersistentMap;
+    friend class const_iterator;
+
+    PersistentMap *map;
+    mutable Position pos;
+
+    iterator (PersistentMap *m, Node *n) : map (m), pos (n) {}
+
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef std::pair<const K, V> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef value_type *pointer;
+    typedef value_type &reference;
+
+    iterator (void) : map (NULL), pos (NULL) {}
+
+    reference
+    operator* (void) const
+    {
+      return this->map->own_position (&this->pos)->value;
+    }
+
+    pointer
+    operator-> (void) const
+    {
+      return &this->map->own_position (&this->pos)->value;
+    }
+
+    iterator &
+    operator++ (void)
+    {
+      this->map->step_next (&this->pos);
+      return *this;
+    }
+
+    iterator &
+    operator-- (void)
+    {
+      this->map->step_previous (&this->pos);
+      return *this;
+    }
+
+    iterator
+    operator++ (int)
+    {
+      iterator ret (*this);
+      ++*this;
+      return ret;
+    }
+
+    iterator
+    operator-- (int)
+    {
+      iterator ret (*this);
+      --*this;
+      return ret;
+    }
+
+    bool operator== (const iterator &other) const
+    {
+      return this->pos.node == other.pos.node;
+    }
+
+    bool operator!= (const iterator &other) const
+    {
+      return this->pos.node != other.pos.node;
+    }
+  };
+
+  class const_iterator
+  {
+  protected:
+    friend class PersistentMap;
+
+    const PersistentMap *map;
+    Position pos;
+
+    const_iterator (const PersistentMap *m, Node *n) : map (m), pos (n) {}
+
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef std::pair<const K, V> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type *pointer;
+    typedef const value_type &reference;
+
+    const_iterator (void) : map (NULL), pos (NULL) {}
+    const_iterator (const iterator &itr) : map (itr.map), pos (itr.pos) {}
+
+    reference operator* (void) const { return this->pos.node->value; }
+    pointer operator-> (void) const { return &this->pos.node->value; }
+
+    const_iterator &
+    operator++ (void)
+    {
+      this->map->step_next (&this->pos);
+      return *this;
+    }
+
+    const_iterator &
+    operator-- (void)
+    {
+      this->map->step_previous (&this->pos);
+      return *this;
+    }
+
+    const_iterator
+    operator++ (int)
+    {
+      const_iterator ret (*this);
+      ++*this;
+      return ret;
+    }
+
+    const_iterator
+    operator-- (int)
+    {
+      const_iterator ret (*this);
+      --*this;
+      return ret;
+    }
+
+    bool operator== (const const_iterator &other) const
+    {
+      return this->pos.node == other.pos.node;
+    }
+
+    bool operator!= (const const_iterator &other) const
+    {
+      return this->pos.node != other.pos.node;
+    }
+  };
+
+protected:
+  Node *root;
+  size_t version;  /**< changed whenever iterator paths may go stale */
+
+protected:
+  /** Mixes bits of the key; a bijection, so no two keys share priority. */
+  static uint32_t
+  get_priority (uint32_t key)
+  {
+    key ^= key >> 16;
+    key *= 0x7feb352d;
+    key ^= key >> 15;
+    key *= 0x846ca68b;
+    key ^= key >> 16;
+    return key;
+  }
+
+  static size_t
+  get_size (const Node *node)
+  {
+    return (node != NULL) ? node->size : 0;
+  }
+
+  static void
+  update_size (Node *node)
+  {
+    node->size = 1 + get_size (node->left) + get_size (node->right);
+  }
+
+  static Node *
+  retain (Node *node)
+  {
+    if (node != NULL)
+      node->refs++;
+
+    return node;
+  }
+
+  static void
+  release (Node *node)
+  {
+    if (node == NULL or --node->refs > 0)
+      return;
+
+    release (node->left);
+    release (node->right);
+    delete node;
+  }
+
+  /** Gives a node only referenced by the caller, copying it if shared.
+   * The reference of the caller is moved to the returned node. */
+  static Node *
+  own (Node *node)
+  {
+    Node *copy;
+
+    if (node->refs == 1)
+      return node;
+
+    copy = new Node (node->value);
+    copy->left = retain (node->left);
+    copy->right = retain (node->right);
+    copy->size = node->size;
+    node->refs--;
+    return copy;
+  }
+
+  static void
+  rotate_left (Node **slot)
+  {
+    Node *node = *slot;
+    Node *right = node->right;
+
+    node->right = right->left;
+    right->left = node;
+    update_size (node);
+    update_size (right);
+    *slot = right;
+  }
+
+  static void
+  rotate_right (Node **slot)
+  {
+    Node *node = *slot;
+    Node *left = node->left;
+
+    node->left = left->right;
+    left->right = node;
+    update_size (node);
+    update_size (left);
+    *slot = left;
+  }
+
+  /** Inserts the value unless the key exists; gives the node of the key. */
+  static Node *
+  insert_node (Node **slot, const K &key, const V &value, bool *inserted)
+  {
+    Node *node;
+    Node *ret;
+
+    if (*slot == NULL)
+      {
+        *slot = new Node (value_type (key, value));
+        *inserted = true;
+        return *slot;
+      }
+
+    node = *slot = own (*slot);
+
+    if (key < node->value.first)
+      {
+        ret = insert_node (&node->left, key, value, inserted);
+        if (*inserted)
+          {
+            node->size++;
+            if (node->left->priority > node->priority)
+              rotate_right (slot);
+          }
+      }
+    else if (node->value.first < key)
+      {
+        ret = insert_node (&node->right, key, value, inserted);
+        if (*inserted)
+          {
+            node->size++;
+            if (node->right->priority > node->priority)
+              rotate_left (slot);
+          }
+      }
+    else
+      ret = node;
+
+    return ret;
+  }
+
+  /** Joins two trees with all keys of the first below the second. */
+  static Node *
+  join (Node *first, Node *second)
+  {
+    if (first == NULL)
+      return second;
+
+    if (second == NULL)
+      return first;
+
+    if (first->priority > second->priority)
+      {
+        first = own (first);
+        first->right = join (first->right, second);
+        update_size (first);
+        return first;
+      }
+
+    second = own (second);
+    second->left = join (first, second->left);
+    update_size (second);
+    return second;
+  }
+
+  /** Removes the key, which must exist in the tree. */
+  static void
+  erase_node (Node **slot, const K &key)
+  {
+    Node *node;
+
+    node = *slot = own (*slot);
+
+    if (key < node->value.first)
+      erase_node (&node->left, key);
+    else if (node->value.first < key)
+      erase_node (&node->right, key);
+    else
+      {
+        *slot = join (node->left, node->right);
+        delete node;
+        return;
+      }
+
+    node->size--;
+  }
+
+  Node *
+  find_node (const K &key) const
+  {
+    Node *node;
+
+    for (node = this->root; node != NULL;)
+      {
+        if (key < node->value.first)
+          node = node->left;
+        else if (node->value.first < key)
+          node = node->right;
+        else
+          return node;
+      }
+
+    return NULL;
+  }
+
+  /** Gives the first node with key not below the given one, or above it
+   * if asked. */
+  Node *
+  find_bound (const K &key, bool upper) const
+  {
+    Node *node;
+    Node *ret;
+
+    ret = NULL;
+
+    for (node = this->root; node != NULL;)
+      {
+        if (key < node->value.first
+            or (!upper and !(node->value.first < key)))
+          {
+            ret = node;
+            node = node->left;
+          }
+        else
+          node = node->right;
+      }
+
+    return ret;
+  }
+
+  /** Gives the node before given one, or the last one if NULL is given. */
+  Node *
+  find_previous (const Node *next) const
+  {
+    Node *node;
+    Node *ret;
+
+    ret = NULL;
+
+    for (node = this->root; node != NULL;)
+      {
+        if (next == NULL or node->value.first < next->value.first)
+          {
+            ret = node;
+            node = node->right;
+          }
+        else
+          node = node->left;
+      }
+
+    return ret;
+  }
+
+  /** Owns nodes on the way to the key, which must exist; gives its node. */
+  Node *
+  own_key (const K &key, bool *copied)
+  {
+    Node **slot;
+    Node *node;
+
+    for (slot = &this->root;;)
+      {
+        node = own (*slot);
+        *copied = *copied or (node != *slot);
+        *slot = node;
+
+        if (key < node->value.first)
+          slot = &node->left;
+        else if (node->value.first < key)
+          slot = &node->right;
+        else
+          return node;
+      }
+  }
+
+  /** Makes the path to the first node with key not below the given one,
+   * or above it if asked; the path is empty if there is none. */
+  void
+  seek (const K &key, bool upper, Position *pos) const
+  {
+    Node *node;
+    size_t depth;
+
+    pos->path.clear ();
+    depth = 0;
+
+    for (node = this->root; node != NULL;)
+      {
+        pos->path.push_back (node);
+
+        if (key < node->value.first
+            or (!upper and !(node->value.first < key)))
+          {
+            depth = pos->path.size ();
+            node = node->left;
+          }
+        else
+          node = node->right;
+      }
+
+    pos->path.resize (depth);
+    pos->owned = 0;
+  }
+
+  void
+  set_position (Position *pos, size_t kept) const
+  {
+    pos->node = pos->path.empty () ? NULL : pos->path.back ();
+    pos->version = this->version;
+    pos->owned = std::min (pos->owned, kept);
+    pos->stepped = true;
+    pos->writable = false;
+  }
+
+  /** Moves a position without a path by one node, found from the root;
+   * a single step, as lookups make, needs no path. */
+  void
+  set_node (Position *pos, Node *node) const
+  {
+    pos->node = node;
+    pos->path.clear ();
+    pos->version = this->version;
+    pos->owned = 0;
+    pos->stepped = true;
+    pos->writable = false;
+  }
+
+  /** Moves to the next node: down the right subtree if there is one,
+   * otherwise up to the first parent on the right. */
+  void
+  step_next (Position *pos) const
+  {
+    Path *path = &pos->path;
+    Node *node;
+    size_t kept;
+
+    if (path->empty () or pos->version != this->version)
+      {
+        if (!pos->stepped)
+          this->set_node (pos, this->find_bound (pos->node->value.first,
+                                                 true));
+        else
+          {
+            this->seek (pos->node->value.first, true, pos);
+            this->set_position (pos, 0);
+          }
+        return;
+      }
+
+    node = path->back ();
+    if (node->right != NULL)
+      {
+        kept = path->size ();
+        for (node = node->right; node != NULL; node = node->left)
+          path->push_back (node);
+      }
+    else
+      {
+        do
+          {
+            node = path->back ();
+            path->pop_back ();
+          }
+        while (!path->empty () and path->back ()->right == node);
+
+        kept = path->size ();
+      }
+
+    this->set_position (pos, kept);
+  }
+
+  /** Moves to the node before, or to the last one from the end. */
+  void
+  step_previous (Position *pos) const
+  {
+    Path *path = &pos->path;
+    Node *node;
+    size_t kept;
+
+    if (pos->node == NULL or path->empty ()
+        or pos->version != this->version)
+      {
+        if (!pos->stepped)
+          {
+            this->set_node (pos, this->find_previous (pos->node));
+            return;
+          }
+
+        if (pos->node == NULL)
+          path->clear ();
+        else
+          this->seek (pos->node->value.first, false, pos);
+      }
+
+    if (path->empty ())
+      node = this->root;
+    else if (path->back ()->left != NULL)
+      node = path->back ()->left;
+    else
+      {
+        do
+          {
+            node = path->back ();
+            path->pop_back ();
+          }
+        while (!path->empty () and path->back ()->left == node);
+
+        this->set_position (pos, path->size ());
+        return;
+      }
+
+    kept = path->size ();
+    for (; node != NULL; node = node->right)
+      path->push_back (node);
+
+    this->set_position (pos, kept);
+  }
+
+  /** Makes nodes on the path of an iterator owned by this map, so that
+   * its value can be changed; gives its node. */
+  Node *
+  own_position (Position *pos)
+  {
+    Node **slot;
+    Node *node;
+    Node *parent;
+    size_t n;
+    bool copied;
+
+    if (pos->writable and pos->version == this->version)
+      return pos->node;
+
+    copied = false;
+
+    if (pos->path.empty () or pos->version != this->version)
+      {
+        node = this->own_key (pos->node->value.first, &copied);
+        pos->path.clear ();
+        pos->owned = 0;
+      }
+    else
+      {
+        if (pos->owned == 0)
+          slot = &this->root;
+        else
+          {
+            parent = pos->path[pos->owned - 1];
+            slot = (parent->left == pos->path[pos->owned]) ? &parent->left
+                                                           : &parent->right;
+          }
+
+        for (n = pos->owned; n < pos->path.size (); n++)
+          {
+            node = own (*slot);
+            copied = copied or (node != *slot);
+            *slot = node;
+            pos->path[n] = node;
+
+            if (n + 1 < pos->path.size ())
+              slot = (node->left == pos->path[n + 1]) ? &node->left
+                                                      : &node->right;
+          }
+
+        node = pos->path.back ();
+        pos->owned = pos->path.size ();
+      }
+
+    /* Other iterators may hold copied nodes in their paths */
+    if (copied)
+      this->version++;
+
+    pos->node = node;
+    pos->version = this->version;
+    pos->writable = true;
+    return node;
+  }
+
+  static void
+  push_subtree (std::vector<Cursor> *stack, const Node *node)
+  {
+    Cursor cur;
+
+    if (node == NULL)
+      return;
+
+    cur.node = node;
+    cur.subtree = true;
+    stack->push_back (cur);
+  }
+
+  /** Replaces the subtree on top with its parts, smallest keys on top. */
+  static void
+  expand_subtree (std::vector<Cursor> *stack)
+  {
+    Cursor cur;
+
+    cur = stack->back ();
+    stack->pop_back ();
+    push_subtree (stack, cur.node->right);
+    cur.subtree = false;
+    stack->push_back (cur);
+    push_subtree (stack, cur.node->left);
+  }
+
+  static void
+  add_change (std::vector<Change> *ret, const Node *before,
+              const Node *after)
+  {
+    Change change;
+
+    change.key = (before != NULL) ? before->value.first : after->value.first;
+    change.before = (before != NULL) ? &before->value.second : NULL;
+    change.after = (after != NULL) ? &after->value.second : NULL;
+    ret->push_back (change);
+  }
+
+public:
+  PersistentMap (void) : root (NULL), version (0) {}
+
+  PersistentMap (const PersistentMap &other)
+    : root (retain (other.root)), version (0) {}
+
+  ~PersistentMap (void)
+  {
+    release (this->root);
+  }
+
+  PersistentMap &
+  operator= (const PersistentMap &other)
+  {
+    Node *old = this->root;
+
+    this->root = retain (other.root);
+    this->version++;
+    release (old);
+    return *this;
+  }
+
+  iterator
+  begin (void)
+  {
+    return iterator (this, this->leftmost ());
+  }
+
+  const_iterator
+  begin (void) const
+  {
+    return const_iterator (this, this->leftmost ());
+  }
+
+  iterator end (void) { return iterator (this, NULL); }
+  const_iterator end (void) const { return const_iterator (this, NULL); }
+
+  bool empty (void) const { return this->root == NULL; }
+  size_t size (void) const { return get_size (this->root); }
+
+  void
+  clear (void)
+  {
+    release (this->root);
+    this->root = NULL;
+    this->version++;
+  }
+
+  iterator
+  find (const K &key)
+  {
+    return iterator (this, this->find_node (key));
+  }
+
+  const_iterator
+  find (const K &key) const
+  {
+    return const_iterator (this, this->find_node (key));
+  }
+
+  iterator
+  lower_bound (const K &key)
+  {
+    return iterator (this, this->find_bound (key, false));
+  }
+
+  const_iterator
+  lower_bound (const K &key) const
+  {
+    return const_iterator (this, this->find_bound (key, false));
+  }
+
+  iterator
+  upper_bound (const K &key)
+  {
+    return iterator (this, this->find_bound (key, true));
+  }
+
+  const_iterator
+  upper_bound (const K &key) const
+  {
+    return const_iterator (this, this->find_bound (key, true));
+  }
+
+  V &
+  operator[] (const K &key)
+  {
+    bool inserted = false;
+
+    this->version++;
+    return insert_node (&this->root, key, V (), &inserted)->value.second;
+  }
+
+  /** Inserts unless the key exists; the hint is not needed by a treap. */
+  iterator
+  emplace_hint (const_iterator, const K &key, const V &value)
+  {
+    bool inserted = false;
+
+    this->version++;
+    return iterator (this, insert_node (&this->root, key, value, &inserted));
+  }
+
+  size_t
+  erase (const K &key)
+  {
+    if (this->find_node (key) == NULL)
+      return 0;
+
+    erase_node (&this->root, key);
+    this->version++;
+    return 1;
+  }
+
+  iterator
+  erase (iterator itr)
+  {
+    K key = itr->first;
+
+    erase_node (&this->root, key);
+    this->version++;
+    return this->lower_bound (key);
+  }
+
+  template <typename Equal>
+  static void diff (const PersistentMap &before, const PersistentMap &after,
+                    Equal equal, std::vector<Change> *ret);
+
+protected:
+  Node *
+  leftmost (void) const
+  {
+    Node *node;
+
+    node = this->root;
+    if (node != NULL)
+      while (node->left != NULL)
+        node = node->left;
+
+    return node;
+  }
+};
+
+/** Lists keys added, removed or with values not equal between two maps,
+ * in order of keys.
+ *
+ * Both trees are walked in order at once; subtrees shared by the maps
+ * are skipped whole, and the larger of two differing subtrees is opened
+ * first, so that shared subtrees within it are met. Values are compared
+ * with given functor. The changes point into the maps, so are valid until
+ * either is changed.
+ */
+template <typename K, typename V>
+template <typename Equal>
+void
+PersistentMap<K, V>::diff (const PersistentMap &before,
+                           const PersistentMap &after, Equal equal,
+                           std::vector<Change> *ret)
+{
+  std::vector<Cursor> first;
+  std::vector<Cursor> second;
+  const Cursor *a;
+  const Cursor *b;
+
+  push_subtree (&first, before.root);
+  push_subtree (&second, after.root);
+
+  for (;;)
+    {
+      a = first.empty () ? NULL : &first.back ();
+      b = second.empty () ? NULL : &second.back ();
+
+      if (a != NULL and b != NULL and a->subtree and b->subtree
+          and a->node == b->node)
+        {
+          first.pop_back ();
+          second.pop_back ();
+          continue;
+        }
+
+      if (a != NULL and a->subtree
+          and (b == NULL or !b->subtree or a->node->size >= b->node->size))
+        {
+          expand_subtree (&first);
+          continue;
+        }
+
+      if (b != NULL and b->subtree)
+        {
+          expand_subtree (&second);
+          continue;
+        }
+
+      if (a == NULL and b == NULL)
+        break;
+
+      if (b == NULL
+          or (a != NULL and a->node->value.first < b->node->value.first))
+        {
+          add_change (ret, a->node, NULL);
+          first.pop_back ();
+        }
+      else if (a == NULL or b->node->value.first < a->node->value.first)
+        {
+          add_change (ret, NULL, b->node);
+          second.pop_back ();
+        }
+      else
+        {
+          if (a->node != b->node
+              and !equal (a->node->value.second, b->node->value.second))
+            add_change (ret, a->node, b->node);
+
+          first.pop_back ();
+          second.pop_back ();
+        }
+    }
+}
+
+#endif // LEDISASM_PERSISTENT_MAP_H
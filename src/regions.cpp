@@ -24,6 +24,7 @@ Region::Region (uint32_t address, uint32_t size, Region::Type type)
   this->address = address;
   this->size    = size;
   this->type    = type;
+  this->origin  = ANALYSIS;
 }
 
 Region::Region (void)
@@ -31,6 +32,7 @@ Region::Region (void)
   this->address = 0;
   this->size    = 0;
   this->type    = UNKNOWN;
+  this->origin  = ANALYSIS;
 }
 
 Region::Region (const Region &other)
@@ -56,6 +58,20 @@ Region::get_type (void) const
   return this->type;
 }
 
+Region::Origin
+Region::get_origin (void) const
+{
+  return this->origin;
+}
+
+/** Sets where the region comes from; analysis does not undo hints and
+ * known file fixups. */
+void
+Region::set_origin (Region::Origin origin)
+{
+  this->origin = origin;
+}
+
 bool
 Region::contains_address (uint32_t addr) const
 {
@@ -44,10 +44,18 @@ public:
     VTABLE
   };
 
+  enum Origin
+  {
+    ANALYSIS,  /**< from tracing or data detection */
+    HINT,      /**< from a hint file */
+    KNOWN      /**< from fixups of a known file */
+  };
+
 protected:
   uint32_t address;
   uint32_t size;
   Region::Type type;
+  Region::Origin origin;
 
 public:
   Region (uint32_t address, uint32_t size = 1, Region::Type type = UNKNOWN);
@@ -57,6 +65,8 @@ public:
   uint32_t get_address (void) const;
   size_t   get_end_address (void) const;
   Region::Type get_type (void) const;
+  Region::Origin get_origin (void) const;
+  void     set_origin (Region::Origin origin);
   bool     contains_address (uint32_t addr) const;
   size_t   get_size (void) const;
 };
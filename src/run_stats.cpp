@@ -0,0 +1,228 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file run_stats.cpp
+ *     Implementation of methods for RunStats class.
+ * @par Purpose:
+ *     Implementation of RunStats class methods, which time phases of a run
+ *     and write the results as JSON.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include "config.h"
+
+#include <iomanip>
+
+#ifdef HAVE_SYS_RESOURCE_H
+# include <sys/resource.h>
+#endif
+
+#include "run_stats.hpp"
+#include "trace_events.hpp"
+#include "util.hpp"
+
+RunStats::RunStats (void)
+{
+  this->current = NULL;
+  this->cpu_start = 0;
+  this->trace_start = 0;
+}
+
+void
+RunStats::begin (const char *name)
+{
+  this->end ();
+  this->current = name;
+  this->wall_start = std::chrono::steady_clock::now ();
+  this->cpu_start = std::clock ();
+
+  if (TraceRecorder::is_enabled ())
+    this->trace_start = TraceRecorder::now ();
+}
+
+/** Ends the current phase, if any, and records its times. */
+void
+RunStats::end (void)
+{
+  std::chrono::duration<double> wall;
+  Phase phase;
+
+  if (this->current == NULL)
+    return;
+
+  wall = std::chrono::steady_clock::now () - this->wall_start;
+
+  phase.name = this->current;
+  phase.wall = wall.count ();
+  phase.cpu = (double) (std::clock () - this->cpu_start) / CLOCKS_PER_SEC;
+  this->phases.push_back (phase);
+
+  if (TraceRecorder::is_enabled ())
+    TraceRecorder::record (this->current, "phase", this->trace_start,
+                           NULL, 0);
+
+  this->current = NULL;
+}
+
+/** Adds finished phases of other stats after these ones. */
+void
+RunStats::append (const RunStats &other)
+{
+  this->phases.insert (this->phases.end (), other.phases.begin (),
+                       other.phases.end ());
+}
+
+/** Attaches memory usage to the last finished phase. */
+void
+RunStats::set_memory (const MemoryUsage &usage)
+{
+  if (!this->phases.empty ())
+    this->phases.back ().memory = usage;
+}
+
+void
+RunStats::set_counter (const std::string &name, uint64_t value)
+{
+  size_t n;
+
+  for (n = 0; n < this->counters.size (); n++)
+    {
+      if (this->counters[n].first == name)
+        {
+          this->counters[n].second = value;
+          return;
+        }
+    }
+
+  this->counters.push_back (std::make_pair (name, value));
+}
+
+const std::vector<RunStats::Phase> *
+RunStats::get_phases (void) const
+{
+  return &this->phases;
+}
+
+/** Gives peak resident memory of the process in bytes, or zero if it is
+ * not known on this platform. */
+uint64_t
+RunStats::get_peak_rss (void)
+{
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+# ifdef __APPLE__
+  return usage.ru_maxrss;
+# else
+  return (uint64_t) usage.ru_maxrss * 1024;
+# endif
+#else
+  return 0;
+#endif
+}
+
+/** Writes phases and counters; names are expected to need no escaping. */
+void
+RunStats::write_json (std::ostream *os) const
+{
+  const MemoryUsage *mem;
+  double wall, cpu;
+  size_t n, k;
+
+  PUSH_IOS_FLAGS (os);
+  os->setf (std::ios::dec, std::ios::basefield);
+  os->setf (std::ios::fixed, std::ios::floatfield);
+  *os << std::setprecision (6);
+
+  wall = 0;
+  cpu = 0;
+
+  *os << "{\n  \"phases\": [";
+
+  for (n = 0; n < this->phases.size (); n++)
+    {
+      *os << (n ? ",\n" : "\n")
+          << "    {\"name\": \"" << this->phases[n].name
+          << "\", \"wall_seconds\": " << this->phases[n].wall
+          << ", \"cpu_seconds\": " << this->phases[n].cpu;
+
+      mem = &this->phases[n].memory;
+
+      if (!mem->parts.empty ())
+        {
+          *os << ",\n     \"memory_bytes\": {\"total\": " << mem->get_total ();
+
+          for (k = 0; k < mem->parts.size (); k++)
+            *os << ", \"" << mem->parts[k].first << "\": "
+                << mem->parts[k].second;
+
+          *os << "}";
+        }
+
+      *os << "}";
+      wall += this->phases[n].wall;
+      cpu += this->phases[n].cpu;
+    }
+
+  *os << "\n  ],\n"
+      << "  \"total\": {\"wall_seconds\": " << wall
+      << ", \"cpu_seconds\": " << cpu << "},\n"
+      << "  \"counters\": {";
+
+  for (n = 0; n < this->counters.size (); n++)
+    *os << (n ? ",\n" : "\n")
+        << "    \"" << this->counters[n].first << "\": "
+        << this->counters[n].second;
+
+  *os << "\n  }\n}\n";
+}
+
+CountingStreamBuf::CountingStreamBuf (std::ostream *stream)
+{
+  this->stream = stream;
+  this->target = stream->rdbuf (this);
+  this->count = 0;
+}
+
+CountingStreamBuf::~CountingStreamBuf (void)
+{
+  this->stream->flush ();
+  this->stream->rdbuf (this->target);
+}
+
+CountingStreamBuf::int_type
+CountingStreamBuf::overflow (int_type ch)
+{
+  if (traits_type::eq_int_type (ch, traits_type::eof ()))
+    return traits_type::not_eof (ch);
+
+  this->count++;
+  return this->target->sputc (traits_type::to_char_type (ch));
+}
+
+std::streamsize
+CountingStreamBuf::xsputn (const char *s, std::streamsize n)
+{
+  this->count += n;
+  return this->target->sputn (s, n);
+}
+
+int
+CountingStreamBuf::sync (void)
+{
+  return this->target->pubsync ();
+}
+
+uint64_t
+CountingStreamBuf::get_count (void) const
+{
+  return this->count;
+}
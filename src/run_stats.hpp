@@ -0,0 +1,96 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file run_stats.hpp
+ *     Header file for run_stats.cpp, with declaration of RunStats.
+ * @par Purpose:
+ *     Storage for RunStats class which measures time of phases of a run,
+ *     and keeps counters to be written as JSON.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_RUN_STATS_H
+#define LEDISASM_RUN_STATS_H
+
+#include <inttypes.h>
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.hpp"
+
+/** Wall and CPU time of named phases, and named counters.
+ *
+ * Phases follow each other; starting one ends the previous. CPU time is
+ * that of the whole process, so it includes all threads. Names are kept
+ * as given, so they must be strings with static storage; phases are also
+ * recorded as trace events, while TraceRecorder is enabled.
+ */
+class RunStats
+{
+public:
+  struct Phase
+  {
+    std::string name;
+    double wall;  /**< in seconds */
+    double cpu;
+    MemoryUsage memory;  /**< at the end, if measured */
+  };
+
+protected:
+  std::vector<Phase> phases;
+  std::vector<std::pair<std::string, uint64_t> > counters;
+  const char *current;
+  std::chrono::steady_clock::time_point wall_start;
+  std::clock_t cpu_start;
+  uint64_t trace_start;
+
+public:
+  RunStats (void);
+
+  void begin (const char *name);
+  void end (void);
+  void append (const RunStats &other);
+  void set_memory (const MemoryUsage &usage);
+  void set_counter (const std::string &name, uint64_t value);
+
+  const std::vector<Phase> *get_phases (void) const;
+  void write_json (std::ostream *os) const;
+
+  static uint64_t get_peak_rss (void);
+};
+
+/** Stream buffer counting output of a stream, while installed on it.
+ *
+ * Output is passed on to the previous buffer of the stream, which is
+ * given back to the stream on destruction.
+ */
+class CountingStreamBuf : public std::streambuf
+{
+protected:
+  std::ostream *stream;
+  std::streambuf *target;
+  uint64_t count;
+
+protected:
+  virtual int_type overflow (int_type ch);
+  virtual std::streamsize xsputn (const char *s, std::streamsize n);
+  virtual int sync (void);
+
+public:
+  CountingStreamBuf (std::ostream *stream);
+  virtual ~CountingStreamBuf (void);
+
+  uint64_t get_count (void) const;
+};
+
+#endif // LEDISASM_RUN_STATS_H
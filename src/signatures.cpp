@@ -0,0 +1,322 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file signatures.cpp
+ *     Implementation of methods for SignatureIndex class.
+ * @par Purpose:
+ *     Implementation of SignatureIndex class methods, which load signatures
+ *     of library functions and match them against code.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+#include "error.hpp"
+#include "signatures.hpp"
+#include "util.hpp"
+
+/** Amount of leading bytes searched for the indexed run. */
+#define SIG_KEY_WINDOW 32
+/** Length of the indexed run of fixed bytes. */
+#define SIG_KEY_LENGTH 4
+/** Fewest fixed bytes a pattern needs not to match by chance. */
+#define SIG_MIN_FIXED 8
+
+SignatureIndex::SignatureIndex (void)
+{
+  this->keys_sorted = true;
+  this->stats = Stats ();
+}
+
+uint64_t
+SignatureIndex::make_key (size_t offset, const uint8_t *bytes)
+{
+  return ((uint64_t) offset << 32) | read_le<uint32_t> (bytes);
+}
+
+static int
+hex_digit_value (char c)
+{
+  if (c >= '0' and c <= '9')
+    return c - '0';
+
+  c = tolower (c);
+  if (c >= 'a' and c <= 'f')
+    return c - 'a' + 10;
+
+  return -1;
+}
+
+bool
+SignatureIndex::parse_pattern (const std::string &text, Signature *ret)
+{
+  size_t n;
+  int hi, lo;
+
+  ret->bytes.clear ();
+  ret->mask.clear ();
+  ret->fixed = 0;
+
+  for (n = 0; n < text.size (); n++)
+    {
+      if (isspace ((unsigned char) text[n]))
+        continue;
+
+      if (n + 1 >= text.size ())
+        return false;
+
+      if (text[n] == '.' and text[n + 1] == '.')
+        {
+          ret->bytes.push_back (0);
+          ret->mask.push_back (0);
+          n++;
+          continue;
+        }
+
+      hi = hex_digit_value (text[n]);
+      lo = hex_digit_value (text[n + 1]);
+      if (hi < 0 or lo < 0)
+        return false;
+
+      ret->bytes.push_back (hi << 4 | lo);
+      ret->mask.push_back (1);
+      ret->fixed++;
+      n++;
+    }
+
+  return true;
+}
+
+/** Checks whether the name can be used as an assembler symbol. */
+bool
+SignatureIndex::is_valid_name (const std::string &name)
+{
+  size_t n;
+
+  if (name.empty () or isdigit ((unsigned char) name[0]))
+    return false;
+
+  for (n = 0; n < name.size (); n++)
+    {
+      if (!isalnum ((unsigned char) name[n]) and name[n] != '_'
+          and name[n] != '.' and name[n] != '$' and name[n] != '@'
+          and name[n] != '?')
+        return false;
+    }
+
+  return true;
+}
+
+/** Adds a signature.
+ *
+ * @return False if the name or pattern is not valid, or the pattern has too
+ *     few fixed bytes to be trusted.
+ */
+bool
+SignatureIndex::add (const std::string &name, const std::string &pattern)
+{
+  Signature sig;
+  size_t index;
+  size_t off, n;
+
+  if (!is_valid_name (name) or !parse_pattern (pattern, &sig)
+      or sig.fixed < SIG_MIN_FIXED)
+    return false;
+
+  sig.name = name;
+  index = this->signatures.size ();
+  this->signatures.push_back (sig);
+
+  for (off = 0; off + SIG_KEY_LENGTH <= std::min<size_t> (sig.bytes.size (),
+                                                          SIG_KEY_WINDOW);
+       off++)
+    {
+      for (n = 0; n < SIG_KEY_LENGTH and sig.mask[off + n] != 0; n++)
+        ;
+
+      if (n < SIG_KEY_LENGTH)
+        continue;
+
+      this->keys.push_back (Key (make_key (off, &sig.bytes[off]), index));
+      this->keys_sorted = false;
+      return true;
+    }
+
+  this->unkeyed.push_back (index);
+  return true;
+}
+
+/** Loads signatures from a file; invalid lines are reported and skipped. */
+void
+SignatureIndex::load_file (const std::string &fname)
+{
+  std::ifstream ifs;
+  std::string line;
+  std::string name;
+  size_t start, end;
+  size_t line_no;
+  size_t invalid;
+
+  ifs.open (fname);
+  if (!ifs.is_open ())
+    throw Error () << "Error opening file: " << fname;
+
+  line_no = 0;
+  invalid = 0;
+
+  while (std::getline (ifs, line))
+    {
+      line_no++;
+
+      start = line.find_first_not_of (" \t\r");
+      if (start == std::string::npos or line[start] == '#')
+        continue;
+
+      end = line.find_first_of (" \t", start);
+      if (end == std::string::npos)
+        end = line.size ();
+
+      name = line.substr (start, end - start);
+
+      if (!this->add (name, line.substr (end)))
+        {
+          if (invalid++ == 0)
+            std::cerr << "Warning: Invalid signature at " << fname << ":"
+                      << line_no << ".\n";
+        }
+    }
+
+  if (invalid > 1)
+    std::cerr << "Warning: " << invalid << " invalid signatures in "
+              << fname << ".\n";
+}
+
+size_t
+SignatureIndex::get_count (void) const
+{
+  return this->signatures.size ();
+}
+
+bool
+SignatureIndex::matches (const Signature *sig, const uint8_t *data,
+                         const uint8_t *relocated, size_t size) const
+{
+  size_t n;
+
+  if (sig->bytes.size () > size)
+    return false;
+
+  for (n = 0; n < sig->bytes.size (); n++)
+    {
+      if (sig->mask[n] != 0 and relocated[n] == 0
+          and data[n] != sig->bytes[n])
+        return false;
+    }
+
+  return true;
+}
+
+/** Keeps the signature with most fixed bytes; equal ones of different
+ * names make the match ambiguous.
+ */
+void
+SignatureIndex::consider (const Signature *sig, const Signature **best,
+                          bool *ambiguous) const
+{
+  if (*best == NULL or sig->fixed > (*best)->fixed)
+    {
+      *best = sig;
+      *ambiguous = false;
+    }
+  else if (sig->fixed == (*best)->fixed and sig->name != (*best)->name)
+    *ambiguous = true;
+}
+
+/** Finds the signature of a function.
+ *
+ * @param relocated Non-zero for bytes changed by fixups, same size as data.
+ * @return The best matching signature, or NULL if none or more than one
+ *     match equally well.
+ */
+const SignatureIndex::Signature *
+SignatureIndex::match (const uint8_t *data, const uint8_t *relocated,
+                       size_t size)
+{
+  std::vector<Key>::const_iterator itr;
+  std::vector<size_t>::const_iterator uitr;
+  const Signature *best;
+  const Signature *sig;
+  bool ambiguous;
+  uint64_t key;
+  size_t off, n;
+
+  if (!this->keys_sorted)
+    {
+      std::sort (this->keys.begin (), this->keys.end ());
+      this->keys_sorted = true;
+    }
+
+  best = NULL;
+  ambiguous = false;
+
+  for (off = 0; off + SIG_KEY_LENGTH <= std::min<size_t> (size, SIG_KEY_WINDOW);
+       off++)
+    {
+      for (n = 0; n < SIG_KEY_LENGTH and relocated[off + n] == 0; n++)
+        ;
+
+      /* Signatures made from other builds have no fixed bytes at fixups */
+      if (n < SIG_KEY_LENGTH)
+        continue;
+
+      key = make_key (off, data + off);
+      this->stats.probes++;
+
+      itr = std::lower_bound (this->keys.begin (), this->keys.end (),
+                              Key (key, 0));
+
+      for (; itr != this->keys.end () and itr->first == key; ++itr)
+        {
+          sig = &this->signatures[itr->second];
+          this->stats.candidates++;
+
+          if (this->matches (sig, data, relocated, size))
+            this->consider (sig, &best, &ambiguous);
+        }
+    }
+
+  for (uitr = this->unkeyed.begin (); uitr != this->unkeyed.end (); ++uitr)
+    {
+      sig = &this->signatures[*uitr];
+      this->stats.candidates++;
+
+      if (this->matches (sig, data, relocated, size))
+        this->consider (sig, &best, &ambiguous);
+    }
+
+  if (best == NULL)
+    return NULL;
+
+  if (ambiguous)
+    {
+      this->stats.ambiguous++;
+      return NULL;
+    }
+
+  this->stats.matches++;
+  return best;
+}
+
+const SignatureIndex::Stats *
+SignatureIndex::get_stats (void) const
+{
+  return &this->stats;
+}
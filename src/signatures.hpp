@@ -0,0 +1,88 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file signatures.hpp
+ *     Header file for signatures.cpp, with declaration of SignatureIndex.
+ * @par Purpose:
+ *     Storage for SignatureIndex class which recognizes statically linked
+ *     library functions by masked byte patterns of their code.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_SIGNATURES_H
+#define LEDISASM_SIGNATURES_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Byte patterns of library functions, indexed for matching many at once.
+ *
+ * A signature file has one signature per line: a name, then a pattern of
+ * hex bytes from the function start, where ".." matches any byte; spaces
+ * within the pattern are ignored, and lines starting with '#' are comments.
+ *
+ * Each signature is indexed by its first run of four fixed bytes within
+ * the first SIG_KEY_WINDOW bytes, together with the offset of that run;
+ * matching probes every offset of the window once, so its cost hardly
+ * depends on amount of signatures. Bytes of the code which are targets of
+ * fixups match anything, as they depend on where the library was linked.
+ */
+class SignatureIndex
+{
+public:
+  struct Signature
+  {
+    std::string name;
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> mask;  /**< non-zero for bytes which must match */
+    size_t fixed;               /**< amount of bytes which must match */
+  };
+
+  struct Stats
+  {
+    size_t probes;
+    size_t candidates;
+    size_t matches;
+    size_t ambiguous;
+  };
+
+protected:
+  typedef std::pair<uint64_t, size_t> Key;
+
+protected:
+  std::vector<Signature> signatures;
+  std::vector<Key> keys;         /**< sorted by key value when matching */
+  bool keys_sorted;
+  std::vector<size_t> unkeyed;   /**< signatures checked on every match */
+  Stats stats;
+
+protected:
+  static uint64_t make_key (size_t offset, const uint8_t *bytes);
+  static bool parse_pattern (const std::string &text, Signature *ret);
+  static bool is_valid_name (const std::string &name);
+  bool matches (const Signature *sig, const uint8_t *data,
+                const uint8_t *relocated, size_t size) const;
+  void consider (const Signature *sig, const Signature **best,
+                 bool *ambiguous) const;
+
+public:
+  SignatureIndex (void);
+
+  bool add (const std::string &name, const std::string &pattern);
+  void load_file (const std::string &fname);
+  size_t get_count (void) const;
+
+  const Signature *match (const uint8_t *data, const uint8_t *relocated,
+                          size_t size);
+  const Stats *get_stats (void) const;
+};
+
+#endif // LEDISASM_SIGNATURES_H
@@ -0,0 +1,234 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file speculation.cpp
+ *     Implementation of methods for SpeculativeTracer class.
+ * @par Purpose:
+ *     Implementation of SpeculativeTracer class methods, which trace
+ *     guessed functions privately, using several threads.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+#include <deque>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "disassembler.hpp"
+#include "image.hpp"
+#include "instruction.hpp"
+#include "regions.hpp"
+#include "speculation.hpp"
+
+SpeculativeTracer::SpeculativeTracer (const Image *image, size_t thread_count)
+{
+  this->image = image;
+  this->thread_count = std::max (thread_count, (size_t) 1);
+}
+
+/** Traces a guess and everything reachable from it into a delta.
+ *
+ * Follows the same rules as Analyser::trace_code_at_address(), but keeps
+ * the result private. Tracing stops at the first reason to reject it.
+ */
+void
+SpeculativeTracer::trace_guess (Disassembler *disasm,
+                                const RegionMap *regions, Delta *delta)
+{
+  std::map<uint32_t, uint32_t> insns;
+  std::map<uint32_t, uint32_t>::const_iterator iitr;
+  std::vector<std::pair<uint32_t, uint32_t> > branches;
+  std::deque<uint32_t> queue;
+  RegionMap::const_iterator ritr;
+  const Image::Object *obj;
+  const uint8_t *data;
+  Instruction inst;
+  Run run;
+  size_t end_addr;
+  size_t addr;
+  size_t n;
+
+  delta->runs.clear ();
+  delta->verdict = VALID;
+  delta->culprit = 0;
+  queue.push_back (delta->root);
+
+  while (!queue.empty () and delta->verdict == VALID)
+    {
+      run.start = queue.front ();
+      queue.pop_front ();
+
+      if (insns.find (run.start) != insns.end ())
+        continue;
+
+      obj = this->image->get_object_at_address (run.start);
+      ritr = regions->upper_bound (run.start);
+      if (obj == NULL or ritr == regions->begin ()
+          or (--ritr)->second.get_end_address () <= run.start)
+        {
+          delta->verdict = UNMAPPED;
+          delta->culprit = run.start;
+          break;
+        }
+
+      if (ritr->second.get_type () == Region::DATA
+          or ritr->second.get_type () == Region::VTABLE)
+        {
+          delta->verdict = INTO_DATA;
+          delta->culprit = run.start;
+          break;
+        }
+
+      if (ritr->second.get_type () != Region::UNKNOWN) /* already traced */
+        continue;
+
+      end_addr = ritr->second.get_end_address ();
+      data = &obj->get_data ()->front ();
+
+      for (addr = run.start; addr < end_addr; )
+        {
+          if (insns.find (addr) != insns.end ())
+            break;
+
+          try
+            {
+              disasm->decode (addr, data + (addr - obj->get_base_address ()),
+                              end_addr - addr, &inst);
+            }
+          catch (...)
+            {
+              delta->verdict = BAD_OPCODE;
+              delta->culprit = addr;
+              break;
+            }
+
+          insns[addr] = inst.get_size ();
+
+          if (!inst.is_valid ())
+            {
+              delta->verdict = BAD_OPCODE;
+              delta->culprit = addr;
+              addr += inst.get_size ();
+              break;
+            }
+
+          if (inst.get_target () != 0
+              and (inst.get_type () == Instruction::CALL
+                   or inst.get_type () == Instruction::COND_JUMP
+                   or inst.get_type () == Instruction::JUMP))
+            {
+              branches.push_back (std::make_pair (addr, inst.get_target ()));
+              queue.push_back (inst.get_target ());
+            }
+
+          addr += inst.get_size ();
+
+          if (inst.get_type () == Instruction::JUMP
+              or inst.get_type () == Instruction::RET)
+            break;
+        }
+
+      run.end = addr;
+      delta->runs.push_back (run);
+    }
+
+  if (delta->verdict != VALID)
+    return;
+
+  for (n = 0; n < branches.size (); n++)
+    {
+      iitr = insns.upper_bound (branches[n].second);
+      if (iitr == insns.begin ())
+        continue;
+
+      --iitr;
+      if (iitr->first < branches[n].second
+          and branches[n].second < iitr->first + iitr->second)
+        {
+          delta->verdict = MID_INSTRUCTION;
+          delta->culprit = branches[n].first;
+          return;
+        }
+    }
+}
+
+void
+SpeculativeTracer::run_worker (const RegionMap *regions,
+                               std::vector<Delta> *deltas,
+                               std::atomic<size_t> *next)
+{
+  Disassembler disasm;
+  size_t n;
+
+  while ((n = next->fetch_add (1)) < deltas->size ())
+    this->trace_guess (&disasm, regions, &(*deltas)[n]);
+}
+
+/** Traces each of given guesses into its own delta.
+ *
+ * Regions must not change while this runs. Deltas are returned in the
+ * order of the roots, regardless of the amount of threads.
+ */
+void
+SpeculativeTracer::trace (const std::vector<uint32_t> &roots,
+                          const RegionMap *regions, std::vector<Delta> *ret)
+{
+  std::vector<std::thread> threads;
+  std::atomic<size_t> next (0);
+  size_t n;
+
+  ret->resize (roots.size ());
+  for (n = 0; n < roots.size (); n++)
+    (*ret)[n].root = roots[n];
+
+  for (n = 1; n < this->thread_count and n < roots.size (); n++)
+    {
+      try
+        {
+          threads.push_back (std::thread (&SpeculativeTracer::run_worker,
+                                          this, regions, ret, &next));
+        }
+      catch (const std::system_error &)
+        {
+          break;
+        }
+    }
+
+  this->run_worker (regions, ret, &next);
+
+  for (n = 0; n < threads.size (); n++)
+    threads[n].join ();
+}
+
+std::ostream &
+operator<< (std::ostream &os, SpeculativeTracer::Verdict v)
+{
+  switch (v)
+    {
+    case SpeculativeTracer::VALID:
+      os << "valid";
+      break;
+    case SpeculativeTracer::BAD_OPCODE:
+      os << "bad opcode";
+      break;
+    case SpeculativeTracer::INTO_DATA:
+      os << "branch into data";
+      break;
+    case SpeculativeTracer::MID_INSTRUCTION:
+      os << "branch into middle of instruction";
+      break;
+    case SpeculativeTracer::UNMAPPED:
+      os << "branch to unmapped address";
+      break;
+    default:
+      os << "(unknown " << std::dec << (int) v << ")";
+      break;
+    }
+  return os;
+}
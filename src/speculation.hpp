@@ -0,0 +1,88 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file speculation.hpp
+ *     Header file for speculation.cpp, with declaration of SpeculativeTracer.
+ * @par Purpose:
+ *     Storage for SpeculativeTracer class which traces guessed functions
+ *     privately, so that the analyser can decide whether to keep them.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_SPECULATION_H
+#define LEDISASM_SPECULATION_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "persistent_map.hpp"
+
+class Disassembler;
+class Image;
+class Region;
+
+/** Traces code from guessed addresses without touching the analysis.
+ *
+ * Every guess is traced on its own against a snapshot of regions, into
+ * a delta listing the linear runs of code it would create. The delta is
+ * then checked, and the analyser either commits it by tracing the guess
+ * for real, or discards it.
+ */
+class SpeculativeTracer
+{
+public:
+  typedef PersistentMap<uint32_t, Region> RegionMap;
+
+  /** Reason for rejecting a delta; VALID if there is none. */
+  enum Verdict
+  {
+    VALID,
+    BAD_OPCODE,       /**< a run reached an undecodable instruction */
+    INTO_DATA,        /**< a branch targets a known data region */
+    MID_INSTRUCTION,  /**< a branch targets the inside of an instruction */
+    UNMAPPED          /**< a branch targets no object at all */
+  };
+
+  /** Linear run of instructions, as trace_code_at_address() makes. */
+  struct Run
+  {
+    uint32_t start;
+    uint32_t end;
+  };
+
+  struct Delta
+  {
+    uint32_t root;
+    std::vector<Run> runs;   /**< runs[0] starts at root, if any */
+    Verdict verdict;
+    uint32_t culprit;        /**< address which caused the verdict */
+  };
+
+protected:
+  const Image *image;
+  size_t thread_count;
+
+protected:
+  void trace_guess (Disassembler *disasm, const RegionMap *regions,
+                    Delta *delta);
+  void run_worker (const RegionMap *regions, std::vector<Delta> *deltas,
+                   std::atomic<size_t> *next);
+
+public:
+  SpeculativeTracer (const Image *image, size_t thread_count);
+
+  void trace (const std::vector<uint32_t> &roots, const RegionMap *regions,
+              std::vector<Delta> *ret);
+};
+
+std::ostream &operator<< (std::ostream &os, SpeculativeTracer::Verdict v);
+
+#endif // LEDISASM_SPECULATION_H
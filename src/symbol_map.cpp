@@ -18,6 +18,7 @@
 #include <iostream>
 #include <map>
 
+#include "memory_usage.hpp"
 #include "symbol_map.hpp"
 #include "symbol.hpp"
 #include "util.hpp"
@@ -26,6 +27,22 @@ SymbolMap::SymbolMap ()
 {
 }
 
+/** Adds memory of symbol nodes and their names. */
+void
+SymbolMap::get_memory_usage (MemoryUsage *ret) const
+{
+  map_type::const_iterator itr;
+  size_t names;
+
+  names = 0;
+  for (itr = this->map.begin (); itr != this->map.end (); ++itr)
+    names += itr->second.get_name_memory ();
+
+  ret->add ("symbols", this->map.size ()
+                       * tree_node_memory<map_type::value_type> ());
+  ret->add ("symbol_names", names);
+}
+
 const Symbol *
 SymbolMap::get_symbol(uint32_t address)
 {
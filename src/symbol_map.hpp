@@ -23,6 +23,8 @@
 
 #include "symbol.hpp"
 
+struct MemoryUsage;
+
 class SymbolMap
 {
   using map_type = std::map<uint32_t, Symbol>;
@@ -56,6 +58,8 @@ public:
 
   void load_file_map(std::string &fileName);
 
+  void get_memory_usage (MemoryUsage *ret) const;
+
   iterator begin() const noexcept { return iterator{ map.begin() } ; }
   iterator end() const noexcept { return iterator{ map.end() } ; }
 
@@ -0,0 +1,192 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file trace_events.cpp
+ *     Implementation of methods for TraceRecorder class.
+ * @par Purpose:
+ *     Implementation of TraceRecorder class methods, which keep spans in
+ *     per-thread rings and write them as Chrome trace events.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <chrono>
+#include <iomanip>
+
+#include "trace_events.hpp"
+#include "util.hpp"
+
+bool TraceRecorder::enabled = false;
+size_t TraceRecorder::ring_capacity = 0;
+uint64_t TraceRecorder::epoch = 0;
+std::mutex TraceRecorder::rings_lock;
+std::vector<std::unique_ptr<TraceRecorder::Ring> > TraceRecorder::rings;
+std::vector<TraceRecorder::Ring *> TraceRecorder::free_rings;
+thread_local TraceRecorder::RingOwner TraceRecorder::thread_ring;
+
+TraceRecorder::Ring::Ring (size_t capacity, uint32_t thread_id)
+  : written (0)
+{
+  this->capacity = capacity;
+  this->thread_id = thread_id;
+}
+
+TraceRecorder::RingOwner::~RingOwner (void)
+{
+  if (this->ring == NULL)
+    return;
+
+  std::lock_guard<std::mutex> guard (rings_lock);
+
+  free_rings.push_back (this->ring);
+}
+
+/** Gives ring of the calling thread; on first use, takes one given back
+ * by an exited thread, or registers a new one. */
+TraceRecorder::Ring *
+TraceRecorder::get_ring (void)
+{
+  Ring *ring;
+
+  if (thread_ring.ring != NULL)
+    return thread_ring.ring;
+
+  std::lock_guard<std::mutex> guard (rings_lock);
+
+  if (!free_rings.empty ())
+    {
+      ring = free_rings.back ();
+      free_rings.pop_back ();
+    }
+  else
+    {
+      ring = new Ring (ring_capacity, rings.size () + 1);
+      rings.push_back (std::unique_ptr<Ring> (ring));
+    }
+
+  thread_ring.ring = ring;
+
+  return ring;
+}
+
+/** Starts recording; has to be called before any thread is started. */
+void
+TraceRecorder::enable (size_t events_per_thread)
+{
+  if (enabled or events_per_thread == 0)
+    return;
+
+  ring_capacity = events_per_thread;
+  epoch = 0;
+  epoch = now ();
+  enabled = true;
+}
+
+/** Gives time in nanoseconds since recording began. */
+uint64_t
+TraceRecorder::now (void)
+{
+  std::chrono::nanoseconds ns;
+
+  ns = std::chrono::duration_cast<std::chrono::nanoseconds>
+         (std::chrono::steady_clock::now ().time_since_epoch ());
+
+  return ns.count () - epoch;
+}
+
+/** Records span from given start until now. */
+void
+TraceRecorder::record (const char *name, const char *category,
+                       uint64_t start, const char *arg_name, uint64_t arg)
+{
+  TraceEvent *event;
+  uint64_t written;
+  Ring *ring;
+
+  ring = get_ring ();
+  written = ring->written.load (std::memory_order_relaxed);
+
+  /* Until full, the ring only holds what was recorded */
+  if (written < ring->capacity)
+    ring->events.push_back (TraceEvent ());
+
+  event = &ring->events[written % ring->capacity];
+
+  event->name = name;
+  event->category = category;
+  event->arg_name = arg_name;
+  event->arg = arg;
+  event->start = start;
+  event->duration = now () - start;
+
+  ring->written.store (written + 1, std::memory_order_release);
+}
+
+/** Writes events of all threads, oldest first within each thread.
+ *
+ * Times are given in microseconds, as the format expects. Events lost to
+ * full rings are counted in the metadata.
+ */
+void
+TraceRecorder::write_json (std::ostream *os)
+{
+  const TraceEvent *event;
+  const Ring *ring;
+  uint64_t written;
+  uint64_t first;
+  uint64_t dropped;
+  uint64_t n;
+  size_t r;
+  bool separate;
+
+  std::lock_guard<std::mutex> guard (rings_lock);
+
+  PUSH_IOS_FLAGS (os);
+  os->setf (std::ios::dec, std::ios::basefield);
+  os->setf (std::ios::fixed, std::ios::floatfield);
+  *os << std::setprecision (3);
+
+  dropped = 0;
+  separate = false;
+
+  *os << "{\"traceEvents\": [";
+
+  for (r = 0; r < rings.size (); r++)
+    {
+      ring = rings[r].get ();
+      written = ring->written.load (std::memory_order_acquire);
+      first = 0;
+
+      if (written > ring->capacity)
+        {
+          first = written - ring->capacity;
+          dropped += first;
+        }
+
+      for (n = first; n < written; n++)
+        {
+          event = &ring->events[n % ring->capacity];
+
+          *os << (separate ? ",\n" : "\n")
+              << "{\"name\": \"" << event->name
+              << "\", \"cat\": \"" << event->category
+              << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->thread_id
+              << ", \"ts\": " << event->start / 1000.0
+              << ", \"dur\": " << event->duration / 1000.0;
+
+          if (event->arg_name != NULL)
+            *os << ", \"args\": {\"" << event->arg_name << "\": "
+                << event->arg << "}";
+
+          *os << "}";
+          separate = true;
+        }
+    }
+
+  *os << "\n], \"displayTimeUnit\": \"ms\", "
+      << "\"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+}
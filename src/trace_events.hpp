@@ -0,0 +1,117 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file trace_events.hpp
+ *     Header file for trace_events.cpp, with declaration of TraceRecorder.
+ * @par Purpose:
+ *     Storage for TraceRecorder class which records spans of work done by
+ *     each thread, to be written as Chrome trace events.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_TRACE_EVENTS_H
+#define LEDISASM_TRACE_EVENTS_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/** Span of work; names must be strings with static storage. */
+struct TraceEvent
+{
+  const char *name;
+  const char *category;
+  const char *arg_name;  /**< NULL if the span has no argument */
+  uint64_t arg;
+  uint64_t start;        /**< in nanoseconds since recording began */
+  uint64_t duration;
+};
+
+/** Process wide recorder of spans, written in Chrome trace event format.
+ *
+ * Each thread records into its own ring of events, so recording takes no
+ * lock; only the first span of a thread takes a ring. Rings grow as spans
+ * are recorded, up to the capacity; when full, the oldest events are
+ * overwritten. A thread which exits gives its ring back, and the next new
+ * thread continues in it. Rings are read only after the threads are done,
+ * when the trace is written.
+ */
+class TraceRecorder
+{
+protected:
+  struct Ring
+  {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> written;
+    size_t capacity;
+    uint32_t thread_id;
+
+    Ring (size_t capacity, uint32_t thread_id);
+  };
+
+  /** Gives the ring of a thread back when the thread exits. */
+  struct RingOwner
+  {
+    Ring *ring;
+
+    RingOwner (void) : ring (NULL) {}
+    ~RingOwner (void);
+  };
+
+  static bool enabled;
+  static size_t ring_capacity;
+  static uint64_t epoch;
+  static std::mutex rings_lock;
+  static std::vector<std::unique_ptr<Ring> > rings;
+  static std::vector<Ring *> free_rings;
+  static thread_local RingOwner thread_ring;
+
+  static Ring *get_ring (void);
+
+public:
+  static void enable (size_t events_per_thread);
+  static bool is_enabled (void) { return enabled; }
+
+  static uint64_t now (void);
+  static void record (const char *name, const char *category,
+                      uint64_t start, const char *arg_name, uint64_t arg);
+
+  static void write_json (std::ostream *os);
+};
+
+/** Records the time from its construction to destruction as a span,
+ * while the recorder is enabled. */
+class TraceSpan
+{
+protected:
+  const char *name;
+  const char *arg_name;
+  uint64_t arg;
+  uint64_t start;
+
+public:
+  TraceSpan (const char *name, const char *arg_name = NULL, uint64_t arg = 0)
+  {
+    this->name = name;
+    this->arg_name = arg_name;
+    this->arg = arg;
+    this->start = TraceRecorder::is_enabled () ? TraceRecorder::now () : 0;
+  }
+
+  ~TraceSpan (void)
+  {
+    if (TraceRecorder::is_enabled ())
+      TraceRecorder::record (this->name, "span", this->start,
+                             this->arg_name, this->arg);
+  }
+};
+
+#endif // LEDISASM_TRACE_EVENTS_H
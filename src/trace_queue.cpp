@@ -0,0 +1,103 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file trace_queue.cpp
+ *     Implementation of TraceQueue class methods.
+ * @par Purpose:
+ *     Implements the TraceQueue class which keeps addresses waiting for
+ *     code tracing, in order of discovery.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+
+#include "trace_queue.hpp"
+
+/** Size of a memory page, used for counting locality of visits. */
+#define TRACE_PAGE_SHIFT 12
+
+TraceQueue::TraceQueue (void)
+{
+  this->last_address = 0;
+  this->stats = Stats ();
+}
+
+void
+TraceQueue::push (uint32_t address, Confidence confidence)
+{
+  Entry entry;
+
+  entry.address = address;
+  entry.confidence = confidence;
+
+  this->entries.push_back (entry);
+  this->stats.pushes++;
+  this->stats.max_size = std::max (this->stats.max_size,
+                                   this->entries.size ());
+}
+
+bool
+TraceQueue::pop (Entry *ret)
+{
+  if (this->entries.empty ())
+    return false;
+
+  *ret = this->entries.front ();
+  this->entries.pop_front ();
+  this->stats.pops++;
+
+  if (this->stats.pops > 1 and (ret->address >> TRACE_PAGE_SHIFT)
+                               != (this->last_address >> TRACE_PAGE_SHIFT))
+    this->stats.page_switches++;
+
+  this->last_address = ret->address;
+
+  return true;
+}
+
+/** Drops all queued entries, without counting them as popped. */
+void
+TraceQueue::clear (void)
+{
+  this->entries.clear ();
+}
+
+bool
+TraceQueue::empty (void) const
+{
+  return this->entries.empty ();
+}
+
+size_t
+TraceQueue::size (void) const
+{
+  return this->entries.size ();
+}
+
+/** Appends addresses of all queued entries, in order of visiting. */
+void
+TraceQueue::get_addresses (std::vector<uint32_t> *ret) const
+{
+  std::deque<Entry>::const_iterator itr;
+
+  for (itr = this->entries.begin (); itr != this->entries.end (); ++itr)
+    ret->push_back (itr->address);
+}
+
+/** Gives memory of queued entries, in bytes. */
+size_t
+TraceQueue::get_memory_used (void) const
+{
+  return this->entries.size () * sizeof (Entry);
+}
+
+const TraceQueue::Stats *
+TraceQueue::get_stats (void) const
+{
+  return &this->stats;
+}
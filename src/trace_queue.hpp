@@ -0,0 +1,80 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file trace_queue.hpp
+ *     Header file for trace_queue.cpp, with declaration of TraceQueue class.
+ * @par Purpose:
+ *     Storage for TraceQueue class which keeps addresses waiting for code
+ *     tracing, in order of discovery.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_TRACE_QUEUE_H
+#define LEDISASM_TRACE_QUEUE_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+/** Work list of addresses to trace code at.
+ *
+ * Addresses are visited in order of discovery. Tracing is not order
+ * independent: a run which reaches an invalid opcode is made data only
+ * if no address within it was traced first, and overlapping instructions
+ * decode differently from different starting points. So the order is
+ * kept fixed, and the output does not depend on anything else.
+ */
+class TraceQueue
+{
+public:
+  /** Origin of an address, starting from the most trusted one. */
+  enum Confidence
+  {
+    ENTRY,
+    SYMBOL,
+    VTABLE,
+    GUESS,
+    SCAN,
+    CONFIDENCE_COUNT
+  };
+
+  struct Entry
+  {
+    uint32_t address;
+    TraceQueue::Confidence confidence;
+  };
+
+  struct Stats
+  {
+    size_t pushes;
+    size_t pops;
+    size_t max_size;
+    size_t page_switches; /**< pops landing on other page than previous */
+  };
+
+protected:
+  std::deque<Entry> entries;
+  uint32_t last_address;
+  Stats stats;
+
+public:
+  TraceQueue (void);
+
+  void push (uint32_t address, Confidence confidence);
+  bool pop (Entry *ret);
+  void clear (void);
+  bool empty (void) const;
+  size_t size (void) const;
+  void get_addresses (std::vector<uint32_t> *ret) const;
+  size_t get_memory_used (void) const;
+
+  const Stats *get_stats (void) const;
+};
+
+#endif // LEDISASM_TRACE_QUEUE_H
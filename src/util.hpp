@@ -4,8 +4,8 @@
 /** @file util.hpp
  *     Header file for util.cpp, with small but useful utilities.
  * @par Purpose:
- *     Storage for functions and templates to handle endianness and
- *     printing extensions.
+ *     Storage for functions and templates to handle endianness, hashing
+ *     and printing extensions.
  * @author   Unavowed <unavowed@vexillium.org>
  * @date     2010-09-20 - 2024-01-10
  * @par  Copying and copyrights:
@@ -19,6 +19,7 @@
 
 #include <ostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 
@@ -62,11 +63,11 @@ public:
   IOSFormatSaver xxx_asdf_fmt_saver (sptr);
 
 
-template <typename K, typename V, typename C, typename A>
-V *
-get_next_value (std::map<K, V, C, A> *map, const K &key)
+template <typename MapType>
+typename MapType::value_type::second_type *
+get_next_value (MapType *map, const typename MapType::key_type &key)
 {
-  typename std::map<K, V, C, A>::iterator itr;
+  typename MapType::iterator itr;
 
   itr = map->upper_bound (key);
   if (itr == map->end ())
@@ -103,6 +104,62 @@ get_previous_value (MapType *map, const typename MapType::key_type &key)
   return &itr->second;
 }
 
+/** Value shared between copies of its holder until one of them changes
+ * it; changing goes through edit(), which copies the value if shared.
+ */
+template <typename T>
+class CopyOnWrite
+{
+protected:
+  std::shared_ptr<T> value;
+
+public:
+  CopyOnWrite (void) : value (std::make_shared<T> ()) {}
+
+  const T &operator* (void) const { return *this->value; }
+  const T *operator-> (void) const { return this->value.get (); }
+
+  T *
+  edit (void)
+  {
+    if (this->value.use_count () > 1)
+      this->value = std::make_shared<T> (*this->value);
+
+    return this->value.get ();
+  }
+
+  /** Drops the value, without copying it if shared. */
+  void
+  reset (void)
+  {
+    this->value = std::make_shared<T> ();
+  }
+};
+
+/** Moves a cursor forward to the lower bound of given key.
+ *
+ * Meant for merging sorted sequences into a map: when the key is close
+ * to the cursor, it is reached by stepping; otherwise a regular lookup
+ * is made. The cursor must not be past the lower bound already.
+ */
+template <typename MapType, typename Iterator>
+Iterator
+seek_lower_bound (MapType *map, Iterator itr,
+                  const typename MapType::key_type &key)
+{
+  size_t steps;
+
+  for (steps = 0; steps < 8; steps++)
+    {
+      if (itr == map->end () or !(itr->first < key))
+        return itr;
+
+      ++itr;
+    }
+
+  return map->lower_bound (key);
+}
+
 
 template <typename T, size_t Bytes>
 void
@@ -156,6 +213,16 @@ read_s8 (const void *memory)
   return *(int8_t *) memory;
 }
 
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+/** Adds a value to an FNV-1a hash, which starts at FNV_OFFSET_BASIS. */
+static inline uint64_t
+hash_step (uint64_t hash, unsigned int value)
+{
+  return (hash ^ value) * FNV_PRIME;
+}
+
 template <typename T>
 void
 print_variable (std::ostream *os, size_t value_column,
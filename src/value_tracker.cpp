@@ -0,0 +1,481 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file value_tracker.cpp
+ *     Implementation of methods for ValueTracker class.
+ * @par Purpose:
+ *     Implementation of ValueTracker class methods, which follow relocated
+ *     immediates through registers and stack slots of a basic block.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include "util.hpp"
+#include "value_tracker.hpp"
+
+ValueTracker::ValueTracker (void)
+{
+  this->reset ();
+}
+
+/** Forgets all values, as at the start of a basic block. */
+void
+ValueTracker::reset (void)
+{
+  this->known_regs = 0;
+  this->slot_count = 0;
+  this->esp_delta = 0;
+}
+
+void
+ValueTracker::set_reg (int reg, bool known, uint32_t value)
+{
+  if (reg == REG_ESP)
+    {
+      this->clear_slots ();
+      return;
+    }
+
+  this->regs[reg] = value;
+
+  if (known)
+    this->known_regs |= 1 << reg;
+  else
+    this->known_regs &= ~(1 << reg);
+}
+
+void
+ValueTracker::clear_reg (int reg)
+{
+  this->set_reg (reg, false, 0);
+}
+
+bool
+ValueTracker::get_reg (int reg, uint32_t *value) const
+{
+  if ((this->known_regs & (1 << reg)) == 0)
+    return false;
+
+  *value = this->regs[reg];
+  return true;
+}
+
+void
+ValueTracker::set_slot (int32_t offset, bool known, uint32_t value)
+{
+  size_t n;
+
+  for (n = 0; n < this->slot_count; n++)
+    {
+      if (this->slots[n].offset == offset)
+        break;
+    }
+
+  if (!known)
+    {
+      if (n < this->slot_count)
+        this->slots[n] = this->slots[--this->slot_count];
+      return;
+    }
+
+  if (n == this->slot_count)
+    {
+      /* Out of slots; the oldest one is forgotten */
+      if (n == SLOT_COUNT)
+        {
+          for (n = 1; n < SLOT_COUNT; n++)
+            this->slots[n - 1] = this->slots[n];
+
+          n = SLOT_COUNT - 1;
+        }
+      else
+        this->slot_count++;
+    }
+
+  this->slots[n].offset = offset;
+  this->slots[n].value = value;
+}
+
+bool
+ValueTracker::get_slot (int32_t offset, uint32_t *value) const
+{
+  size_t n;
+
+  for (n = 0; n < this->slot_count; n++)
+    {
+      if (this->slots[n].offset == offset)
+        {
+          *value = this->slots[n].value;
+          return true;
+        }
+    }
+
+  return false;
+}
+
+/** Forgets stack slots, when esp changes in an unknown way. */
+void
+ValueTracker::clear_slots (void)
+{
+  this->slot_count = 0;
+  this->esp_delta = 0;
+}
+
+/** Checks for a [esp], [esp+disp8] or [esp+disp32] operand.
+ *
+ * @param modrm ModRM byte, followed by the rest of the instruction.
+ * @param length Set to length of ModRM, SIB and displacement.
+ */
+bool
+ValueTracker::get_stack_slot (const uint8_t *modrm, size_t size,
+                              int32_t *disp, size_t *length)
+{
+  uint8_t mod;
+
+  mod = modrm[0] >> 6;
+
+  if (mod == 3 or (modrm[0] & 7) != 4 or size < 2 or modrm[1] != 0x24)
+    return false;
+
+  if (mod == 0)
+    {
+      *disp = 0;
+      *length = 2;
+    }
+  else if (mod == 1 and size >= 3)
+    {
+      *disp = (int8_t) modrm[2];
+      *length = 3;
+    }
+  else if (mod == 2 and size >= 6)
+    {
+      *disp = (int32_t) read_le<uint32_t> (modrm + 2);
+      *length = 6;
+    }
+  else
+    return false;
+
+  return true;
+}
+
+/** Handles instructions with ModRM operand.
+ *
+ * @return False if the instruction is not recognized.
+ */
+bool
+ValueTracker::step_modrm (uint8_t opcode, const uint8_t *data, size_t size,
+                          uint32_t relocs, uint32_t *target, Use *use)
+{
+  uint8_t mod, reg, rm;
+  bool slot;
+  int32_t disp;
+  int32_t offset;
+  size_t length;
+  uint32_t value;
+  bool known;
+
+  if (size < 2)
+    return false;
+
+  mod = data[1] >> 6;
+  reg = (data[1] >> 3) & 7;
+  rm = data[1] & 7;
+  disp = 0;
+  length = 0;
+  slot = get_stack_slot (data + 1, size - 1, &disp, &length);
+  offset = this->esp_delta + disp;
+  value = 0;
+  known = false;
+
+  /* ALU operations of the first rows, by their direction and size */
+  if (opcode < 0x40 and (opcode & 7) < 4)
+    {
+      /* cmp writes nothing */
+      if ((opcode & 0xf8) == 0x38)
+        return true;
+
+      if ((opcode & 2) != 0)
+        this->clear_reg ((opcode & 1) ? reg : reg & 3);
+      else if (mod == 3)
+        this->clear_reg ((opcode & 1) ? rm : rm & 3);
+      else if (slot)
+        this->set_slot (offset, false, 0);
+
+      return true;
+    }
+
+  switch (opcode)
+    {
+    case 0x84: /* test */
+    case 0x85:
+      return true;
+
+    case 0x86: /* xchg */
+    case 0x87:
+    case 0x88: /* mov to r/m8 */
+    case 0x8a: /* mov to r8 */
+    case 0xc0: /* shifts */
+    case 0xc1:
+    case 0xc6: /* mov r/m8,imm8 */
+    case 0xd0:
+    case 0xd1:
+    case 0xd2:
+    case 0xd3:
+    case 0xfe: /* inc, dec r/m8 */
+      if (opcode == 0xc6 and reg != 0)
+        return false;
+
+      if (opcode == 0xfe and reg > 1)
+        return false;
+
+      if (opcode == 0x86 or opcode == 0x87 or opcode == 0x8a)
+        this->clear_reg (opcode == 0x87 ? reg : reg & 3);
+
+      if (mod == 3)
+        this->clear_reg ((opcode & 1) ? rm : rm & 3);
+      else if (slot)
+        this->set_slot (offset, false, 0);
+
+      return true;
+
+    case 0x89: /* mov r/m32,r32 */
+      known = this->get_reg (reg, &value);
+
+      if (mod == 3)
+        this->set_reg (rm, known, value);
+      else if (slot)
+        this->set_slot (offset, known, value);
+
+      return true;
+
+    case 0x8b: /* mov r32,r/m32 */
+      if (mod == 3)
+        known = this->get_reg (rm, &value);
+      else if (slot)
+        known = this->get_slot (offset, &value);
+
+      this->set_reg (reg, known, value);
+      return true;
+
+    case 0x8d: /* lea */
+    case 0x69: /* imul */
+    case 0x6b:
+      this->clear_reg (reg);
+      return true;
+
+    case 0xc7: /* mov r/m32,imm32 */
+      if (reg != 0)
+        return false;
+
+      if (mod == 3)
+        {
+          if (size < 6)
+            return false;
+
+          this->set_reg (rm, (relocs & (1 << 2)) != 0,
+                         read_le<uint32_t> (data + 2));
+        }
+      else if (slot)
+        {
+          if (size < 1 + length + 4)
+            return false;
+
+          this->set_slot (offset, (relocs & (1 << (1 + length))) != 0,
+                          read_le<uint32_t> (data + 1 + length));
+        }
+
+      return true;
+
+    case 0x80: /* group 1 with immediate */
+    case 0x81:
+    case 0x83:
+      if (reg == 7) /* cmp */
+        return true;
+
+      if (mod == 3 and rm == REG_ESP and opcode != 0x80
+          and (reg == 0 or reg == 5))
+        {
+          if (opcode == 0x81)
+            {
+              if (size < 6)
+                return false;
+
+              disp = (int32_t) read_le<uint32_t> (data + 2);
+            }
+          else
+            disp = (int8_t) data[2];
+
+          this->esp_delta += (reg == 0) ? disp : -disp;
+          return true;
+        }
+
+      if (mod == 3)
+        this->clear_reg ((opcode == 0x80) ? rm & 3 : rm);
+      else if (slot)
+        this->set_slot (offset, false, 0);
+
+      return true;
+
+    case 0xf6: /* group 3 */
+    case 0xf7:
+      if (reg <= 1) /* test */
+        return true;
+
+      if (reg >= 4) /* mul, imul, div, idiv */
+        {
+          this->clear_reg (0);
+          if (opcode == 0xf7)
+            this->clear_reg (2);
+          return true;
+        }
+
+      if (mod == 3)
+        this->clear_reg ((opcode == 0xf7) ? rm : rm & 3);
+      else if (slot)
+        this->set_slot (offset, false, 0);
+
+      return true;
+
+    case 0xff: /* group 5 */
+      switch (reg)
+        {
+        case 0: /* inc */
+        case 1: /* dec */
+          if (mod == 3)
+            this->clear_reg (rm);
+          else if (slot)
+            this->set_slot (offset, false, 0);
+          return true;
+
+        case 2: /* call */
+        case 4: /* jmp */
+          if (mod == 3)
+            known = this->get_reg (rm, &value);
+          else if (slot)
+            known = this->get_slot (offset, &value);
+
+          if (known)
+            {
+              *target = value;
+              *use = (reg == 2) ? CALL : JUMP;
+            }
+
+          /* Callee may change anything */
+          this->reset ();
+          return true;
+
+        case 6: /* push */
+          if (mod == 3)
+            known = this->get_reg (rm, &value);
+          else if (slot)
+            known = this->get_slot (offset, &value);
+
+          this->esp_delta -= 4;
+          this->set_slot (this->esp_delta, known, value);
+          return true;
+
+        default:
+          return false;
+        }
+
+    default:
+      return false;
+    }
+}
+
+/** Updates known values by an instruction.
+ *
+ * @param relocs Bit n set if a fixup starts at byte n of the instruction.
+ * @param target Set to the target, if a known value is called or jumped to.
+ * @return How the target is used, or NONE if there is no target known.
+ */
+ValueTracker::Use
+ValueTracker::step (const uint8_t *data, size_t size, uint32_t relocs,
+                    uint32_t *target)
+{
+  uint8_t opcode;
+  uint32_t value;
+  bool known;
+  Use use;
+
+  if (size == 0)
+    {
+      this->reset ();
+      return NONE;
+    }
+
+  opcode = data[0];
+  use = NONE;
+  value = 0;
+
+  if (opcode >= 0xb8 and opcode <= 0xbf and size == 5) /* mov r32,imm32 */
+    this->set_reg (opcode & 7, (relocs & (1 << 1)) != 0,
+                   read_le<uint32_t> (data + 1));
+  else if (opcode >= 0xb0 and opcode <= 0xb7) /* mov r8,imm8 */
+    this->clear_reg (opcode & 3);
+  else if (opcode >= 0x40 and opcode <= 0x4f) /* inc, dec */
+    this->clear_reg (opcode & 7);
+  else if (opcode >= 0x50 and opcode <= 0x57) /* push r32 */
+    {
+      known = this->get_reg (opcode & 7, &value);
+      this->esp_delta -= 4;
+      this->set_slot (this->esp_delta, known, value);
+    }
+  else if (opcode >= 0x58 and opcode <= 0x5f) /* pop r32 */
+    {
+      known = this->get_slot (this->esp_delta, &value);
+      this->set_slot (this->esp_delta, false, 0);
+      this->esp_delta += 4;
+      this->set_reg (opcode & 7, known, value);
+    }
+  else if (opcode == 0x68 and size == 5) /* push imm32 */
+    {
+      this->esp_delta -= 4;
+      this->set_slot (this->esp_delta, (relocs & (1 << 1)) != 0,
+                      read_le<uint32_t> (data + 1));
+    }
+  else if (opcode == 0x6a) /* push imm8 */
+    {
+      this->esp_delta -= 4;
+      this->set_slot (this->esp_delta, false, 0);
+    }
+  else if (opcode >= 0x91 and opcode <= 0x97) /* xchg eax,r32 */
+    {
+      uint32_t other = 0;
+      bool other_known;
+
+      known = this->get_reg (0, &value);
+      other_known = this->get_reg (opcode & 7, &other);
+      this->set_reg (0, other_known, other);
+      this->set_reg (opcode & 7, known, value);
+    }
+  else if (opcode < 0x40 and ((opcode & 7) == 4 or (opcode & 7) == 5))
+    {
+      /* ALU operations on al or eax; cmp writes nothing */
+      if ((opcode & 0xf8) != 0x38)
+        this->clear_reg (0);
+    }
+  else if (opcode == 0x98 or opcode == 0xa0 or opcode == 0xa1)
+    this->clear_reg (0);
+  else if (opcode == 0x99) /* cdq */
+    this->clear_reg (2);
+  else if (opcode == 0x90 or opcode == 0xa2 or opcode == 0xa3
+           or opcode == 0xa8 or opcode == 0xa9)
+    ;
+  else if (opcode == 0x0f)
+    {
+      /* movzx, movsx, imul; the rest may be anything */
+      if (size >= 3 and ((data[1] & 0xf6) == 0xb6 or data[1] == 0xaf))
+        this->clear_reg ((data[2] >> 3) & 7);
+      else
+        this->reset ();
+    }
+  else if (!this->step_modrm (opcode, data, size, relocs, target, &use))
+    this->reset ();
+
+  return use;
+}
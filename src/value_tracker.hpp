@@ -0,0 +1,82 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file value_tracker.hpp
+ *     Header file for value_tracker.cpp, with declaration of ValueTracker.
+ * @par Purpose:
+ *     Storage for ValueTracker class which follows relocated immediates
+ *     through registers and stack slots, to find targets of indirect calls.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_VALUE_TRACKER_H
+#define LEDISASM_VALUE_TRACKER_H
+
+#include <inttypes.h>
+#include <cstddef>
+
+/** Forward data flow of relocated addresses within a basic block.
+ *
+ * Registers and esp relative stack slots are known only when loaded from
+ * a relocated immediate, or copied from a known one. Instructions which
+ * may write a register make it unknown; those not recognized, and any
+ * control transfer, forget everything. When a known value reaches an
+ * indirect call or jump, it is given as the target.
+ */
+class ValueTracker
+{
+public:
+  enum Use
+  {
+    NONE,
+    CALL,
+    JUMP
+  };
+
+protected:
+  enum
+  {
+    REG_COUNT  = 8,
+    SLOT_COUNT = 16,
+    REG_ESP    = 4
+  };
+
+  struct Slot
+  {
+    int32_t  offset;   /**< from esp at the start of the block */
+    uint32_t value;
+  };
+
+protected:
+  uint32_t regs[REG_COUNT];
+  uint8_t  known_regs;
+  Slot     slots[SLOT_COUNT];
+  size_t   slot_count;
+  int32_t  esp_delta;
+
+protected:
+  void set_reg (int reg, bool known, uint32_t value);
+  void clear_reg (int reg);
+  bool get_reg (int reg, uint32_t *value) const;
+  void set_slot (int32_t offset, bool known, uint32_t value);
+  bool get_slot (int32_t offset, uint32_t *value) const;
+  void clear_slots (void);
+  static bool get_stack_slot (const uint8_t *modrm, size_t size,
+                              int32_t *disp, size_t *length);
+  bool step_modrm (uint8_t opcode, const uint8_t *data, size_t size,
+                   uint32_t relocs, uint32_t *target, Use *use);
+
+public:
+  ValueTracker (void);
+
+  void reset (void);
+  Use step (const uint8_t *data, size_t size, uint32_t relocs,
+            uint32_t *target);
+};
+
+#endif // LEDISASM_VALUE_TRACKER_H
@@ -0,0 +1,329 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file x86_decoder.cpp
+ *     Implementation of methods for X86Decoder class.
+ * @par Purpose:
+ *     Implementation of X86Decoder class, with opcode tables for finding
+ *     lengths of i386 instructions.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include "x86_decoder.hpp"
+
+/* Opcode flags */
+#define X    0x0001  /* leave to libopcodes */
+#define M    0x0002  /* has ModRM byte */
+#define I8   0x0004  /* 8-bit immediate */
+#define IZ   0x0008  /* 16 or 32-bit immediate, by operand size */
+#define I16  0x0010  /* 16-bit immediate */
+#define MO   0x0020  /* 32-bit memory offset */
+#define PTR  0x0040  /* far pointer, 48-bit */
+#define MEM  0x0080  /* ModRM must address memory */
+#define GRP  0x0100  /* operands depend on ModRM reg field */
+#define FPU  0x0200  /* x87 escape */
+#define STR  0x0400  /* string instruction, accepts rep prefixes */
+#define N66  0x0800  /* operand size prefix not supported */
+#define BAD  0x1000  /* invalid opcode, "(bad)" for libopcodes */
+#define O66  0x2000  /* operand size prefix */
+#define REP  0x4000  /* repeat prefix */
+#define ESC  0x8000  /* two byte opcode escape */
+
+static constexpr uint16_t onebyte_flags[256] = {
+  /*       0       1       2       3       4       5       6       7  */
+  /*       8       9       a       b       c       d       e       f  */
+  /* 00 */ M,      M,      M,      M,      I8,     IZ,     0,      0,
+  /* 08 */ M,      M,      M,      M,      I8,     IZ,     0,      ESC,
+  /* 10 */ M,      M,      M,      M,      I8,     IZ,     0,      0,
+  /* 18 */ M,      M,      M,      M,      I8,     IZ,     0,      0,
+  /* 20 */ M,      M,      M,      M,      I8,     IZ,     X,      0,
+  /* 28 */ M,      M,      M,      M,      I8,     IZ,     X,      0,
+  /* 30 */ M,      M,      M,      M,      I8,     IZ,     X,      0,
+  /* 38 */ M,      M,      M,      M,      I8,     IZ,     X,      0,
+  /* 40 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* 48 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* 50 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* 58 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* 60 */ 0,      0,      X,      M,      X,      X,      O66,    X,
+  /* 68 */ IZ,     M|IZ,   I8,     M|I8,   STR,    STR,    STR,    STR,
+  /* 70 */ I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66,
+  /* 78 */ I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66, I8|N66,
+  /* 80 */ M|I8,   M|IZ,   M|I8,   M|I8,   M,      M,      M,      M,
+  /* 88 */ M,      M,      M,      M,      M|GRP,  M|MEM,  M|GRP,  M|GRP,
+  /* 90 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* 98 */ 0,      0,      PTR|N66,X,      0,      0,      0,      0,
+  /* a0 */ MO,     MO,     MO,     MO,     STR,    STR,    STR,    STR,
+  /* a8 */ I8,     IZ,     STR,    STR,    STR,    STR,    STR,    STR,
+  /* b0 */ I8,     I8,     I8,     I8,     I8,     I8,     I8,     I8,
+  /* b8 */ IZ,     IZ,     IZ,     IZ,     IZ,     IZ,     IZ,     IZ,
+  /* c0 */ M|I8,   M|I8,   I16,    0,      M|MEM,  M|MEM,  M|I8|GRP, M|IZ|GRP,
+  /* c8 */ I16|I8, 0,      I16,    0,      0,      I8,     0,      0,
+  /* d0 */ M,      M,      M,      M,      I8,     I8,     BAD,    0,
+  /* d8 */ M|FPU,  M|FPU,  M|FPU,  M|FPU,  M|FPU,  M|FPU,  M|FPU,  M|FPU,
+  /* e0 */ I8|N66, I8|N66, I8|N66, I8|N66, I8,     I8,     I8,     I8,
+  /* e8 */ IZ|N66, IZ|N66, PTR|N66,I8|N66, 0,      0,      0,      0,
+  /* f0 */ X,      0,      REP,    REP,    0,      0,      M|GRP,  M|GRP,
+  /* f8 */ 0,      0,      0,      0,      0,      0,      M|GRP,  M|GRP
+};
+
+static constexpr uint16_t twobyte_flags[256] = {
+  /*       0       1       2       3       4       5       6       7  */
+  /*       8       9       a       b       c       d       e       f  */
+  /* 00 */ X,      X,      X,      X,      BAD,    0,      0,      0,
+  /* 08 */ 0,      0,      BAD,    0,      X,      X,      X,      X,
+  /* 10 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 18 */ X,      X,      X,      X,      X,      X,      X,      M,
+  /* 20 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 28 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 30 */ X,      0,      X,      X,      X,      X,      BAD,    X,
+  /* 38 */ X,      BAD,    X,      BAD,    BAD,    BAD,    BAD,    BAD,
+  /* 40 */ M,      M,      M,      M,      M,      M,      M,      M,
+  /* 48 */ M,      M,      M,      M,      M,      M,      M,      M,
+  /* 50 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 58 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 60 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 68 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 70 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 78 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* 80 */ IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66,
+  /* 88 */ IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66, IZ|N66,
+  /* 90 */ M,      M,      M,      M,      M,      M,      M,      M,
+  /* 98 */ M,      M,      M,      M,      M,      M,      M,      M,
+  /* a0 */ 0,      0,      0,      M,      M|I8,   M,      X,      X,
+  /* a8 */ 0,      0,      X,      M,      M|I8,   M,      X,      M,
+  /* b0 */ M,      M,      M|MEM,  M,      M|MEM,  M|MEM,  M,      M,
+  /* b8 */ X,      X,      M|I8|GRP, M,    M,      M,      M,      M,
+  /* c0 */ M,      M,      X,      X,      X,      X,      X,      X,
+  /* c8 */ 0,      0,      0,      0,      0,      0,      0,      0,
+  /* d0 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* d8 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* e0 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* e8 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* f0 */ X,      X,      X,      X,      X,      X,      X,      X,
+  /* f8 */ X,      X,      X,      X,      X,      X,      X,      X
+};
+
+/** Checks whether given ModRM reg field is supported for a group opcode. */
+static bool
+is_group_form_known (bool twobyte, uint8_t opcode, uint8_t modrm)
+{
+  uint8_t mod = modrm >> 6;
+  uint8_t reg = (modrm >> 3) & 7;
+
+  if (twobyte)
+    return (opcode == 0xba and reg >= 4);   /* bt, bts, btr, btc */
+
+  switch (opcode)
+    {
+    case 0x8c: /* mov to or from segment register, only six exist */
+    case 0x8e:
+      return (reg <= 5);
+
+    case 0x8f: /* pop; other forms are XOP */
+    case 0xc6: /* mov; other forms are xabort or invalid */
+    case 0xc7: /* mov; other forms are xbegin or invalid */
+      return (reg == 0);
+
+    case 0xf6:
+    case 0xf7:
+      return true;
+
+    case 0xfe: /* inc, dec */
+      return (reg <= 1);
+
+    case 0xff: /* far call and jmp need memory; 7 is invalid */
+      if (reg == 3 or reg == 5)
+        return (mod != 3);
+      return (reg != 7);
+
+    default:
+      return false;
+    }
+}
+
+/** Checks whether an x87 escape form is known to be valid. */
+static bool
+is_fpu_form_known (uint8_t opcode, uint8_t modrm)
+{
+  uint8_t reg = (modrm >> 3) & 7;
+
+  /* Register forms have many holes, leave them to libopcodes */
+  if ((modrm >> 6) == 3)
+    return false;
+
+  return !((opcode == 0xd9 and reg == 1)
+           or (opcode == 0xdb and (reg == 4 or reg == 6))
+           or (opcode == 0xdd and reg == 5));
+}
+
+/** Gives length of ModRM with SIB and displacement, using 32-bit addressing.
+ */
+static size_t
+get_modrm_length (const uint8_t *data, size_t length)
+{
+  uint8_t mod, rm;
+
+  mod = data[0] >> 6;
+  rm = data[0] & 7;
+
+  if (mod == 3)
+    return 1;
+
+  if (rm == 4)
+    {
+      if (length < 2)
+        return 0;
+
+      if (mod == 0 and (data[1] & 7) == 5)
+        return 6;
+
+      return 2 + (mod == 1 ? 1 : 0) + (mod == 2 ? 4 : 0);
+    }
+
+  if (mod == 0)
+    return (rm == 5) ? 5 : 1;
+
+  return (mod == 1) ? 2 : 5;
+}
+
+/** Decodes length of the instruction at given data.
+ *
+ * @param valid Set to false if the instruction is one libopcodes shows
+ *     as "(bad)".
+ * @param operands If not NULL, set to offset of the displacement and
+ *     immediate bytes, which are at the end of the instruction.
+ * @return Length of the instruction, or zero if it was not recognized
+ *     and libopcodes has to decode it.
+ */
+size_t
+X86Decoder::decode_length (const uint8_t *data, size_t length, bool *valid,
+                           size_t *operands)
+{
+  uint16_t flags;
+  uint8_t opcode;
+  bool opsize16;
+  bool rep;
+  bool twobyte;
+  size_t start;
+  size_t pos;
+  size_t n;
+
+  opsize16 = false;
+  rep = false;
+  twobyte = false;
+  pos = 0;
+
+  /* At most one operand size and one repeat prefix */
+  for (;;)
+    {
+      if (pos >= length)
+        return 0;
+
+      flags = onebyte_flags[data[pos]];
+
+      if ((flags & O66) != 0 and !opsize16)
+        opsize16 = true;
+      else if ((flags & REP) != 0 and !rep)
+        rep = true;
+      else
+        break;
+
+      pos++;
+    }
+
+  opcode = data[pos++];
+
+  if ((flags & ESC) != 0)
+    {
+      if (pos >= length)
+        return 0;
+
+      twobyte = true;
+      opcode = data[pos++];
+      flags = twobyte_flags[opcode];
+    }
+
+  if ((flags & (X | O66 | REP)) != 0)
+    return 0;
+
+  if ((opsize16 and (flags & N66) != 0) or (rep and (flags & STR) == 0))
+    return 0;
+
+  /* Operand size prefix selects other instructions in parts of 0f map */
+  if (opsize16 and twobyte and (flags & M) == 0)
+    return 0;
+
+  if ((flags & BAD) != 0)
+    {
+      if (opsize16 or rep)
+        return 0;
+
+      if (operands != NULL)
+        *operands = pos;
+
+      *valid = false;
+      return pos;
+    }
+
+  if ((flags & M) != 0)
+    {
+      if (pos >= length)
+        return 0;
+
+      if ((flags & MEM) != 0 and (data[pos] >> 6) == 3)
+        return 0;
+
+      if ((flags & GRP) != 0
+          and !is_group_form_known (twobyte, opcode, data[pos]))
+        return 0;
+
+      if ((flags & FPU) != 0 and !is_fpu_form_known (opcode, data[pos]))
+        return 0;
+
+      /* test has an immediate, unlike the rest of its group */
+      if (!twobyte and (opcode == 0xf6 or opcode == 0xf7)
+          and ((data[pos] >> 3) & 7) <= 1)
+        flags |= (opcode == 0xf6) ? I8 : IZ;
+
+      n = get_modrm_length (data + pos, length - pos);
+      if (n == 0)
+        return 0;
+
+      start = pos + 1;
+      if ((data[pos] >> 6) != 3 and (data[pos] & 7) == 4)
+        start++;
+
+      pos += n;
+    }
+  else
+    start = pos;
+
+  if ((flags & I8) != 0)
+    pos += 1;
+
+  if ((flags & IZ) != 0)
+    pos += opsize16 ? 2 : 4;
+
+  if ((flags & I16) != 0)
+    pos += 2;
+
+  if ((flags & MO) != 0)
+    pos += 4;
+
+  if ((flags & PTR) != 0)
+    pos += 6;
+
+  if (pos > length)
+    return 0;
+
+  if (operands != NULL)
+    *operands = start;
+
+  *valid = true;
+  return pos;
+}
@@ -0,0 +1,37 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file x86_decoder.hpp
+ *     Header file for x86_decoder.cpp, with declaration of X86Decoder class.
+ * @par Purpose:
+ *     Storage for X86Decoder class which finds lengths of common i386
+ *     instructions without formatting them into text.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_X86_DECODER_H
+#define LEDISASM_X86_DECODER_H
+
+#include <inttypes.h>
+#include <cstddef>
+
+/** Table driven length decoder for 32-bit i386 code.
+ *
+ * Covers the general purpose instructions compilers emit, with ModRM,
+ * SIB, displacements and immediates. Anything where libopcodes could
+ * produce a different length or text (most prefixes, FPU register forms,
+ * MMX/SSE, VEX and incomplete instructions) is left to libopcodes.
+ */
+class X86Decoder
+{
+public:
+  static size_t decode_length (const uint8_t *data, size_t length,
+                               bool *valid, size_t *operands = NULL);
+};
+
+#endif // LEDISASM_X86_DECODER_H
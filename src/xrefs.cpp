@@ -0,0 +1,306 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file xrefs.cpp
+ *     Implementation of XrefIndex class methods.
+ * @par Purpose:
+ *     Implements the XrefIndex class which keeps references between code
+ *     locations found while tracing, and allows to query them both ways.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#include <algorithm>
+
+#include "memory_usage.hpp"
+#include "xrefs.hpp"
+#include "regions.hpp"
+
+static bool
+xref_by_source (const XrefIndex::Xref &a, const XrefIndex::Xref &b)
+{
+  if (a.source != b.source)
+    return a.source < b.source;
+  if (a.target != b.target)
+    return a.target < b.target;
+  return a.type < b.type;
+}
+
+static bool
+xref_by_target (const XrefIndex::Xref &a, const XrefIndex::Xref &b)
+{
+  if (a.target != b.target)
+    return a.target < b.target;
+  if (a.source != b.source)
+    return a.source < b.source;
+  return a.type < b.type;
+}
+
+static bool
+xref_equal (const XrefIndex::Xref &a, const XrefIndex::Xref &b)
+{
+  return (a.source == b.source and a.target == b.target
+          and a.type == b.type);
+}
+
+/** Checks if the reference source lays in a region of matching type.
+ *
+ * Code which was traced, but later turned out to be data, leaves stale
+ * references behind; these are skipped when building the index.
+ */
+static bool
+xref_source_valid (const XrefIndex::Xref &xref, const Region *reg)
+{
+  if (reg == NULL or !reg->contains_address (xref.source))
+    return false;
+
+  if (xref.type == XrefIndex::VTABLE)
+    return (reg->get_type () == Region::VTABLE);
+
+  return (reg->get_type () == Region::CODE);
+}
+
+const XrefIndex::Ref *
+XrefIndex::Table::find (uint32_t addr, size_t *count) const
+{
+  std::vector<uint32_t>::const_iterator itr;
+  size_t n;
+
+  itr = std::lower_bound (this->keys.begin (), this->keys.end (), addr);
+  if (itr == this->keys.end () or *itr != addr)
+    {
+      *count = 0;
+      return NULL;
+    }
+
+  n = itr - this->keys.begin ();
+  *count = this->offsets[n + 1] - this->offsets[n];
+  return &this->refs[this->offsets[n]];
+}
+
+/** Gives index of the first key at or above given address. */
+size_t
+XrefIndex::Table::find_index (uint32_t addr) const
+{
+  return std::lower_bound (this->keys.begin (), this->keys.end (), addr)
+         - this->keys.begin ();
+}
+
+XrefIndex::XrefIndex (void)
+{
+}
+
+/** Records a reference, to be indexed by the next build(). */
+void
+XrefIndex::add (const Xref &xref)
+{
+  this->pending.push_back (xref);
+}
+
+void
+XrefIndex::clear (void)
+{
+  this->pending.clear ();
+
+  this->refs_to = Table ();
+  this->refs_from = Table ();
+}
+
+/** Compacts the recorded references into the index.
+ *
+ * Recorded references are merged, duplicates removed, and those with
+ * source outside of the matching kind of region dropped. The list is
+ * emptied; references recorded later require another build().
+ */
+void
+XrefIndex::build (const PersistentMap<uint32_t, Region> *regions)
+{
+  PersistentMap<uint32_t, Region>::const_iterator ritr;
+  std::vector<Xref> all;
+  std::vector<Xref> kept;
+  size_t total;
+  size_t n;
+  Table *tables[2];
+  bool (*order[2]) (const Xref &, const Xref &);
+
+  total = this->pending.size ();
+
+  /* Keep what was indexed before, so builds can be repeated */
+  total += this->refs_from.refs.size ();
+  all.reserve (total);
+
+  for (n = 0; n < this->refs_from.keys.size (); n++)
+    {
+      uint32_t k;
+
+      for (k = this->refs_from.offsets[n];
+           k < this->refs_from.offsets[n + 1]; k++)
+        {
+          Xref xref;
+
+          xref.source = this->refs_from.keys[n];
+          xref.target = this->refs_from.refs[k].address;
+          xref.type   = this->refs_from.refs[k].type;
+          all.push_back (xref);
+        }
+    }
+
+  all.insert (all.end (), this->pending.begin (), this->pending.end ());
+  std::vector<Xref> ().swap (this->pending);
+
+  std::sort (all.begin (), all.end (), xref_by_source);
+  all.erase (std::unique (all.begin (), all.end (), xref_equal), all.end ());
+
+  /* Sources are sorted, so regions are matched in one sweep */
+  kept.reserve (all.size ());
+  ritr = regions->begin ();
+
+  for (n = 0; n < all.size (); n++)
+    {
+      while (ritr != regions->end ()
+             and ritr->second.get_end_address () <= all[n].source)
+        ++ritr;
+
+      if (ritr != regions->end ()
+          and xref_source_valid (all[n], &ritr->second))
+        kept.push_back (all[n]);
+    }
+
+  std::vector<Xref> ().swap (all);
+
+  tables[0] = &this->refs_from;
+  tables[1] = &this->refs_to;
+  order[0] = xref_by_source;
+  order[1] = xref_by_target;
+
+  for (n = 0; n < 2; n++)
+    {
+      Table *table = tables[n];
+      size_t k;
+
+      std::sort (kept.begin (), kept.end (), order[n]);
+
+      *table = Table ();
+      table->refs.reserve (kept.size ());
+
+      for (k = 0; k < kept.size (); k++)
+        {
+          uint32_t key;
+          Ref ref;
+
+          key = (n == 0) ? kept[k].source : kept[k].target;
+          ref.address = (n == 0) ? kept[k].target : kept[k].source;
+          ref.type = kept[k].type;
+
+          if (table->keys.empty () or table->keys.back () != key)
+            {
+              table->keys.push_back (key);
+              table->offsets.push_back (table->refs.size ());
+            }
+
+          table->refs.push_back (ref);
+        }
+
+      table->offsets.push_back (table->refs.size ());
+    }
+}
+
+const XrefIndex::Ref *
+XrefIndex::get_refs_to (uint32_t target, size_t *count) const
+{
+  return this->refs_to.find (target, count);
+}
+
+const XrefIndex::Ref *
+XrefIndex::get_refs_from (uint32_t source, size_t *count) const
+{
+  return this->refs_from.find (source, count);
+}
+
+size_t
+XrefIndex::get_target_count (void) const
+{
+  return this->refs_to.keys.size ();
+}
+
+uint32_t
+XrefIndex::get_target (size_t index) const
+{
+  return this->refs_to.keys[index];
+}
+
+size_t
+XrefIndex::find_target_index (uint32_t address) const
+{
+  return this->refs_to.find_index (address);
+}
+
+size_t
+XrefIndex::get_source_count (void) const
+{
+  return this->refs_from.keys.size ();
+}
+
+uint32_t
+XrefIndex::get_source (size_t index) const
+{
+  return this->refs_from.keys[index];
+}
+
+size_t
+XrefIndex::find_source_index (uint32_t address) const
+{
+  return this->refs_from.find_index (address);
+}
+
+size_t
+XrefIndex::size (void) const
+{
+  return this->refs_to.refs.size ();
+}
+
+/** Gives memory of recorded and indexed references, in bytes. */
+size_t
+XrefIndex::get_memory_used (void) const
+{
+  const Table *tables[2] = { &this->refs_from, &this->refs_to };
+  size_t bytes;
+  size_t n;
+
+  bytes = vector_memory (this->pending);
+
+  for (n = 0; n < 2; n++)
+    bytes += vector_memory (tables[n]->keys)
+             + vector_memory (tables[n]->offsets)
+             + vector_memory (tables[n]->refs);
+
+  return bytes;
+}
+
+std::ostream &
+operator<< (std::ostream &os, XrefIndex::Type type)
+{
+  switch (type)
+    {
+    case XrefIndex::CALL:
+      os << "call";
+      break;
+    case XrefIndex::JUMP:
+      os << "jump";
+      break;
+    case XrefIndex::COND_JUMP:
+      os << "cond_jump";
+      break;
+    case XrefIndex::VTABLE:
+      os << "vtable";
+      break;
+    default:
+      os << "(unknown " << std::dec << (int) type << ")";
+      break;
+    }
+  return os;
+}
@@ -0,0 +1,101 @@
+/*
+ * le_disasm - Linear Executable disassembler
+ */
+/** @file xrefs.hpp
+ *     Header file for xrefs.cpp, with declaration of XrefIndex class.
+ * @par Purpose:
+ *     Storage for XrefIndex class which keeps references between code
+ *     locations found while tracing, and allows to query them both ways.
+ * @author   le_disasm contributors
+ * @date     2026-10-18 - 2026-10-18
+ * @par  Copying and copyrights:
+ *     This program is free software; you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation; either version 2 of the License, or
+ *     (at your option) any later version.
+ */
+#ifndef LEDISASM_XREFS_H
+#define LEDISASM_XREFS_H
+
+#include <inttypes.h>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "persistent_map.hpp"
+
+class Region;
+
+/** Index of cross references between addresses.
+ *
+ * References are first recorded in a list while tracing, then
+ * compacted by build() into two arrays in compressed sparse row
+ * layout - one keyed by target, other keyed by source. Finding refs of
+ * an address is a binary search; each reference found costs O(1).
+ */
+class XrefIndex
+{
+public:
+  enum Type
+  {
+    CALL,
+    JUMP,
+    COND_JUMP,
+    VTABLE
+  };
+
+  /** Single recorded reference. */
+  struct Xref
+  {
+    uint32_t source;
+    uint32_t target;
+    XrefIndex::Type type;
+  };
+
+  /** Other end of a reference, as returned by queries. */
+  struct Ref
+  {
+    uint32_t address;
+    XrefIndex::Type type;
+  };
+
+protected:
+  /** References in CSR layout, for one direction. */
+  struct Table
+  {
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> offsets;
+    std::vector<Ref>      refs;
+
+    const Ref *find (uint32_t addr, size_t *count) const;
+    size_t find_index (uint32_t addr) const;
+  };
+
+protected:
+  std::vector<Xref> pending;  /**< recorded since the last build() */
+  Table refs_to;
+  Table refs_from;
+
+public:
+  XrefIndex (void);
+
+  void add (const Xref &xref);
+  void clear (void);
+
+  void build (const PersistentMap<uint32_t, Region> *regions);
+
+  const Ref *get_refs_to (uint32_t target, size_t *count) const;
+  const Ref *get_refs_from (uint32_t source, size_t *count) const;
+  size_t get_target_count (void) const;
+  uint32_t get_target (size_t index) const;
+  size_t find_target_index (uint32_t address) const;
+  size_t get_source_count (void) const;
+  uint32_t get_source (size_t index) const;
+  size_t find_source_index (uint32_t address) const;
+  size_t size (void) const;
+  size_t get_memory_used (void) const;
+};
+
+std::ostream &operator<< (std::ostream &os, XrefIndex::Type type);
+
+#endif // LEDISASM_XREFS_H